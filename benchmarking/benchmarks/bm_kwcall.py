@@ -0,0 +1,46 @@
+"""
+Keyword-heavy calls between small functions, with defaults and keyword-only parameters.
+"""
+import pyperf
+
+
+LOOPS = 100000
+
+
+def clamp(value, *, low=0.0, high=1.0):
+    return low if value < low else high if value > high else value
+
+
+def blend(a, b, weight=0.5, *, gamma=1.0):
+    return clamp(a * (1.0 - weight) + b * weight, high=gamma)
+
+
+def shade(r, g, b, *, weight, gamma=1.0, low=0.0):
+    return (
+        clamp(blend(r, g, weight=weight, gamma=gamma), low=low),
+        clamp(blend(g, b, gamma=gamma, weight=weight), low=low, high=gamma),
+        clamp(value=blend(b=r, a=b, weight=weight)),
+    )
+
+
+def benchmark(loops):
+    total = 0.0
+    for i in range(loops):
+        w = (i % 100) / 100.0
+        r, g, b = shade(w, 1.0 - w, 0.5, weight=w, gamma=0.9)
+        total += r + g + b
+    return total
+
+
+if __name__ == "__main__":
+    runner = pyperf.Runner()
+    runner.metadata['description'] = "Keyword argument call benchmark"
+
+    loops = LOOPS
+
+    import sys
+    sys.path.append('.')
+
+    import benchmarking.utils
+    benchmarking.utils.jittify(globals())
+    runner.bench_func('kwcall_' + benchmarking.utils.postfix(), benchmark, loops)
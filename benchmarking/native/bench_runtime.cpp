@@ -0,0 +1,335 @@
+/**
+ * Microbenchmarks of the runtime primitives of yapyjit, each measured in isolation
+ * instead of through whole programs as in the pyperformance ports. CPython is embedded
+ * with yapyjit linked in, see build.py.
+ *
+ * Usage: bench_runtime [--filter SUBSTRING] [--repeats N] [OUTPUT.json]
+ * Results are written as JSON, to stdout if no output is given, so that runs of
+ * different commits can be compared. Times are nanoseconds per operation, the minimum
+ * and the median of the repeats.
+ */
+#include <Python.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <yapyjit.h>
+#include <ir_interpret_base.h>
+#include <gen_icache.h>
+
+extern "C" PyObject* PyInit_yapyjit();
+
+// Functions of the benchmarks, made by the embedded interpreter.
+static const char setup_source[] = R"PY(
+import importlib
+import sys
+import tempfile
+import yapyjit
+
+UNROLL = 100
+# Statements timed in the interpreter, each repeated UNROLL times in a jitted function of its own.
+CASES = [
+    ("move", "x = a", (1, 2)),
+    ("constant", "x = 1", (1, 2)),
+    ("add_int", "x = a + b", (1, 2)),
+    ("add_float", "x = a + b", (1.5, 2.5)),
+    ("compare", "x = a < b", (1, 2)),
+    ("branch", "if a: x = b", (1, 2)),
+    ("load_global", "x = G", (1, 2)),
+    ("load_attr", "x = b.real", (1, 2)),
+    ("build_tuple", "x = (a, b)", (1, 2)),
+    ("call_builtin", "x = abs(b)", (1, 2)),
+]
+
+source = ["G = 1", "def empty(a, b):\n    return a"]
+source += ["def %s(a, b):\n%s    return a" % (name, ("    %s\n" % stmt) * UNROLL) for name, stmt, _ in CASES]
+source += ["def bind(a, b=2, c=3, *, d=4):\n    return a", "def ident(a):\n    return a"]
+# The AST front end reads the source of functions, so they are written to a module.
+module_dir = tempfile.TemporaryDirectory()
+with open(module_dir.name + "/yapyjit_bench_cases.py", "w") as f:
+    f.write("\n\n\n".join(source) + "\n")
+sys.path.insert(0, module_dir.name)
+cases = importlib.import_module("yapyjit_bench_cases")
+
+
+def instructions(func, args):
+    # Executed by one call, counted by the profiling interpreter.
+    yapyjit.set_profile(True)
+    try:
+        func(*args)
+    finally:
+        yapyjit.set_profile(False)
+    return sum(p["count"] for p in func.insn_profile())
+
+
+empty = yapyjit.jit(cases.empty)
+empty_insns = instructions(empty, (1, 2))
+dispatch = {}
+for name, _, args in CASES:
+    func = yapyjit.jit(getattr(cases, name))
+    dispatch[name] = (func, args, (instructions(func, args) - empty_insns) / UNROLL)
+bind = yapyjit.jit(cases.bind)
+ident = yapyjit.jit(cases.ident)
+)PY";
+
+struct Result {
+    std::string name;
+    double min_ns;
+    double median_ns;
+    uint64_t iterations;  // Operations in each repeat.
+    std::string extra;  // More JSON fields of the benchmark, if any.
+};
+
+struct Options {
+    std::string filter;
+    int repeats = 7;
+};
+
+static Options options;
+static std::vector<Result> results;
+
+static PyObject* check(PyObject* obj) {
+    if (!obj)
+        throw std::runtime_error("Python error");
+    return obj;
+}
+
+// Seconds taken by `body(n)`.
+template<typename F>
+static double time_once(F& body, uint64_t n) {
+    auto start = std::chrono::steady_clock::now();
+    body(n);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Nanoseconds per operation of each repeat, `body(n)` runs `n` operations.
+// The count is doubled until a repeat takes at least 20 ms, which also warms up caches and the JIT.
+template<typename F>
+static std::vector<double> measure(F&& body, uint64_t& n) {
+    n = 1;
+    while (time_once(body, n) < 0.02)
+        n *= 2;
+    std::vector<double> samples;
+    for (int i = 0; i < options.repeats; i++)
+        samples.push_back(time_once(body, n) * 1e9 / n);
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+static bool selected(const std::string& name) {
+    return name.find(options.filter) != std::string::npos;
+}
+
+static void report(const std::string& name, const std::vector<double>& samples, uint64_t n, const std::string& extra = "") {
+    results.push_back({ name, samples.front(), samples[samples.size() / 2], n, extra });
+    fprintf(stderr, "%-32s %10.2f ns\n", name.c_str(), samples[samples.size() / 2]);
+}
+
+template<typename F>
+static void bench(const std::string& name, F&& body, const std::string& extra = "") {
+    if (!selected(name))
+        return;
+    uint64_t n;
+    auto samples = measure(body, n);
+    report(name, samples, n, extra);
+}
+
+// Calls `func` with positional `args` through vectorcall, as the `Call` instruction does.
+static void call_loop(PyObject* func, PyObject* args, uint64_t n) {
+    auto argv = &PyTuple_GET_ITEM(args, 0);
+    auto nargs = PyTuple_GET_SIZE(args);
+    for (uint64_t i = 0; i < n; i++)
+        Py_DECREF(check(_PyObject_Vectorcall(func, argv, nargs, nullptr)));
+}
+
+// Time of one statement in the interpreter: the function repeating it, less an empty function, over `UNROLL`.
+static void bench_dispatch(PyObject* ns) {
+    auto unroll = PyLong_AsLong(PyDict_GetItemString(ns, "UNROLL"));
+    auto empty = PyDict_GetItemString(ns, "empty");
+    auto dispatch = PyDict_GetItemString(ns, "dispatch");
+    auto empty_args = yapyjit::ManagedPyo(Py_BuildValue("(ii)", 1, 2));
+    uint64_t n_empty;
+    auto empty_samples = measure([&](uint64_t n) { call_loop(empty, empty_args.borrow(), n); }, n_empty);
+    PyObject* key;
+    PyObject* value;
+    Py_ssize_t pos = 0;
+    while (PyDict_Next(dispatch, &pos, &key, &value)) {
+        auto name = std::string("dispatch/") + PyUnicode_AsUTF8(key);
+        if (!selected(name))
+            continue;
+        auto func = PyTuple_GET_ITEM(value, 0);
+        auto args = PyTuple_GET_ITEM(value, 1);
+        auto insns = PyFloat_AsDouble(PyTuple_GET_ITEM(value, 2));
+        uint64_t n;
+        auto samples = measure([&](uint64_t n) { call_loop(func, args, n); }, n);
+        for (size_t i = 0; i < samples.size(); i++)
+            samples[i] = (samples[i] - empty_samples[i]) / unroll;
+        std::sort(samples.begin(), samples.end());
+        report(name, samples, n * unroll, "\"insns_per_op\": " + std::to_string(insns));
+    }
+}
+
+// Register traffic of the interpreter, with objects that are not immortal.
+static void bench_write_ref() {
+    std::vector<PyObject*> locals(8);
+    for (auto& local : locals)
+        local = check(PyFloat_FromDouble(0.0));
+    PyObject* values[2] = { check(PyFloat_FromDouble(1.0)), check(PyFloat_FromDouble(2.0)) };
+    bench("write_ref/full", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            yapyjit::write_ref_full(locals, i & 7, values[i & 1]);
+    });
+    bench("write_ref/owned", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++) {
+            Py_INCREF(values[i & 1]);
+            yapyjit::write_ref(locals, i & 7, values[i & 1]);
+        }
+    });
+    for (auto local : locals)
+        Py_DECREF(local);
+    Py_DECREF(values[0]);
+    Py_DECREF(values[1]);
+}
+
+// Argument binding of `wf_fastcall`, and the `Call` path to C functions and to jitted functions.
+static void bench_calls(PyObject* ns) {
+    auto bind = PyDict_GetItemString(ns, "bind");
+    auto ident = PyDict_GetItemString(ns, "ident");
+    auto abs = PyDict_GetItemString(PyEval_GetBuiltins(), "abs");
+    auto one = yapyjit::ManagedPyo(PyLong_FromLong(1));
+    PyObject* argv[4] = { one.borrow(), one.borrow(), one.borrow(), one.borrow() };
+    auto kwnames = yapyjit::ManagedPyo(Py_BuildValue("(ss)", "c", "d"));
+    bench("bind/positional", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(_PyObject_Vectorcall(bind, argv, 3, nullptr)));
+    });
+    bench("bind/keyword", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(_PyObject_Vectorcall(bind, argv, 2, kwnames.borrow())));
+    });
+    bench("bind/defaults", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(_PyObject_Vectorcall(bind, argv, 1, nullptr)));
+    });
+    bench("call/c_function", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(yapyjit::call_function(abs, argv, 1, nullptr)));
+    });
+    bench("call/jit_entrance", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(yapyjit::call_function(ident, argv, 1, nullptr)));
+    });
+}
+
+// Binary operations on ints through an inline cache hit, a megamorphic miss, and the resolution alone.
+static void bench_binop() {
+    auto left = yapyjit::ManagedPyo(PyLong_FromLong(1));
+    auto right = yapyjit::ManagedPyo(PyLong_FromLong(2));
+    auto v = left.borrow();
+    auto w = right.borrow();
+    yapyjit::icache_t<2> hit;
+    Py_DECREF(check(yapyjit::nb_binop_icached<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), '+', 0>(&hit, v, w)));
+    bench("binop/icache_hit", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(yapyjit::nb_binop_icached<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), '+', 0>(&hit, v, w)));
+    });
+    yapyjit::icache_t<2> mega;
+    mega.state = yapyjit::ICACHE_MEGA;
+    bench("binop/icache_miss", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(yapyjit::nb_binop_icached<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), '+', 0>(&mega, v, w)));
+    });
+    bench("binop/resolve", [&](uint64_t n) {
+        binaryfunc resolved;
+        for (uint64_t i = 0; i < n; i++)
+            Py_DECREF(check(yapyjit::nb_binop_with_resolve<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), '+', 0>(v, w, &resolved)));
+    });
+}
+
+// Emission of instructions by the compiler. The buffer is reset every 4096 instructions, keeping its capacity.
+static void bench_serializer() {
+    yapyjit::WeakSerializer serializer;
+    std::vector<yapyjit::local_t> args = { 1, 2, 3 };
+    std::map<std::string, yapyjit::local_t> kwargs = { { "key", 4 } };
+    for (int kind = 0; kind < 2; kind++) {
+        auto name = kind == 0 ? "serializer/binop" : "serializer/call";
+        if (!selected(name))
+            continue;
+        auto emit = [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; i++) {
+                if ((i & 4095) == 0)
+                    serializer.buffer.clear();
+                if (kind == 0)
+                    serializer.append(yapyjit::binop_ins(yapyjit::InsnTag::Add, 1, 2, 3, nullptr));
+                else
+                    serializer.append(yapyjit::call_ins(4, 5, args, kwargs, nullptr));
+            }
+        };
+        uint64_t n;
+        auto samples = measure(emit, n);
+        serializer.buffer.clear();
+        emit(1);
+        report(name, samples, n, "\"bytes_per_op\": " + std::to_string(serializer.buffer.size()));
+    }
+}
+
+static void write_results(FILE* out) {
+    fprintf(out, "{\n  \"python\": \"%s\",\n  \"results\": [\n", PY_VERSION);
+    for (size_t i = 0; i < results.size(); i++) {
+        const auto& result = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"min_ns\": %.3f, \"median_ns\": %.3f, \"iterations\": %llu, \"repeats\": %d",
+            result.name.c_str(), result.min_ns, result.median_ns, (unsigned long long)result.iterations, options.repeats);
+        if (!result.extra.empty())
+            fprintf(out, ", %s", result.extra.c_str());
+        fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--filter") && i + 1 < argc)
+            options.filter = argv[++i];
+        else if (!strcmp(argv[i], "--repeats") && i + 1 < argc)
+            options.repeats = std::max(1, atoi(argv[++i]));
+        else if (argv[i][0] != '-')
+            output = argv[i];
+        else {
+            fprintf(stderr, "Usage: %s [--filter SUBSTRING] [--repeats N] [OUTPUT.json]\n", argv[0]);
+            return 2;
+        }
+    }
+    PyImport_AppendInittab("yapyjit", PyInit_yapyjit);
+    Py_Initialize();
+    int status = 0;
+    try {
+        auto main_module = check(PyImport_AddModule("__main__"));
+        auto ns = PyModule_GetDict(main_module);
+        Py_DECREF(check(PyRun_String(setup_source, Py_file_input, ns, ns)));
+        bench_dispatch(ns);
+        bench_write_ref();
+        bench_calls(ns);
+        bench_binop();
+        bench_serializer();
+        FILE* out = output ? fopen(output, "w") : stdout;
+        if (!out)
+            throw std::runtime_error(std::string("cannot write ") + output);
+        write_results(out);
+        if (output)
+            fclose(out);
+    }
+    catch (const std::exception& e) {
+        if (PyErr_Occurred())
+            PyErr_Print();
+        fprintf(stderr, "%s\n", e.what());
+        status = 1;
+    }
+    if (Py_FinalizeEx() < 0)
+        status = 1;
+    return status;
+}
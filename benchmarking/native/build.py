@@ -0,0 +1,77 @@
+"""
+Builds bench_runtime, the native microbenchmarks of the runtime primitives, into build/native_bench.
+The yapyjit sources are compiled in with the macros and flags of setup.py, and CPython is embedded.
+
+    python benchmarking/native/build.py
+    build/native_bench/bench_runtime results.json
+"""
+import concurrent.futures
+import glob
+import os
+import platform
+import sys
+import sysconfig
+import setuptools  # Provides distutils on Python 3.12 and later.
+from distutils.ccompiler import new_compiler
+from distutils.sysconfig import customize_compiler
+
+
+ROOT = os.path.abspath(os.path.join(os.path.dirname(__file__), "..", ".."))
+
+
+def main():
+    os.chdir(ROOT)
+    compiler = new_compiler()
+    customize_compiler(compiler)
+    # Optimization levels come from the configuration of Python, as for the extension.
+    cc_args = []
+    if platform.system() == 'Windows':
+        cc_args += ['/std:c++17']
+    elif platform.system() == 'Linux':
+        cc_args += ['-D__FUNCTION__=""', '-std=c++17', '-fno-crossjumping']
+    else:
+        cc_args += ['-D__FUNCTION__=""', '-std=c++17']
+    sources = (
+        glob.glob("src/**/*.c", recursive=True)
+        + glob.glob("src/**/*.cpp", recursive=True)
+        + ["mir/mir.c", "mir/mir-gen.c", "benchmarking/native/bench_runtime.cpp"]
+    )
+
+    def compile_one(source):
+        # C++17 is only for the C++ sources, as in setup.py.
+        args = [a for a in cc_args if "c++17" not in a] if source.endswith('.c') else cc_args
+        return compiler.compile(
+            [source], output_dir="build/native_bench/obj",
+            macros=[("NO_COMBINE", "1"), ("MIR_INTERP_TRACE", "1")],
+            include_dirs=["include", "mir", sysconfig.get_paths()['include']],
+            extra_postargs=args
+        )
+
+    with concurrent.futures.ThreadPoolExecutor(os.cpu_count()) as pool:
+        objects = sum(pool.map(compile_one, sources), [])
+
+    library_dirs = []
+    runtime_library_dirs = []
+    link_args = []
+    if platform.system() == 'Windows':
+        libraries = ["python%d%d" % sys.version_info[:2]]
+        library_dirs.append(os.path.join(sys.base_prefix, "libs"))
+    else:
+        libraries = ["python" + sysconfig.get_config_var('LDVERSION')]
+        library_dirs += [sysconfig.get_config_var('LIBDIR'), sysconfig.get_config_var('LIBPL')]
+        if sysconfig.get_config_var('Py_ENABLE_SHARED'):
+            runtime_library_dirs.append(sysconfig.get_config_var('LIBDIR'))
+        link_args += (sysconfig.get_config_var('LIBS') or '').split()
+        link_args += (sysconfig.get_config_var('SYSLIBS') or '').split()
+        # The objects are C++, linked with the C++ driver for its runtime.
+        compiler.set_executable('linker_exe', compiler.compiler_cxx)
+    compiler.link_executable(
+        objects, "bench_runtime", output_dir="build/native_bench",
+        libraries=libraries, library_dirs=library_dirs,
+        runtime_library_dirs=runtime_library_dirs, extra_postargs=link_args
+    )
+    print(os.path.join(ROOT, "build", "native_bench", compiler.executable_filename("bench_runtime")))
+
+
+if __name__ == "__main__":
+    main()
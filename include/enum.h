@@ -138,6 +138,11 @@
 
 // Higher-order preprocessor macros.
 
+// yapyjit: larger tables from yapyjit_tools, `InsnTag` has more than 64 constants.
+#ifndef BETTER_ENUMS_MACRO_FILE
+#   define BETTER_ENUMS_MACRO_FILE <enum_macros.h>
+#endif
+
 #ifdef BETTER_ENUMS_MACRO_FILE
 #   include BETTER_ENUMS_MACRO_FILE
 #else
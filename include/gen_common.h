@@ -50,7 +50,7 @@ namespace yapyjit {
 	inline void emit_2pyo_call(MIRFunction* func, MIROp addr, MIRRegOp ret, MIROp a, MIROp b, MIR_type_t ret_ty = MIR_T_P) {
 		emit_disown(func, ret);
 		func->append_insn(MIR_CALL, {
-			func->parent->new_proto(MIR_T_P, { MIR_T_P, MIR_T_P }),
+			func->parent->new_proto(ret_ty, { MIR_T_P, MIR_T_P }),
 			addr, ret, a, b
 		});
 	}
@@ -66,12 +66,12 @@ namespace yapyjit {
 	inline void emit_3pyo_call(MIRFunction* func, MIROp addr, MIRRegOp ret, MIROp a, MIROp b, MIROp c, MIR_type_t ret_ty = MIR_T_P) {
 		emit_disown(func, ret);
 		func->append_insn(MIR_CALL, {
-			func->parent->new_proto(MIR_T_P, { MIR_T_P, MIR_T_P, MIR_T_P }),
+			func->parent->new_proto(ret_ty, { MIR_T_P, MIR_T_P, MIR_T_P }),
 			addr, ret, a, b, c
 		});
 	}
 
-	void debug_print(PyObject* pyo) {
+	inline void debug_print(PyObject* pyo) {
 		printf("\ndebug_print: object at %p\n", pyo);
 		PyObject_Print(pyo, stdout, 0);
 	}
@@ -83,7 +83,7 @@ namespace yapyjit {
 		});
 	}
 
-	void debug_print_novisit(PyObject* pyo) {
+	inline void debug_print_novisit(PyObject* pyo) {
 		printf("\ndebug_print: object at %p\n", pyo);
 	}
 
@@ -2,6 +2,7 @@
 #include <cstdlib>
 #include <Python.h>
 #include <ir.h>
+#include <icache.h>
 #include <exc_helper.h>
 #include <gen_common.h>
 #include <array>
@@ -10,6 +11,9 @@
         (*(binaryfunc*)(& ((char*)nb_methods)[slot]))
 #define NB_TERNOP(nb_methods, slot) \
         (*(ternaryfunc*)(& ((char*)nb_methods)[slot]))
+#ifndef NB_SLOT
+#define NB_SLOT(x) offsetof(PyNumberMethods, x)
+#endif
 
 namespace yapyjit {
     template<typename retT, typename ...argT>
@@ -115,11 +119,50 @@ namespace yapyjit {
         return binop_type_error(v, w, op_name);
 	}
 
-    template<int nargs>
-    struct icache_t {
-        void* ty[nargs];
-        void* addr;
-    };
+    // Binary operation through a polymorphic inline cache of resolved slots.
+    template<int seq_fallback_flags, int op_slot, char opn1, char opn2>
+    inline PyObject* nb_binop_icached(icache_t<2>* cache, PyObject* v, PyObject* w) {
+        void* tys[2] = { Py_TYPE(v), Py_TYPE(w) };
+        auto slot = (binaryfunc)cache->lookup(tys);
+        if (slot) {
+            PyObject* x = slot(v, w);
+            if (x != Py_NotImplemented)
+                return x;
+            Py_DECREF(x);
+        }
+        binaryfunc resolved = nullptr;
+        PyObject* x = nb_binop_with_resolve<seq_fallback_flags, op_slot, opn1, opn2>(v, w, &resolved);
+        if (resolved)
+            cache->insert(tys, (void*)resolved);
+        return x;
+    }
+
+    // In-place operation. Types with an in-place slot (lists, arrays, ...) go through `inplace`,
+    // e.g. `PyNumber_InPlaceAdd`; the others, like int and float, only have the binary operation.
+    template<int seq_fallback_flags, int op_slot, int iop_slot, char opn1, char opn2>
+    inline PyObject* nb_inplace_icached(icache_t<2>* cache, binaryfunc inplace, PyObject* v, PyObject* w) {
+        PyNumberMethods* mv = Py_TYPE(v)->tp_as_number;
+        PySequenceMethods* sv = Py_TYPE(v)->tp_as_sequence;
+        if ((mv && NB_BINOP(mv, iop_slot))
+            || ((seq_fallback_flags & SEQ_FALLBACK_CONCAT) && sv && sv->sq_inplace_concat)
+            || ((seq_fallback_flags & SEQ_FALLBACK_REPEAT) && sv && sv->sq_inplace_repeat))
+            return inplace(v, w);
+        return nb_binop_icached<seq_fallback_flags, op_slot, opn1, opn2>(cache, v, w);
+    }
+
+    // Slow path of native inline caches: probes the rest of the entries, then resolves.
+    // The observed types are passed in `cache->probe`.
+    template<int ncheck, typename retT, typename ...argT>
+    retT icache_miss(icache_t<ncheck>* cache, ResolverT<retT, argT...> resolver, argT... args) {
+        auto target = (FuncT<retT, argT...>)cache->lookup(cache->probe);
+        if (target)
+            return target(args...);
+        FuncT<retT, argT...> resolved = nullptr;
+        retT result = resolver(args..., &resolved);
+        if (resolved)
+            cache->insert(cache->probe, (void*)resolved);
+        return result;
+    }
 
     static PyObject* const_fun_notimpl() {
         Py_RETURN_NOTIMPLEMENTED;
@@ -137,16 +180,17 @@ namespace yapyjit {
     ) {
         auto emit_ctx = func->emit_ctx.get();
         emit_disown(emit_ctx, ret);
-        auto icache_fill = (icache_t<ncheck>*)func->allocate_fill(sizeof(icache_t<ncheck>));
+        auto icache_fill = func->new_icache<ncheck>();
 
-        auto resolve_label = emit_ctx->new_label();
+        auto miss_label = emit_ctx->new_label();
         auto end_label = emit_ctx->new_label();
-        auto cache_addr = MIRMemOp(MIR_T_P, MIRRegOp(0), (intptr_t)&icache_fill->addr);
+        auto cache_addr = MIRMemOp(MIR_T_P, MIRRegOp(0), (intptr_t)&icache_fill->entries[0].addr);
 
+        // Only the first entry is checked inline, the others are probed by `icache_miss`.
         for (size_t i = 0; i < ncheck; i++) {
             emit_ctx->append_insn(MIR_BNE, {
-                resolve_label,
-                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->ty[i]),
+                miss_label,
+                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->entries[0].ty[i]),
                 MIRMemOp(MIR_T_P, tyck[i], offsetof(PyObject, ob_type))
             });
         }
@@ -157,18 +201,19 @@ namespace yapyjit {
             cache_addr, ret, args...
         });
         emit_ctx->append_insn(MIR_JMP, { end_label });
-        emit_ctx->append_label(resolve_label);
+        emit_ctx->append_label(miss_label);
         for (size_t i = 0; i < ncheck; i++) {
             emit_ctx->append_insn(MIR_MOV, {
-                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->ty[i]),
+                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->probe[i]),
                 MIRMemOp(MIR_T_P, tyck[i], offsetof(PyObject, ob_type))
             });
         }
         emit_ctx->append_insn(MIR_CALL, {
             emit_ctx->parent->new_proto(MIRType<retT>::t, {
-                MIRType<argT>::t..., MIR_T_P
+                MIR_T_P, MIR_T_P, MIRType<argT>::t...
             }),
-            (intptr_t)resolver, ret, args..., (intptr_t)&icache_fill->addr
+            (intptr_t)icache_miss<(int)ncheck, retT, argT...>, ret,
+            (intptr_t)icache_fill, (intptr_t)resolver, args...
         });
         emit_ctx->append_label(end_label);
     }
@@ -183,13 +228,13 @@ namespace yapyjit {
         auto resolve_label = emit_ctx->new_label();
         auto skip_label = emit_ctx->new_label();
 
-        auto icache_fill = (icache_t<ncheck>*)func->allocate_fill(sizeof(icache_t<ncheck>));
-        auto cache_addr = MIRMemOp(MIR_T_P, MIRRegOp(0), (intptr_t)&icache_fill->addr);
+        auto icache_fill = func->new_icache<ncheck>();
+        auto cache_addr = MIRMemOp(MIR_T_P, MIRRegOp(0), (intptr_t)&icache_fill->entries[0].addr);
 
         for (size_t i = 0; i < ncheck; i++) {
             emit_ctx->append_insn(MIR_BNE, {
                 resolve_label,
-                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->ty[i]),
+                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->entries[0].ty[i]),
                 idxchk[i]
             });
         }
@@ -199,7 +244,7 @@ namespace yapyjit {
         emit_ctx->append_insn(MIR_MOV, { ret, (intptr_t)nullptr });
         for (size_t i = 0; i < ncheck; i++) {
             emit_ctx->append_insn(MIR_MOV, {
-                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->ty[i]),
+                MIRMemOp(MIR_T_P, MIRRegOp(0), (int64_t)&icache_fill->entries[0].ty[i]),
                 idxchk[i]
             });
         }
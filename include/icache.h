@@ -0,0 +1,90 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+
+// Number of type tuples kept by a polymorphic inline cache before it turns megamorphic.
+#ifndef YAPYJIT_ICACHE_ENTRIES
+#define YAPYJIT_ICACHE_ENTRIES 4
+#endif
+
+namespace yapyjit {
+	enum ICacheState : uint8_t {
+		ICACHE_EMPTY = 0,
+		ICACHE_MONO,
+		ICACHE_POLY,
+		ICACHE_MEGA
+	};
+
+	inline const char* icache_state_name(uint8_t state) {
+		switch (state) {
+		case ICACHE_EMPTY: return "empty";
+		case ICACHE_MONO: return "mono";
+		case ICACHE_POLY: return "poly";
+		case ICACHE_MEGA: return "mega";
+		}
+		return "unknown";
+	}
+
+	// Common part of all inline caches, for statistics.
+	struct icache_header_t {
+		uint64_t hits;
+		uint64_t misses;
+		uint8_t arity;
+		uint8_t size;
+		uint8_t state;
+	};
+
+	/**
+	 * Polymorphic inline cache keyed on a tuple of `nargs` types.
+	 * Entries are kept in append order. Once all `nentries` are taken and
+	 * another type tuple shows up, the site turns megamorphic and stops caching.
+	 */
+	template<int nargs, int nentries = YAPYJIT_ICACHE_ENTRIES>
+	struct icache_t : public icache_header_t {
+		struct entry_t {
+			void* ty[nargs];
+			void* addr;
+		} entries[nentries];
+		// Scratch space for native code to pass the observed types to the miss handler.
+		void* probe[nargs];
+
+		icache_t() : icache_header_t{ 0, 0, (uint8_t)nargs, 0, ICACHE_EMPTY } {
+			memset(entries, 0, sizeof(entries));
+			memset(probe, 0, sizeof(probe));
+		}
+
+		void* lookup(void* const* tys) {
+			if (state == ICACHE_MEGA) {
+				++misses;
+				return nullptr;
+			}
+			for (int i = 0; i < size; i++) {
+				if (memcmp(entries[i].ty, tys, sizeof(entries[i].ty)) == 0) {
+					++hits;
+					return entries[i].addr;
+				}
+			}
+			++misses;
+			return nullptr;
+		}
+
+		void insert(void* const* tys, void* addr) {
+			if (state == ICACHE_MEGA)
+				return;
+			for (int i = 0; i < size; i++) {
+				if (memcmp(entries[i].ty, tys, sizeof(entries[i].ty)) == 0) {
+					entries[i].addr = addr;
+					return;
+				}
+			}
+			if (size == nentries) {
+				state = ICACHE_MEGA;
+				return;
+			}
+			memcpy(entries[size].ty, tys, sizeof(entries[size].ty));
+			entries[size].addr = addr;
+			++size;
+			state = size == 1 ? ICACHE_MONO : ICACHE_POLY;
+		}
+	};
+};
@@ -16,6 +16,7 @@
 #pragma warning (disable: 26812)
 #endif
 #include <array>
+#include <chrono>
 #include <string>
 #include <vector>
 #include <memory>
@@ -24,13 +25,100 @@
 #include <enum.h>
 #include <Python.h>
 #include <mpyo.h>
+#include <icache.h>
 #include <mir_wrapper.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
 namespace yapyjit {
 	class Function;
-	std::string ir_pprint(uint8_t* p);
-    PyObject* ir_interpret(uint8_t* p, std::vector<PyObject*> locals, Function& func);
-	PyObject* ir_trace(uint8_t* p, std::vector<PyObject*> locals, Function& func);
+	typedef int16_t local_t;
+	typedef int32_t iaddr_t;
+
+	// Registers of a suspended generator body, see the `Yield` instruction.
+	struct GenFrame {
+		std::vector<PyObject*> locals;
+		iaddr_t resume = 0;  // Address to continue from, -1 if not suspended.
+	};
+
+	// Runtime counters of a jitted function, see `yapyjit.stats()`.
+	struct RuntimeStats {
+		uint64_t calls = 0;
+		uint64_t instructions = 0;  // Executed by the interpreter, not counting generator bodies.
+		uint64_t ticks = 0;  // Time stamp counter ticks spent in the outermost activations, callees included.
+		uint64_t exceptions = 0;  // Activations left by an exception.
+		uint64_t tier_changes = 0;  // Compilations and evictions.
+	};
+
+	// Counters of `ir_profile` for each instruction of a function, by bytecode offset, see `yapyjit.set_profile`.
+	struct InsnProfile {
+		std::vector<uint64_t> counts;
+		// Time stamp counter ticks from the start of each instruction to the start of the next one executed,
+		// so calls include their callees, except self-recursive calls run in place. Empty if not timed.
+		std::vector<uint64_t> cycles;
+	};
+
+	// Time stamp for `RuntimeStats::ticks` and `InsnProfile::cycles`, the cycle counter where there is one.
+	inline uint64_t read_tsc() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+	// State of a `Call` site, filled on its first call.
+	struct callsite_t {
+		PyObject* kwnames;  // Names of the keyword arguments for vectorcall, see `callsite_kwnames`.
+	};
+
+	// Counts of `profile` are printed before each instruction if given.
+	std::string ir_pprint(uint8_t* p, const InsnProfile* profile = nullptr);
+	// `p` may point into the middle of `func`, to resume a `frame` suspended there, whose `locals` are then given.
+	// Registers are released on return, but the storage stays with the caller for reuse.
+	// Instructions and exceptions are counted into `stats` if given.
+	PyObject* ir_interpret(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame = nullptr, RuntimeStats* stats = nullptr);
+	PyObject* ir_trace(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame = nullptr, RuntimeStats* stats = nullptr);
+	// Counts the instructions executed into `func.profile`, which must be set up by `start_profile`.
+	PyObject* ir_profile(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame = nullptr, RuntimeStats* stats = nullptr);
+	typedef PyObject* (*interpret_t)(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame, RuntimeStats* stats);
+	// Calls `callee` with vectorcall arguments, entering the compiled function if it is a `JitEntrance`.
+	PyObject* call_function(PyObject* callee, PyObject* const* args, size_t nargsf, PyObject* kwnames);
+	// Caller suspended by a self-recursive `Call`, resumed when the callee returns.
+	struct SelfCall {
+		std::vector<PyObject*> locals;  // Registers of the caller while suspended, those of the callee after.
+		uint8_t* resume;
+		local_t dst;
+		PyObject* callee;
+	};
+	// Callers suspended by the self-recursive calls that the interpreter runs in place instead of on the native stack.
+	// Only the first `depth` are active, the others keep their register storage for reuse.
+	// Out of line, as the optimizer takes very long over the interpreter if it follows this state across dispatches.
+	class SelfCallStack {
+		std::vector<SelfCall> calls;
+		size_t depth = 0;
+	public:
+		// Binds the arguments of a call of `callee` to `locals` if it is a `JitEntrance` running the bytecode at `code`,
+		// and suspends the caller, whose registers were in `locals`, to write the result to `dst` and go on at `resume`.
+		// Returns 0 if it is not, -1 on error. A call entered counts towards the recursion limit until `leave`.
+		int enter(PyObject* callee, const uint8_t* code, PyObject* const* args, size_t nargsf, PyObject* kwnames,
+		          std::vector<PyObject*>& locals, uint8_t* resume, local_t dst);
+		// Puts the registers of the innermost suspended caller back in `locals`, nullptr if there is none.
+		const SelfCall* leave(std::vector<PyObject*>& locals);
+	};
+	// Tuple of the `n` names at `names`, a run of null-terminated keyword names and registers as in `Call`.
+	// Sites with the same names share one tuple, kept alive for good like interned strings.
+	PyObject* callsite_kwnames(const uint8_t* names, int n);
+	// Object that creates generators running `body` when called with its arguments.
+	PyObject* new_generator_code(std::unique_ptr<Function> body);
+	// Prototype of the functions made by `MakeFunction` from `code`, all sharing the compiled `body`.
+	// Without a body, as the JIT does not support the code, they are plain python functions.
+	PyObject* new_function_proto(ManagedPyo code, ManagedPyo globals, std::unique_ptr<Function> body);
+	// New function of `proto`, `defaults`, `kwdefaults` and `closure` may be None.
+	PyObject* make_function(PyObject* proto, PyObject* defaults, PyObject* kwdefaults, PyObject* closure);
 
 	template<typename NativeTHead, typename... NativeT>
 	inline auto fill_bytes(uint8_t* ptr, NativeTHead arg0, NativeT... args) {
@@ -47,8 +135,6 @@ namespace yapyjit {
 		return result;
 	}
 
-	typedef int16_t local_t;
-	typedef int32_t iaddr_t;
 	const iaddr_t L_PLACEHOLDER = 0;
 	class ilabel_t final {
 	private:
@@ -78,6 +164,19 @@ namespace yapyjit {
 		BitXor,
 		BitAnd,
 		FloorDiv,
+		InplaceAdd,
+		InplaceSub,
+		InplaceMult,
+		InplaceMatMult,
+		InplaceDiv,
+		InplaceMod,
+		InplacePow,
+		InplaceLShift,
+		InplaceRShift,
+		InplaceBitOr,
+		InplaceBitXor,
+		InplaceBitAnd,
+		InplaceFloorDiv,
 		Invert,
 		Not,
 		UAdd,
@@ -98,34 +197,52 @@ namespace yapyjit {
 		DelItem,
 		ErrorProp,
 		ClearErrorCtx,
+		GetIter,
 		IterNext,
 		Jump,
 		JumpTruthy,
 		LoadAttr,
+		LoadMethod,
 		LoadClosure,
+		LoadCell,
 		LoadGlobal,
 		LoadItem,
 		Move,
 		Raise,
 		Return,
+		Yield,
 		StoreAttr,
 		StoreClosure,
+		StoreCell,
 		StoreGlobal,
 		StoreItem,
+		ListAppend,
+		SetAdd,
+		MapAdd,
 		BuildDict,
 		BuildList,
 		BuildSet,
 		BuildTuple,
 		Call,
+		CallEx,
+		CallForward,
+		CallMethod,
+		CallBuiltin,
 		Destruct,
+		MakeFunction,
+		GuardIs,
 		Prolog,
 		Epilog,
 		TraceHead,
 		HotTraceHead
 	)
 
-	inline auto binop_ins(InsnTag mode, local_t dst, local_t left, local_t right) {
-		return bytes(mode, dst, left, right);
+	inline auto binop_ins(InsnTag mode, local_t dst, local_t left, local_t right, icache_t<2>* cache) {
+		return bytes(mode, dst, left, right, cache);
+	}
+
+	inline auto inplaceop_ins(InsnTag mode, local_t dst, local_t left, local_t right, icache_t<2>* cache) {
+		return bytes(mode, dst, left, right, cache);
 	}
 
 	inline auto unaryop_ins(InsnTag mode, local_t dst, local_t src) {
@@ -160,6 +277,10 @@ namespace yapyjit {
 		return bytes(InsnTag::ClearErrorCtx);
 	}
 
+	inline auto get_iter_ins(local_t dst, local_t src) {
+		return bytes(InsnTag::GetIter, dst, src);
+	}
+
 	inline auto iter_next_ins(local_t dst, local_t iter, iaddr_t iter_fail_to = L_PLACEHOLDER) {
 		return bytes(InsnTag::IterNext, dst, iter, iter_fail_to);
 	}
@@ -176,10 +297,18 @@ namespace yapyjit {
 		return std::make_tuple(bytes(InsnTag::LoadAttr, dst, obj), attrname);
 	}
 
+	inline auto load_method_ins(local_t meth, local_t self, local_t obj, ManagedPyo name) {
+		return bytes(InsnTag::LoadMethod, meth, self, obj, name.transfer());
+	}
+
 	inline auto load_closure_ins(local_t dst, local_t closure) {
 		return bytes(InsnTag::LoadClosure, dst, closure);
 	}
 
+	inline auto load_cell_ins(local_t dst, local_t cell, const std::string& name) {
+		return std::make_tuple(bytes(InsnTag::LoadCell, dst, cell), name);
+	}
+
 	inline auto load_global_ins(local_t dst, const std::string& name) {
 		return std::make_tuple(bytes(InsnTag::LoadGlobal, dst), name);
 	}
@@ -200,6 +329,10 @@ namespace yapyjit {
 		return bytes(InsnTag::Return, src);
 	}
 
+	inline auto yield_ins(local_t src) {
+		return bytes(InsnTag::Yield, src);
+	}
+
 	inline auto store_attr_ins(local_t obj, local_t src, const std::string& attrname) {
 		return std::make_tuple(bytes(InsnTag::StoreAttr, obj, src), attrname);
 	}
@@ -208,6 +341,10 @@ namespace yapyjit {
 		return bytes(InsnTag::StoreClosure, src, closure);
 	}
 
+	inline auto store_cell_ins(local_t src, local_t cell) {
+		return bytes(InsnTag::StoreCell, src, cell);
+	}
+
 	inline auto store_global_ins(local_t src, const std::string& name) {
 		return std::make_tuple(bytes(InsnTag::StoreGlobal, src), name);
 	}
@@ -216,18 +353,52 @@ namespace yapyjit {
 		return bytes(InsnTag::StoreItem, obj, src, subscr);
 	}
 
+	inline auto list_append_ins(local_t list, local_t src) {
+		return bytes(InsnTag::ListAppend, list, src);
+	}
+
+	inline auto set_add_ins(local_t set, local_t src) {
+		return bytes(InsnTag::SetAdd, set, src);
+	}
+
+	inline auto map_add_ins(local_t map, local_t key, local_t value) {
+		return bytes(InsnTag::MapAdd, map, key, value);
+	}
+
 	inline auto build_ins(InsnTag mode, local_t dst, const std::vector<local_t>& args) {
 		if (args.size() > UINT8_MAX)
 			throw std::runtime_error("`build` with more than 255 args.");
 		return std::make_tuple(bytes(mode, dst, (uint8_t)args.size()), args);
 	}
 
-	inline auto call_ins(local_t dst, local_t func, const std::vector<local_t>& args, const std::map<std::string, local_t>& kwargs) {
+	inline auto call_ins(local_t dst, local_t func, const std::vector<local_t>& args, const std::map<std::string, local_t>& kwargs, callsite_t* site) {
 		if (args.size() > UINT8_MAX)
 			throw std::runtime_error("`Call` with more than 255 args.");
 		if (kwargs.size() > UINT8_MAX)
 			throw std::runtime_error("`Call` with more than 255 kwargs.");
-		return std::make_tuple(bytes(InsnTag::Call, dst, func, (uint8_t)args.size(), (uint8_t)kwargs.size()), args, kwargs);
+		return std::make_tuple(bytes(InsnTag::Call, dst, func, (uint8_t)args.size(), (uint8_t)kwargs.size(), site), args, kwargs);
+	}
+
+	inline auto call_ex_ins(local_t dst, local_t func, local_t args, local_t kwargs) {
+		return bytes(InsnTag::CallEx, dst, func, args, kwargs);
+	}
+
+	inline auto call_forward_ins(local_t dst, local_t func, local_t args, local_t kwnames) {
+		return bytes(InsnTag::CallForward, dst, func, args, kwnames);
+	}
+
+	inline auto call_method_ins(local_t dst, local_t meth, const std::vector<local_t>& args, const std::map<std::string, local_t>& kwargs, callsite_t* site) {
+		if (args.size() > UINT8_MAX)
+			throw std::runtime_error("`CallMethod` with more than 255 args.");
+		if (kwargs.size() > UINT8_MAX)
+			throw std::runtime_error("`CallMethod` with more than 255 kwargs.");
+		return std::make_tuple(bytes(InsnTag::CallMethod, dst, meth, (uint8_t)args.size(), (uint8_t)kwargs.size(), site), args, kwargs);
+	}
+
+	inline auto call_builtin_ins(local_t dst, uint8_t builtin, ManagedPyo name, ManagedPyo expected, const std::vector<local_t>& args) {
+		if (args.size() > UINT8_MAX)
+			throw std::runtime_error("`CallBuiltin` with more than 255 args.");
+		return std::make_tuple(bytes(InsnTag::CallBuiltin, dst, builtin, name.transfer(), expected.transfer(), (uint8_t)args.size()), args);
 	}
 
 	inline auto destruct_ins(local_t src, const std::vector<local_t>& targets) {
@@ -236,6 +407,14 @@ namespace yapyjit {
 		return std::make_tuple(bytes(InsnTag::Destruct, src, (uint8_t)targets.size()), targets);
 	}
 
+	inline auto make_function_ins(local_t dst, ManagedPyo proto, local_t defaults, local_t kwdefaults, local_t closure) {
+		return bytes(InsnTag::MakeFunction, dst, proto.transfer(), defaults, kwdefaults, closure);
+	}
+
+	inline auto guard_is_ins(local_t src, ManagedPyo expected, iaddr_t fail_to = L_PLACEHOLDER) {
+		return bytes(InsnTag::GuardIs, src, expected.transfer(), fail_to);
+	}
+
 	inline auto prolog_ins() {
 		return bytes(InsnTag::Prolog);
 	}
@@ -313,10 +492,29 @@ namespace yapyjit {
 		std::map<std::string, local_t> locals;  // ID is local register index
 		std::map<std::string, local_t> closure;  // ID is deref ns index
 		std::set<std::string> globals;
+		std::set<std::string> cells;  // Locals whose registers hold cells, see `LoadCell` and `StoreCell`.
+		std::vector<local_t> free_cells;  // Registers set to the closure cells of the entrance on each call.
+		std::vector<ManagedPyo> nested_code;  // Code objects of nested functions not yet emitted, AST front end only.
+		int first_line = 1;  // Source line of the first line of the AST, to match `nested_code`.
 		std::vector<PBlock*> pblocks;
 		std::vector<iaddr_t> exctable_key;
 		std::vector<iaddr_t> exctable_val;
+		std::vector<std::unique_ptr<uint8_t[]>> fills;
+		std::vector<std::pair<iaddr_t, icache_header_t*>> icache_sites;
+		std::unique_ptr<MIRFunction> emit_ctx;  // Native lowering context, if any.
+		interpret_t interpret = ir_interpret;  // Runs the function, `ir_interpret` or its stub in the perf map.
+		std::shared_ptr<InsnProfile> profile;  // Counters of `ir_profile`, if it has run the function.
 		int nargs;
+		int nborrowed = 0;  // Leading argument registers that are never written and borrow the caller's references.
+		int refcount_elided = 0;  // Refcount operations removed from the bytecode by optimizations.
+		size_t fills_size = 0;
+		bool owns_constants = true;  // Whether objects referenced by the bytecode are released with the function.
+		bool generator = false;  // Body of a generator, whose frames own all their registers.
+		bool varargs = false;  // `*args` in the register after the named arguments.
+		bool varkw = false;  // `**kwargs` in the register after those.
+		// Only `CallForward` reads `*args` and `**kwargs`. The entrance then packs the extra positional and
+		// keyword values into `*args` as in a vectorcall, and their names into `**kwargs`, building no dict.
+		bool forwards = false;
 
 		std::vector<uint8_t>& bytecode() { return bytecode_serializer.buffer; }
 
@@ -326,6 +524,13 @@ namespace yapyjit {
 			exctable_val.push_back(L_PLACEHOLDER);
 		}
 
+		~Function();
+
+		// Bytes of memory held by the compiled function: bytecode, runtime caches and exception table.
+		size_t code_size() {
+			return bytecode().size() + fills_size + (exctable_key.size() + exctable_val.size()) * sizeof(iaddr_t);
+		}
+
 		// Get address of the next instruction.
 		iaddr_t next_addr() { return static_cast<iaddr_t>(bytecode().size()); }
 
@@ -350,8 +555,48 @@ namespace yapyjit {
 			add_insn(structure);
 			return ilabel_t(bytecode(), next_addr() - sizeof(iaddr_t));
 		}
+
+		// Zero-initialized memory living as long as the function, for runtime caches.
+		void* allocate_fill(size_t size) {
+			fills.emplace_back(new uint8_t[size]());
+			fills_size += size;
+			return fills.back().get();
+		}
+
+		callsite_t* new_callsite() {
+			return new (allocate_fill(sizeof(callsite_t))) callsite_t();
+		}
+
+		// Inline cache for the instruction to be added next.
+		template<int nargs>
+		icache_t<nargs>* new_icache() {
+			auto cache = new (allocate_fill(sizeof(icache_t<nargs>))) icache_t<nargs>();
+			icache_sites.push_back({ next_addr(), cache });
+			return cache;
+		}
+
+		// Inline cache of the binary or in-place operation `op` to be added next.
+		// None for the power operations, which are not cached.
+		icache_t<2>* new_binop_icache(InsnTag op) {
+			if (op == +InsnTag::Pow || op == +InsnTag::InplacePow)
+				return nullptr;
+			return new_icache<2>();
+		}
 	};
 
+	// Counters for `ir_profile` to run `func`. They start again from zero when the bytecode or `timed` changes.
+	inline InsnProfile& start_profile(Function& func, bool timed) {
+		const size_t size = func.bytecode().size();
+		auto& profile = func.profile;
+		if (!profile || profile->counts.size() != size || profile->cycles.empty() == timed) {
+			profile = std::make_shared<InsnProfile>();
+			profile->counts.assign(size, 0);
+			if (timed)
+				profile->cycles.assign(size, 0);
+		}
+		return *profile;
+	}
+
 	inline local_t new_temp_var(Function& appender) {
 		if (appender.locals.size() >= INT16_MAX - 2)
 			throw std::runtime_error("More than 32766 variables are required for one method. This is not supported.");
@@ -0,0 +1,131 @@
+#pragma once
+/**
+ * Builtins called through the `CallBuiltin` instruction.
+ * The front ends emit it for calls of these names, and the interpreter
+ * calls the C implementation directly while the name still resolves to
+ * the builtin object seen at compile time.
+ * Also home of the iterator `for` loops use for ranges, see `GetIter`.
+ */
+#include <string>
+#include <enum.h>
+#include <Python.h>
+
+namespace yapyjit {
+	// Specialized builtins, spelled as in `builtin_name`.
+	BETTER_ENUM(BuiltinId, uint8_t, Len, IsInstance, Abs, Min, Max, Int, Float, Range, Iter)
+
+	inline const char* builtin_name(BuiltinId id) {
+		static const char* const names[] = { "len", "isinstance", "abs", "min", "max", "int", "float", "range", "iter" };
+		return names[id._to_integral()];
+	}
+
+	// Builtin that calls of `name` are specialized to, if any.
+	inline better_enums::optional<BuiltinId> builtin_id(const std::string& name) {
+		auto id = BuiltinId::_from_string_nocase_nothrow(name.c_str());
+		if (id && name == builtin_name(*id))
+			return id;
+		return {};
+	}
+
+	// Current object of the builtin (borrowed), nullptr if it is missing.
+	inline PyObject* builtin_object(BuiltinId id) {
+		auto blt = PyEval_GetBuiltins();
+		return blt ? PyDict_GetItemString(blt, builtin_name(id)) : nullptr;
+	}
+
+	// Extreme of the arguments, for min and max called with two or more positional arguments.
+	inline PyObject* _builtin_minmax(PyObject* const* argv, int n, int op) {
+		PyObject* result = argv[0];
+		for (int i = 1; i < n; i++) {
+			int r = PyObject_RichCompareBool(argv[i], result, op);
+			if (r < 0)
+				return nullptr;
+			if (r)
+				result = argv[i];
+		}
+		Py_INCREF(result);
+		return result;
+	}
+
+	/**
+	 * Calls builtin `id`, whose object is `fn`, with `n` positional arguments.
+	 * Shapes without a fast path (other arities, keyword forms) go through vectorcall on `fn`.
+	 * Returns a new reference, or nullptr with an exception set.
+	 */
+	inline PyObject* call_builtin(uint8_t id, PyObject* fn, PyObject* const* argv, int n) {
+		switch (id) {
+		case BuiltinId::Len:
+			if (n != 1)
+				break;
+			if (PyList_CheckExact(argv[0]) || PyTuple_CheckExact(argv[0]))
+				return PyLong_FromSsize_t(Py_SIZE(argv[0]));
+			else {
+				Py_ssize_t len = PyObject_Length(argv[0]);
+				return len < 0 ? nullptr : PyLong_FromSsize_t(len);
+			}
+		case BuiltinId::IsInstance:
+			if (n != 2)
+				break;
+			if ((PyObject*)Py_TYPE(argv[0]) == argv[1])
+				Py_RETURN_TRUE;
+			else {
+				int r = PyObject_IsInstance(argv[0], argv[1]);
+				return r < 0 ? nullptr : PyBool_FromLong(r);
+			}
+		case BuiltinId::Abs:
+			if (n != 1)
+				break;
+			return PyNumber_Absolute(argv[0]);
+		case BuiltinId::Min:
+		case BuiltinId::Max:
+			if (n < 2)
+				break;
+			return _builtin_minmax(argv, n, id == BuiltinId::Min ? Py_LT : Py_GT);
+		case BuiltinId::Int:
+			if (n != 1)
+				break;
+			if (PyLong_CheckExact(argv[0])) {
+				Py_INCREF(argv[0]);
+				return argv[0];
+			}
+			return PyNumber_Long(argv[0]);
+		case BuiltinId::Float:
+			if (n != 1)
+				break;
+			if (PyFloat_CheckExact(argv[0])) {
+				Py_INCREF(argv[0]);
+				return argv[0];
+			}
+			return PyNumber_Float(argv[0]);
+		case BuiltinId::Iter:
+			if (n != 1)
+				break;
+			return PyObject_GetIter(argv[0]);
+		}
+		return _PyObject_Vectorcall(fn, argv, n, nullptr);
+	}
+
+	/**
+	 * Iterator of a `for` loop over a range whose bounds fit in a long long.
+	 * `IterNext` advances it natively, and boxes the value only if the loop target is read.
+	 */
+	struct RangeCounter {
+		PyObject_HEAD
+		long long start, step;
+		Py_ssize_t index, len;
+
+		long long at(Py_ssize_t i) const {
+			// Unsigned arithmetic, values between start and stop never overflow.
+			return (long long)((unsigned long long)start + (unsigned long long)i * (unsigned long long)step);
+		}
+	};
+	PyObject* range_counter_next(RangeCounter* self);
+
+	// The type is created once per interpreter, its instances are told apart by their slots.
+	inline bool is_range_counter(PyObject* obj) {
+		return Py_TYPE(obj)->tp_iternext == (iternextfunc)range_counter_next;
+	}
+
+	// Iterator for a loop over `iterable` (`GetIter`), a `RangeCounter` for ranges where possible.
+	PyObject* loop_iter(PyObject* iterable);
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <ir.h>
+
+namespace yapyjit {
+	// A jitted function as seen by the inliner.
+	struct InlineCallee {
+		Function* func;
+		const std::map<std::string, int>* argid_lookup;  // Parameter name to 0-based index.
+		const std::vector<PyObject*>* defaults;  // Per parameter, nullptr if required.
+	};
+
+	// Returns whether `obj` is a jitted function and fills `callee` if so.
+	typedef bool (*inline_resolver_t)(PyObject* obj, InlineCallee& callee);
+
+	struct InlineBudget {
+		size_t max_callee_size = 512;  // Bytes of LP3 in a single callee.
+		size_t max_growth = 8192;  // Bytes of LP3 spliced into one caller in total.
+		int max_depth = 3;
+	};
+
+	/**
+	 * Splices the bytecode of jitted callees into `caller` at `Call` sites
+	 * whose function is loaded from a global or a closure variable.
+	 * Each inlined body is guarded by `GuardIs` on the callee object and
+	 * falls back to the original call when the binding has changed.
+	 * Recursive calls are not inlined.
+	 * The caller must not be executing. Returns the number of inlined sites.
+	 */
+	int inline_calls(Function& caller, inline_resolver_t resolver, const InlineBudget& budget = InlineBudget());
+};
@@ -1,10 +1,14 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <type_traits>
 #include <iostream>
 #include <algorithm>
 #include <exc_helper.h>
 #include <ir.h>
+#include <ir_builtins.h>
 #include <ir_interpret_trace.h>
+#include <gen_icache.h>
 
 #define READ(t) (*(t*)p); p += sizeof(t)
 #define LOCAL() READ(local_t)
@@ -27,6 +31,19 @@
     case InsnTag::BitXor: goto BitXor; \
     case InsnTag::BitAnd: goto BitAnd; \
     case InsnTag::FloorDiv: goto FloorDiv; \
+    case InsnTag::InplaceAdd: goto InplaceAdd; \
+    case InsnTag::InplaceSub: goto InplaceSub; \
+    case InsnTag::InplaceMult: goto InplaceMult; \
+    case InsnTag::InplaceMatMult: goto InplaceMatMult; \
+    case InsnTag::InplaceDiv: goto InplaceDiv; \
+    case InsnTag::InplaceMod: goto InplaceMod; \
+    case InsnTag::InplacePow: goto InplacePow; \
+    case InsnTag::InplaceLShift: goto InplaceLShift; \
+    case InsnTag::InplaceRShift: goto InplaceRShift; \
+    case InsnTag::InplaceBitOr: goto InplaceBitOr; \
+    case InsnTag::InplaceBitXor: goto InplaceBitXor; \
+    case InsnTag::InplaceBitAnd: goto InplaceBitAnd; \
+    case InsnTag::InplaceFloorDiv: goto InplaceFloorDiv; \
     case InsnTag::Invert: goto Invert; \
     case InsnTag::Not: goto Not; \
     case InsnTag::UAdd: goto UAdd; \
@@ -47,26 +64,40 @@
     case InsnTag::DelItem: goto DelItem; \
     case InsnTag::ErrorProp: goto ErrorProp; \
     case InsnTag::ClearErrorCtx: goto ClearErrorCtx; \
+    case InsnTag::GetIter: goto GetIter; \
     case InsnTag::IterNext: goto IterNext; \
     case InsnTag::Jump: goto Jump; \
     case InsnTag::JumpTruthy: goto JumpTruthy; \
     case InsnTag::LoadAttr: goto LoadAttr; \
+    case InsnTag::LoadMethod: goto LoadMethod; \
     case InsnTag::LoadClosure: goto LoadClosure; \
+    case InsnTag::LoadCell: goto LoadCell; \
     case InsnTag::LoadGlobal: goto LoadGlobal; \
     case InsnTag::LoadItem: goto LoadItem; \
     case InsnTag::Move: goto Move; \
     case InsnTag::Raise: goto Raise; \
     case InsnTag::Return: goto Return; \
+    case InsnTag::Yield: goto Yield; \
     case InsnTag::StoreAttr: goto StoreAttr; \
     case InsnTag::StoreClosure: goto StoreClosure; \
+    case InsnTag::StoreCell: goto StoreCell; \
     case InsnTag::StoreGlobal: goto StoreGlobal; \
     case InsnTag::StoreItem: goto StoreItem; \
+    case InsnTag::ListAppend: goto ListAppend; \
+    case InsnTag::SetAdd: goto SetAdd; \
+    case InsnTag::MapAdd: goto MapAdd; \
     case InsnTag::BuildDict: goto BuildDict; \
     case InsnTag::BuildList: goto BuildList; \
     case InsnTag::BuildSet: goto BuildSet; \
     case InsnTag::BuildTuple: goto BuildTuple; \
     case InsnTag::Call: goto Call; \
+    case InsnTag::CallEx: goto CallEx; \
+    case InsnTag::CallForward: goto CallForward; \
+    case InsnTag::CallMethod: goto CallMethod; \
+    case InsnTag::CallBuiltin: goto CallBuiltin; \
     case InsnTag::Destruct: goto Destruct; \
+    case InsnTag::MakeFunction: goto MakeFunction; \
+    case InsnTag::GuardIs: goto GuardIs; \
     case InsnTag::Prolog: goto Prolog; \
     case InsnTag::Epilog: goto Epilog; \
     case InsnTag::TraceHead: goto TraceHead; \
@@ -74,22 +105,48 @@
 } while (0)
 
 #define COMMON_DECODE do { \
+    ++executed; \
     if constexpr (traced) \
     { \
-        for (auto tracer : ir_trace_chain) \
+        for (auto tracer : *trace_chain) \
             tracer->trace(next_insn_tag, p, func, locals); \
     } \
+    if constexpr (profiled) \
+    { \
+        /* `Return` and errors jump to `Epilog` from elsewhere, it is the last instruction. */ \
+        const ptrdiff_t offset = next_insn_tag == InsnTag::Epilog ? epilog_offset : p - 1 - start; \
+        ++profile->counts[offset]; \
+        if (timed) \
+        { \
+            const uint64_t now = read_tsc(); \
+            profile->cycles[last_offset] += now - last_tsc; \
+            last_tsc = now; \
+            last_offset = offset; \
+        } \
+    } \
 } while (0)
 
 #define COMMON_EXEC do { \
 } while (0)
 
+// Charges the time since the last instruction to it before leaving.
+#define PROFILE_LEAVE do { \
+    if constexpr (profiled) \
+    { \
+        if (timed) \
+            profile->cycles[last_offset] += read_tsc() - last_tsc; \
+    } \
+} while (0)
+
 #define COMMON_ARG(arg) do { \
 } while (0)
 
 #define GROUP_BINOP_EXEC do { \
 } while (0)
 
+#define GROUP_INPLACEOP_EXEC do { \
+} while (0)
+
 #define GROUP_UNARYOP_EXEC do { \
 } while (0)
 
@@ -99,6 +156,21 @@
 #define GROUP_BUILD_EXEC do { \
 } while (0)
 
+// Runs a call of `target` in place and continues in it if it is self-recursive, see `SelfCallStack`.
+// The callee and the arguments must stay alive in the registers of the caller.
+#define ENTER_SELF_CALL(target, args, nargs, kwnames) do { \
+    if (!traced && !frame) { \
+        int entered = self_calls.enter(target, start, args, nargs, kwnames, locals, p, dst); \
+        if (entered < 0) \
+            goto OnError; \
+        if (entered) { \
+            p = start; \
+            LP3_FETCH(); \
+            LP3_DISPATCH(); \
+        } \
+    } \
+} while (0)
+
 namespace yapyjit {
     inline PyObject* write_ref(std::vector<PyObject*>& place, size_t idx, PyObject* target)
     {
@@ -123,12 +195,60 @@ namespace yapyjit {
             return nullptr;
         return write_ref_full(place, idx, target ? Py_True : Py_False);
     }
+    // `_PyObject_GetMethod`: 1 with the unbound method in `method`, or 0 with the attribute (null on errors).
+    inline int get_method(PyObject* obj, PyObject* name, PyObject** method)
+    {
+#if PY_VERSION_HEX >= 0x03090000
+        return _PyObject_GetMethod(obj, name, method);
+#else
+        // Not declared before 3.9. Only method descriptors of the type that the instance does not shadow are unbound.
+        auto type = Py_TYPE(obj);
+        PyObject* descr = type->tp_getattro == PyObject_GenericGetAttr ? _PyType_Lookup(type, name) : nullptr;
+        if (descr && PyType_HasFeature(Py_TYPE(descr), Py_TPFLAGS_METHOD_DESCRIPTOR)) {
+            PyObject** dictptr = _PyObject_GetDictPtr(obj);
+            PyObject* shadow = dictptr && *dictptr ? PyDict_GetItemWithError(*dictptr, name) : nullptr;
+            if (!shadow && !PyErr_Occurred()) {
+                Py_INCREF(descr);
+                *method = descr;
+                return 1;
+            }
+            if (!shadow)
+                return 0;
+        }
+        *method = PyObject_GetAttr(obj, name);
+        return 0;
+#endif
+    }
+    // Argument vector of a call, on the stack for short calls so that the interpreter frame stays small.
+    class CallArgs {
+        PyObject* small[8];
+        std::unique_ptr<PyObject*[]> large;
+    public:
+        PyObject** reserve(size_t n) {
+            if (n <= std::size(small))
+                return small;
+            large.reset(new PyObject*[n]);
+            return large.get();
+        }
+    };
 // #pragma optimize("", off)
-    template <bool traced>
-    PyObject* ir_interpret_base(uint8_t* p, std::vector<PyObject*> locals, Function& func) {
+    template <bool traced, bool profiled = false>
+    PyObject* ir_interpret_base(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame, RuntimeStats* stats) {
         uint8_t next_insn_tag;
-        uint8_t* start = p;
+        uint64_t executed = 0;  // Added to `stats` on return.
+        std::list<Tracer*>* trace_chain = traced ? &ir_trace_chain() : nullptr;
+        uint8_t* start = func.bytecode().data();
+        // Counting state of `profiled`, the time stamp is that of the start of the instruction at `last_offset`.
+        // The counters are held in case a callee starts new ones, they are then counted into the old ones.
+        std::conditional_t<profiled, std::shared_ptr<InsnProfile>, InsnProfile*> profile = nullptr;
+        if constexpr (profiled)
+            profile = func.profile;
+        const bool timed = profiled && !profile->cycles.empty();
+        const ptrdiff_t epilog_offset = func.bytecode().size() - 1;
+        ptrdiff_t last_offset = p - start;
+        uint64_t last_tsc = timed ? read_tsc() : 0;
         PyObject* ret = Py_None;
+        SelfCallStack self_calls;
         LP3_FETCH();
         LP3_DISPATCH();
         OnError: {
@@ -141,7 +261,7 @@ namespace yapyjit {
             {
                 ret = nullptr;
                 next_insn_tag = InsnTag::Epilog;
-                goto Epilog;
+                goto EpilogReturn;
             }
             else
             {
@@ -155,14 +275,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Add(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), '+', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -171,14 +293,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Subtract(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_subtract), '-', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -187,14 +311,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Multiply(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<SEQ_FALLBACK_REPEAT, NB_SLOT(nb_multiply), '*', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -203,14 +329,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_MatrixMultiply(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_matrix_multiply), '@', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -219,14 +347,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_TrueDivide(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_true_divide), '/', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -235,14 +365,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Remainder(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_remainder), '%', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -251,6 +383,7 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            p += sizeof(icache_t<2>*);  // Not cached, `PyNumber_Power` takes a third argument.
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
@@ -267,14 +400,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Lshift(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_lshift), '<', '<'>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -283,14 +418,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Rshift(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_rshift), '>', '>'>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -299,14 +436,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Or(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_or), '|', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -315,14 +454,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_Xor(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_xor), '^', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -331,14 +472,16 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_And(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_and), '&', 0>(cache, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -347,14 +490,270 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
 
-            if (!(write_ref(locals, dst, PyNumber_FloorDivide(locals[left], locals[right]))))
+            if (!(write_ref(locals, dst, nb_binop_icached<0, NB_SLOT(nb_floor_divide), '/', '/'>(cache, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+        InplaceAdd: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (dst == left && right != left && PyUnicode_CheckExact(locals[left]) && PyUnicode_CheckExact(locals[right])) {
+                // `s += t`: the string is resized in place if the register holds the only reference.
+                PyObject* str = locals[dst];
+                locals[dst] = Py_None;
+                Py_INCREF(Py_None);
+                PyUnicode_Append(&str, locals[right]);
+                if (!write_ref(locals, dst, str))
+                    goto OnError;
+            }
+            else if (!(write_ref(locals, dst, nb_inplace_icached<SEQ_FALLBACK_CONCAT, NB_SLOT(nb_add), NB_SLOT(nb_inplace_add), '+', 0>(cache, PyNumber_InPlaceAdd, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceSub: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_subtract), NB_SLOT(nb_inplace_subtract), '-', 0>(cache, PyNumber_InPlaceSubtract, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceMult: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<SEQ_FALLBACK_REPEAT, NB_SLOT(nb_multiply), NB_SLOT(nb_inplace_multiply), '*', 0>(cache, PyNumber_InPlaceMultiply, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceMatMult: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_matrix_multiply), NB_SLOT(nb_inplace_matrix_multiply), '@', 0>(cache, PyNumber_InPlaceMatrixMultiply, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceDiv: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_true_divide), NB_SLOT(nb_inplace_true_divide), '/', 0>(cache, PyNumber_InPlaceTrueDivide, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceMod: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_remainder), NB_SLOT(nb_inplace_remainder), '%', 0>(cache, PyNumber_InPlaceRemainder, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplacePow: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            p += sizeof(icache_t<2>*);  // Not cached, `PyNumber_InPlacePower` takes a third argument.
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, PyNumber_InPlacePower(locals[left], locals[right], Py_None))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceLShift: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_lshift), NB_SLOT(nb_inplace_lshift), '<', '<'>(cache, PyNumber_InPlaceLshift, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceRShift: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_rshift), NB_SLOT(nb_inplace_rshift), '>', '>'>(cache, PyNumber_InPlaceRshift, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceBitOr: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_or), NB_SLOT(nb_inplace_or), '|', 0>(cache, PyNumber_InPlaceOr, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceBitXor: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_xor), NB_SLOT(nb_inplace_xor), '^', 0>(cache, PyNumber_InPlaceXor, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceBitAnd: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_and), NB_SLOT(nb_inplace_and), '&', 0>(cache, PyNumber_InPlaceAnd, locals[left], locals[right]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+
+        InplaceFloorDiv: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+
+            if (!(write_ref(locals, dst, nb_inplace_icached<0, NB_SLOT(nb_floor_divide), NB_SLOT(nb_inplace_floor_divide), '/', '/'>(cache, PyNumber_InPlaceFloorDivide, locals[left], locals[right]))))
                 goto OnError;
             LP3_DISPATCH();
         }
@@ -657,6 +1056,19 @@ namespace yapyjit {
             PyErr_SetExcInfo(nullptr, nullptr, nullptr);
             LP3_DISPATCH();
         }
+        GetIter: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            if (!write_ref(locals, dst, loop_iter(locals[src])))
+                goto OnError;
+            LP3_DISPATCH();
+        }
         IterNext: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -667,13 +1079,33 @@ namespace yapyjit {
             COMMON_ARG(iter_fail_to);
             LP3_FETCH();
             COMMON_EXEC;
-            if (!write_ref(locals, dst, PyIter_Next(locals[iter])))
+            PyObject* value;
+            if (is_range_counter(locals[iter])) {
+                auto counter = reinterpret_cast<RangeCounter*>(locals[iter]);
+                if (counter->index == counter->len)
+                    value = nullptr;
+                else if (dst > 0)
+                    value = PyLong_FromLongLong(counter->at(counter->index++));
+                else {
+                    // The element is not read, it is not boxed. The tail is shared to keep a single dispatch.
+                    counter->index++;
+                    goto IterNextDone;
+                }
+            }
+            else
+                value = PyIter_Next(locals[iter]);
+            if (!value)
             {
                 if (PyErr_Occurred())
                     goto OnError;
                 p = start + iter_fail_to;
                 LP3_FETCH();
             }
+            else if (dst > 0)
+                write_ref(locals, dst, value);
+            else
+                Py_DECREF(value);
+        IterNextDone:
             LP3_DISPATCH();
         }
         Jump: {
@@ -722,6 +1154,33 @@ namespace yapyjit {
                 goto OnError;
             LP3_DISPATCH();
         }
+        LoadMethod: {
+            COMMON_DECODE;
+            local_t meth = READ(local_t);
+            local_t self = READ(local_t);
+            local_t obj = READ(local_t);
+            PyObject* name = READ(PyObject*);
+            COMMON_ARG(meth);
+            COMMON_ARG(self);
+            COMMON_ARG(obj);
+            COMMON_ARG(name);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            // Like `LOAD_METHOD`, with None in `meth` and the attribute in `self` if it is not a method.
+            PyObject* method = nullptr;
+            PyObject* target = locals[obj];
+            if (get_method(target, name, &method)) {
+                write_ref_full(locals, self, target);
+                write_ref(locals, meth, method);
+            }
+            else {
+                if (!write_ref(locals, self, method))
+                    goto OnError;
+                write_ref_full(locals, meth, Py_None);
+            }
+            LP3_DISPATCH();
+        }
         LoadClosure: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -734,6 +1193,22 @@ namespace yapyjit {
             write_ref_full(locals, dst, PyCell_GET((PyTuple_GET_ITEM(func.deref_ns.borrow(), closure))));
             LP3_DISPATCH();
         }
+        LoadCell: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t cell = READ(local_t);
+            char* name = CSTR();
+            COMMON_ARG(dst);
+            COMMON_ARG(cell);
+            COMMON_ARG(name);
+            LP3_FETCH();
+            COMMON_EXEC;
+            if (!write_ref_full(locals, dst, PyCell_GET(locals[cell]))) {
+                PyErr_Format(PyExc_NameError, "cannot access free variable '%s' where it is not associated with a value in enclosing scope", name);
+                goto OnError;
+            }
+            LP3_DISPATCH();
+        }
         LoadGlobal: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -794,7 +1269,21 @@ namespace yapyjit {
             ret = locals[src];
             COMMON_EXEC;
             next_insn_tag = InsnTag::Epilog;
-            goto Epilog;
+            goto EpilogReturn;
+        }
+        Yield: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            COMMON_ARG(src);
+            COMMON_EXEC;
+            // Suspends: registers stay alive in `frame->locals` until it is resumed at the next instruction.
+            frame->resume = static_cast<iaddr_t>(p - start);
+            ret = locals[src];
+            Py_INCREF(ret);
+            if (stats)
+                stats->instructions += executed;
+            PROFILE_LEAVE;
+            return ret;
         }
         StoreAttr: {
             COMMON_DECODE;
@@ -821,6 +1310,17 @@ namespace yapyjit {
             PyCell_Set(PyTuple_GET_ITEM(func.deref_ns.borrow(), closure), locals[src]);
             LP3_DISPATCH();
         }
+        StoreCell: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            local_t cell = READ(local_t);
+            COMMON_ARG(src);
+            COMMON_ARG(cell);
+            LP3_FETCH();
+            COMMON_EXEC;
+            PyCell_Set(locals[cell], locals[src]);
+            LP3_DISPATCH();
+        }
         StoreGlobal: {
             COMMON_DECODE;
             local_t src = READ(local_t);
@@ -849,6 +1349,47 @@ namespace yapyjit {
                 goto OnError;
             LP3_DISPATCH();
         }
+        ListAppend: {
+            COMMON_DECODE;
+            local_t list = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(list);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            if (-1 == PyList_Append(locals[list], locals[src]))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+        SetAdd: {
+            COMMON_DECODE;
+            local_t set = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(set);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            if (-1 == PySet_Add(locals[set], locals[src]))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+        MapAdd: {
+            COMMON_DECODE;
+            local_t map = READ(local_t);
+            local_t key = READ(local_t);
+            local_t value = READ(local_t);
+            COMMON_ARG(map);
+            COMMON_ARG(key);
+            COMMON_ARG(value);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            if (-1 == PyDict_SetItem(locals[map], locals[key], locals[value]))
+                goto OnError;
+            LP3_DISPATCH();
+        }
         BuildDict: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -922,36 +1463,173 @@ namespace yapyjit {
             local_t func = READ(local_t);
             uint8_t args_sz = READ(uint8_t);
             uint8_t kwargs_sz = READ(uint8_t);
+            callsite_t* site = READ(callsite_t*);
             COMMON_ARG(dst);
             COMMON_ARG(func);
-            auto argv = PyTuple_New(args_sz);
-            for (int i = 0; i < args_sz; i++) {
-                local_t v = LOCAL();
-                Py_INCREF(locals[v]);
-                PyTuple_SET_ITEM(argv, i, locals[v]);
-            }
-            PyObject* kwargv = nullptr;
-            if (kwargs_sz)
+            COMMON_ARG(site);
             {
-                kwargv = PyDict_New();
+                // Vectorcall with one slot free in front, so bound methods prepend `self` in place.
+                CallArgs buffer;
+                PyObject** argv = buffer.reserve(args_sz + kwargs_sz + 1);
+                for (int i = 0; i < args_sz; i++) {
+                    local_t v = LOCAL();
+                    argv[i + 1] = locals[v];
+                }
+                if (kwargs_sz && !site->kwnames && !(site->kwnames = callsite_kwnames(p, kwargs_sz)))
+                    goto OnError;
                 for (int i = 0; i < kwargs_sz; i++) {
-                    char* k = CSTR(); local_t v = LOCAL();
-                    PyDict_SetItemString(kwargv, k, locals[v]);
+                    while (*p++);  // The name, already in `site->kwnames`.
+                    local_t v = LOCAL();
+                    argv[args_sz + i + 1] = locals[v];
                 }
+                LP3_FETCH();
+                PyObject* kwnames = kwargs_sz ? site->kwnames : nullptr;
+                ENTER_SELF_CALL(locals[func], argv + 1, args_sz, kwnames);
+                if (!write_ref(locals, dst, call_function(
+                    locals[func], argv + 1, args_sz | PY_VECTORCALL_ARGUMENTS_OFFSET, kwnames
+                )))
+                    goto OnError;
             }
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        CallEx: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t func = READ(local_t);
+            local_t args = READ(local_t);
+            local_t kwargs = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(func);
+            COMMON_ARG(args);
+            COMMON_ARG(kwargs);
             LP3_FETCH();
-            /*PyObject_Print(locals[func], stdout, 0);
-            std::cout << ' ';
-            PyObject_Print(argv, stdout, 0);
-            std::cout << std::endl;*/
-            if (!write_ref(locals, dst, PyObject_Call(locals[func], argv, kwargv)))
+            COMMON_EXEC;
             {
+                // Like `CALL_FUNCTION_EX`, `args` is any iterable and `kwargs` any mapping or None.
+                PyObject* argv = locals[args];
+                if (PyTuple_CheckExact(argv))
+                    Py_INCREF(argv);
+                else if (!(argv = PySequence_Tuple(argv)))
+                    goto OnError;
+                PyObject* kwargv = nullptr;
+                if (locals[kwargs] != Py_None) {
+                    kwargv = PyDict_New();
+                    if (!kwargv || PyDict_Merge(kwargv, locals[kwargs], 1) < 0) {
+                        Py_DECREF(argv); Py_XDECREF(kwargv);
+                        goto OnError;
+                    }
+                }
+                PyObject* result = PyObject_Call(locals[func], argv, kwargv);
                 Py_DECREF(argv); Py_XDECREF(kwargv);
-                goto OnError;
+                if (!write_ref(locals, dst, result))
+                    goto OnError;
             }
-            Py_DECREF(argv); Py_XDECREF(kwargv);
+            LP3_DISPATCH();
+        }
+        CallForward: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t func = READ(local_t);
+            local_t args = READ(local_t);
+            local_t kwnames = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(func);
+            COMMON_ARG(args);
+            COMMON_ARG(kwnames);
+            LP3_FETCH();
             COMMON_EXEC;
-            
+            {
+                // Keyword values follow the positional ones in `args`, see `Function::forwards`.
+                PyObject* kwnames_obj = locals[kwnames] == Py_None ? nullptr : locals[kwnames];
+                Py_ssize_t nkw = kwnames_obj ? PyTuple_GET_SIZE(kwnames_obj) : 0;
+                PyObject* argv = locals[args];
+                if (!write_ref(locals, dst, call_function(
+                    locals[func], &PyTuple_GET_ITEM(argv, 0), PyTuple_GET_SIZE(argv) - nkw, kwnames_obj
+                )))
+                    goto OnError;
+            }
+            LP3_DISPATCH();
+        }
+        CallMethod: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t meth = READ(local_t);
+            uint8_t args_sz = READ(uint8_t);
+            uint8_t kwargs_sz = READ(uint8_t);
+            callsite_t* site = READ(callsite_t*);
+            COMMON_ARG(dst);
+            COMMON_ARG(meth);
+            COMMON_ARG(site);
+            {
+                // The first argument is the `self` of `LoadMethod`, with one slot free in front as in `Call`.
+                CallArgs buffer;
+                PyObject** argv = buffer.reserve(args_sz + kwargs_sz + 1);
+                for (int i = 0; i < args_sz; i++) {
+                    local_t v = LOCAL();
+                    argv[i + 1] = locals[v];
+                }
+                if (kwargs_sz && !site->kwnames && !(site->kwnames = callsite_kwnames(p, kwargs_sz)))
+                    goto OnError;
+                for (int i = 0; i < kwargs_sz; i++) {
+                    while (*p++);  // The name, already in `site->kwnames`.
+                    local_t v = LOCAL();
+                    argv[args_sz + i + 1] = locals[v];
+                }
+                LP3_FETCH();
+                PyObject* kwnames = kwargs_sz ? site->kwnames : nullptr;
+                PyObject* callee = locals[meth];
+                PyObject** first = argv + 1;
+                size_t nargs = args_sz;
+                if (callee == Py_None) {
+                    callee = *first++;
+                    nargs--;
+                }
+                ENTER_SELF_CALL(callee, first, nargs, kwnames);
+                if (!write_ref(locals, dst, call_function(callee, first, nargs | PY_VECTORCALL_ARGUMENTS_OFFSET, kwnames)))
+                    goto OnError;
+            }
+            COMMON_EXEC;
+
+            LP3_DISPATCH();
+        }
+        CallBuiltin: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            uint8_t builtin = READ(uint8_t);
+            PyObject* name = READ(PyObject*);
+            PyObject* expected = READ(PyObject*);
+            uint8_t args_sz = READ(uint8_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(builtin);
+            COMMON_ARG(name);
+            COMMON_ARG(expected);
+            CallArgs buffer;
+            PyObject** argv = buffer.reserve(args_sz);
+            for (int i = 0; i < args_sz; i++) {
+                local_t v = LOCAL();
+                argv[i] = locals[v];
+            }
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            // Guard: `name` (interned) still resolves to the builtin, unless it is None for implicit calls.
+            PyObject* target = expected;
+            if (name != Py_None) {
+                target = PyDict_GetItemWithError(func.globals_ns.borrow(), name);
+                if (!target && !PyErr_Occurred())
+                    target = PyDict_GetItemWithError(PyEval_GetBuiltins(), name);
+                if (!target) {
+                    if (!PyErr_Occurred())
+                        PyErr_Format(PyExc_NameError, "name '%U' is not defined", name);
+                    goto OnError;
+                }
+            }
+            if (!write_ref(locals, dst, target == expected
+                ? call_builtin(builtin, expected, argv, args_sz)
+                : _PyObject_Vectorcall(target, argv, args_sz, nullptr)))
+                goto OnError;
             LP3_DISPATCH();
         }
         Destruct: {
@@ -974,6 +1652,39 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        MakeFunction: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            PyObject* proto = READ(PyObject*);
+            local_t defaults = READ(local_t);
+            local_t kwdefaults = READ(local_t);
+            local_t closure = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(proto);
+            COMMON_ARG(defaults);
+            COMMON_ARG(kwdefaults);
+            COMMON_ARG(closure);
+            LP3_FETCH();
+            COMMON_EXEC;
+            if (!(write_ref(locals, dst, make_function(proto, locals[defaults], locals[kwdefaults], locals[closure]))))
+                goto OnError;
+            LP3_DISPATCH();
+        }
+        GuardIs: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            PyObject* expected = READ(PyObject*);
+            iaddr_t fail_to = READ(iaddr_t);
+            COMMON_ARG(src);
+            COMMON_ARG(expected);
+            COMMON_ARG(fail_to);
+            if (locals[src] != expected)
+                p = start + fail_to;
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            LP3_DISPATCH();
+        }
         Prolog: {
             COMMON_DECODE;
             LP3_FETCH();
@@ -982,12 +1693,29 @@ namespace yapyjit {
             LP3_DISPATCH();
         }
         Epilog: {
+            // Reached at the end of the code, `Return` and errors set `ret` first. So `ret` is not carried over
+            // dispatches, which makes optimizing builds of the interpreter very slow, as for `SelfCallStack`.
+            ret = Py_None;
+        EpilogReturn:
             COMMON_DECODE;
             // LP3_FETCH();
             COMMON_EXEC;
             Py_XINCREF(ret);
-            for (size_t i = 1; i < locals.size(); i++)
+            for (size_t i = func.nborrowed + 1; i < locals.size(); i++)
                 Py_DECREF(locals[i]);
+            if (!ret && stats)
+                stats->exceptions++;
+            if (auto call = self_calls.leave(locals)) {
+                // Back in the caller of a self-recursive call, an error is raised at its `Call`.
+                p = call->resume;
+                next_insn_tag = p[-1];
+                if (!write_ref(locals, call->dst, ret))
+                    goto OnError;
+                LP3_DISPATCH();
+            }
+            if (stats)
+                stats->instructions += executed;
+            PROFILE_LEAVE;
             return ret;
         }
         TraceHead: {
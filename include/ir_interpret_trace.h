@@ -2,19 +2,22 @@
 #include <list>
 namespace yapyjit {
 	class Tracer;
-	extern std::list<Tracer*> ir_trace_chain;
+	// Tracers of the current interpreter.
+	std::list<Tracer*>& ir_trace_chain();
 	class Tracer {
 	protected:
+		std::list<Tracer*>* chain = nullptr;
 		std::list<Tracer*>::const_iterator chain_place;
 	public:
-		Tracer(): chain_place(ir_trace_chain.end()) {}
+		Tracer() = default;
 		void add_to_chain() {
-			ir_trace_chain.push_front(this);
-			chain_place = ir_trace_chain.begin();
+			chain = &ir_trace_chain();
+			chain->push_front(this);
+			chain_place = chain->begin();
 		}
 		void remove_from_chain() {
-			ir_trace_chain.erase(chain_place);
-			chain_place = ir_trace_chain.end();
+			chain->erase(chain_place);
+			chain = nullptr;
 		}
 		virtual void trace(uint8_t insn_tag, uint8_t* p, Function& func, std::vector<PyObject*>& locals) = 0;
 		virtual ~Tracer() = default;
@@ -0,0 +1,18 @@
+#pragma once
+#include <ir.h>
+
+namespace yapyjit {
+	/**
+	 * Reference count optimizations on LP3 bytecode.
+	 * 1. A `Move` from a register that is defined by the previous instruction
+	 *    and read nowhere else is removed, and the definition writes the
+	 *    destination directly. This saves an INCREF/DECREF pair per execution.
+	 * 2. Leading argument registers that are never written borrow the references
+	 *    of the caller (see `Function::nborrowed`), saving a pair per argument per call.
+	 *    Not done for generator bodies, whose frames outlive the call creating them.
+	 * 3. `IterNext` into a register read nowhere discards the element (destination -1),
+	 *    so loops over ranges do not box their counter.
+	 * Returns the number of refcount operations removed from the code.
+	 */
+	int elide_refcounts(Function& func);
+};
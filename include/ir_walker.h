@@ -0,0 +1,159 @@
+#pragma once
+/**
+ * Generic access to operands of LP3 instructions, for passes that rewrite bytecode.
+ * The format table is generated by `python -m yapyjit_tools cppgen_insn_format`.
+ */
+#include <ir.h>
+
+namespace yapyjit {
+    enum class OperandKind : uint8_t {
+        End,
+        Local,
+        DefLocal,
+        CellIdx,
+        IAddr,
+        CStr,
+        PyObj,
+        ByteCache,
+        Byte,
+        LongCache,
+        ICache2,
+        CallSite,
+        VecLocal,
+        VecDefLocal,
+        StrMapLocal,
+    };
+
+    const OperandKind insn_formats[][6] = {
+        /* Add */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Sub */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Mult */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* MatMult */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Div */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Mod */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Pow */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* LShift */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* RShift */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* BitOr */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* BitXor */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* BitAnd */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* FloorDiv */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceAdd */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceSub */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceMult */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceMatMult */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceDiv */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceMod */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplacePow */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceLShift */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceRShift */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceBitOr */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceBitXor */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceBitAnd */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* InplaceFloorDiv */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::ICache2, OperandKind::End },
+        /* Invert */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* Not */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* UAdd */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* USub */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* Eq */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* NotEq */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* Lt */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* LtE */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* Gt */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* GtE */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* Is */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* IsNot */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* In */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* NotIn */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* CheckErrorType */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::IAddr, OperandKind::End },
+        /* Constant */ { OperandKind::DefLocal, OperandKind::PyObj, OperandKind::End },
+        /* DelAttr */ { OperandKind::Local, OperandKind::CStr, OperandKind::End },
+        /* DelItem */ { OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* ErrorProp */ { OperandKind::End },
+        /* ClearErrorCtx */ { OperandKind::End },
+        /* GetIter */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* IterNext */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::IAddr, OperandKind::End },
+        /* Jump */ { OperandKind::IAddr, OperandKind::End },
+        /* JumpTruthy */ { OperandKind::Local, OperandKind::IAddr, OperandKind::End },
+        /* LoadAttr */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::CStr, OperandKind::End },
+        /* LoadMethod */ { OperandKind::DefLocal, OperandKind::DefLocal, OperandKind::Local, OperandKind::PyObj, OperandKind::End },
+        /* LoadClosure */ { OperandKind::DefLocal, OperandKind::CellIdx, OperandKind::End },
+        /* LoadCell */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::CStr, OperandKind::End },
+        /* LoadGlobal */ { OperandKind::DefLocal, OperandKind::CStr, OperandKind::End },
+        /* LoadItem */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* Move */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::End },
+        /* Raise */ { OperandKind::Local, OperandKind::End },
+        /* Return */ { OperandKind::Local, OperandKind::End },
+        /* Yield */ { OperandKind::Local, OperandKind::End },
+        /* StoreAttr */ { OperandKind::Local, OperandKind::Local, OperandKind::CStr, OperandKind::End },
+        /* StoreClosure */ { OperandKind::Local, OperandKind::CellIdx, OperandKind::End },
+        /* StoreCell */ { OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* StoreGlobal */ { OperandKind::Local, OperandKind::CStr, OperandKind::End },
+        /* StoreItem */ { OperandKind::Local, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* ListAppend */ { OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* SetAdd */ { OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* MapAdd */ { OperandKind::Local, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* BuildDict */ { OperandKind::DefLocal, OperandKind::VecLocal, OperandKind::End },
+        /* BuildList */ { OperandKind::DefLocal, OperandKind::VecLocal, OperandKind::End },
+        /* BuildSet */ { OperandKind::DefLocal, OperandKind::VecLocal, OperandKind::End },
+        /* BuildTuple */ { OperandKind::DefLocal, OperandKind::VecLocal, OperandKind::End },
+        /* Call */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::VecLocal, OperandKind::StrMapLocal, OperandKind::CallSite, OperandKind::End },
+        /* CallEx */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* CallForward */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* CallMethod */ { OperandKind::DefLocal, OperandKind::Local, OperandKind::VecLocal, OperandKind::StrMapLocal, OperandKind::CallSite, OperandKind::End },
+        /* CallBuiltin */ { OperandKind::DefLocal, OperandKind::Byte, OperandKind::PyObj, OperandKind::PyObj, OperandKind::VecLocal, OperandKind::End },
+        /* Destruct */ { OperandKind::Local, OperandKind::VecDefLocal, OperandKind::End },
+        /* MakeFunction */ { OperandKind::DefLocal, OperandKind::PyObj, OperandKind::Local, OperandKind::Local, OperandKind::Local, OperandKind::End },
+        /* GuardIs */ { OperandKind::Local, OperandKind::PyObj, OperandKind::IAddr, OperandKind::End },
+        /* Prolog */ { OperandKind::End },
+        /* Epilog */ { OperandKind::End },
+        /* TraceHead */ { OperandKind::ByteCache, OperandKind::End },
+        /* HotTraceHead */ { OperandKind::LongCache, OperandKind::End },
+    };
+
+    /**
+     * Calls f(kind, operand) for each operand of the instruction at p in encoding order,
+     * and returns the address of the next instruction.
+     * Elements of vectors are visited as Local or DefLocal, and keys of maps as CStr.
+     */
+    template<typename F>
+    inline uint8_t* walk_insn(uint8_t* p, F&& f) {
+        const OperandKind* format = insn_formats[*p++];
+        uint8_t sizes[2];
+        int nsizes = 0;
+        for (auto kind = format; *kind != OperandKind::End; kind++) {
+            switch (*kind) {
+            case OperandKind::Local:
+            case OperandKind::DefLocal:
+            case OperandKind::CellIdx: f(*kind, p); p += sizeof(local_t); break;
+            case OperandKind::IAddr: f(*kind, p); p += sizeof(iaddr_t); break;
+            case OperandKind::CStr: f(*kind, p); while (*p++); break;
+            case OperandKind::PyObj: f(*kind, p); p += sizeof(PyObject*); break;
+            case OperandKind::ByteCache:
+            case OperandKind::Byte: f(*kind, p); p += sizeof(uint8_t); break;
+            case OperandKind::LongCache: f(*kind, p); p += sizeof(int64_t); break;
+            case OperandKind::ICache2: f(*kind, p); p += sizeof(icache_t<2>*); break;
+            case OperandKind::CallSite: f(*kind, p); p += sizeof(callsite_t*); break;
+            default: sizes[nsizes++] = *p++; break;
+            }
+        }
+        nsizes = 0;
+        for (auto kind = format; *kind != OperandKind::End; kind++) {
+            if (*kind == OperandKind::VecLocal || *kind == OperandKind::VecDefLocal) {
+                const auto element = *kind == OperandKind::VecLocal ? OperandKind::Local : OperandKind::DefLocal;
+                for (int i = 0; i < sizes[nsizes]; i++) {
+                    f(element, p); p += sizeof(local_t);
+                }
+                nsizes++;
+            }
+            else if (*kind == OperandKind::StrMapLocal) {
+                for (int i = 0; i < sizes[nsizes]; i++) {
+                    f(OperandKind::CStr, p); while (*p++);
+                    f(OperandKind::Local, p); p += sizeof(local_t);
+                }
+                nsizes++;
+            }
+        }
+        return p;
+    }
+}
@@ -3,6 +3,8 @@
 #include <memory>
 #include <vector>
 #include <map>
+#include <tuple>
+#include <deque>
 #include <stdexcept>
 #include <initializer_list>
 #include <stdio.h>
@@ -176,7 +178,10 @@ public:
 };
 
 class MIRModule final {
+	using proto_key_t = std::tuple<MIR_type_t, std::vector<MIR_type_t>, bool>;
 	int proto_cnt;
+	std::deque<std::string> argv;  // stable storage for arg names
+	std::map<proto_key_t, MIR_item_t> proto_table;
 public:
 	MIR_context_t ctx;
 	MIR_module_t m;
@@ -197,21 +202,27 @@ public:
 		return item;
 	}
 
+	// Prototypes are interned per module by (return type, argument types, variadic).
 	MIRRefOp new_proto(
 		MIR_type_t ret_type_or_bound, std::initializer_list<MIR_type_t> args, bool variadic = false
 	) {
-		static std::vector<std::string> argv;
+		auto key = proto_key_t(ret_type_or_bound, std::vector<MIR_type_t>(args), variadic);
+		auto it = proto_table.find(key);
+		if (it != proto_table.end())
+			return it->second;
 		std::string name = "_yapyjit_proto_" + std::to_string(proto_cnt++);
 		std::vector<MIR_var_t> v;
 		for (size_t i = argv.size(); i < args.size(); i++) argv.push_back("a" + std::to_string(i));
 		// mir issue #252
 		for (size_t i = 0; i < args.size(); i++) v.push_back({ args.begin()[i], argv[i].c_str() });
-		return (variadic ? MIR_new_vararg_proto_arr : MIR_new_proto_arr)(
+		auto item = (variadic ? MIR_new_vararg_proto_arr : MIR_new_proto_arr)(
 			ctx, name.c_str(),
 			ret_type_or_bound == MIR_T_BOUND ? 0 : 1, &ret_type_or_bound,
 			args.size(),
 			v.data()
 		);
+		proto_table.insert({ std::move(key), item });
+		return item;
 	}
 
 	std::unique_ptr<MIRFunction> new_func(
@@ -49,12 +49,24 @@ namespace yapyjit {
 			Py_XINCREF(_obj);
 		}
 
+		ManagedPyo& operator=(const ManagedPyo& copy) {
+			Py_XINCREF(copy._obj);
+			Py_XDECREF(_obj);
+			_obj = copy._obj;
+			return *this;
+		}
+
 		~ManagedPyo() { Py_XDECREF(_obj); }
 
 		ManagedPyo attr(const char* name) const {
 			return PyObject_GetAttrString(_obj, name);
 		}
 
+		// Attribute lookup by a (preferably interned) str object
+		ManagedPyo attr(PyObject* name) const {
+			return PyObject_GetAttr(_obj, name);
+		}
+
 		int attr(const char* name, ManagedPyo val) {
 			return PyObject_SetAttrString(_obj, name, val.borrow());
 		}
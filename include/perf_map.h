@@ -0,0 +1,26 @@
+#pragma once
+/**
+ * Perf map of jitted functions, `/tmp/perf-<pid>.map`, read by Linux `perf` to name code it has no symbols for.
+ * All jitted code runs inside the interpreter, so when enabled each function compiled afterwards gets a native
+ * stub of its own that calls `ir_interpret`. Samples taken while the function runs then have the stub on their
+ * call chain, and the stub is listed in the map under `module.qualname` until the function is released.
+ * The jitdump, `/tmp/jit-<pid>.dump` for `perf inject --jit`, also has the code of each stub and the line of
+ * its `def` as debug info. There is one map and one dump per process, shared by all interpreters.
+ */
+#include <string>
+#include <ir.h>
+
+namespace yapyjit {
+	// Whether stubs can be generated on this platform, Linux on x86-64.
+	bool perf_map_supported();
+	// Whether stubs are made, for the map or the dump.
+	bool perf_map_enabled();
+	// Starting truncates the map left by an earlier process of the same pid.
+	void set_perf_map(bool enabled);
+	// Stopping closes the dump, starting again writes a new one.
+	void set_jitdump(bool enabled);
+	// Runs `func` through a new stub listed as `name`, if enabled. `filename` may be empty if unknown.
+	void perf_map_attach(Function& func, const std::string& name, const std::string& filename, int line);
+	// Removes the entry of `func` and frees its stub for reuse.
+	void perf_map_detach(Function& func);
+};
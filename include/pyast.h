@@ -1,4 +1,5 @@
 #pragma once
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -28,6 +29,7 @@ namespace yapyjit {
 		RETURN,
 		DELETE,
 		ASSIGN,
+		AUGASSIGN,
 		FOR,
 		WHILE,
 		IF,
@@ -37,8 +39,13 @@ namespace yapyjit {
 		BREAK,
 		CONTINUE,
 		FUNCDEF,
+		YIELD,
+		GENERATOREXP,
 
 		EXT_VALUEBLOCK,
+		EXT_COMPADD,
+		EXT_LOCALDECL,
+		EXT_CELLDECL,
 
 		ANN_ASSIGN,
 		EXPR,
@@ -163,6 +170,8 @@ namespace yapyjit {
 		std::unique_ptr<AST> func;
 		std::vector<std::unique_ptr<AST>> args;
 		std::map<std::string, std::unique_ptr<AST>> kwargs;
+		// Trailing `*x` after `args` and `**y` merged into `kwargs`, if any.
+		std::unique_ptr<AST> star_args, star_kwargs;
 
 		Call(std::unique_ptr<AST>&& func_)
 			: func(std::move(func_)), args(), kwargs() {
@@ -252,6 +261,16 @@ namespace yapyjit {
 		virtual local_t emit_ir(Function& appender);
 	};
 
+	class AugAssign : public ASTWithTag<ASTTag::AUGASSIGN> {
+	public:
+		std::unique_ptr<AST> target;
+		std::unique_ptr<AST> value;
+		InsnTag op;  // Of the `InplaceOp` group.
+		AugAssign(std::unique_ptr<AST>&& target_, std::unique_ptr<AST>&& value_, InsnTag op_)
+			: target(std::move(target_)), value(std::move(value_)), op(op_) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
 	class Delete : public ASTWithTag<ASTTag::DELETE> {
 	public:
 		std::vector<std::unique_ptr<AST>> targets;
@@ -336,6 +355,40 @@ namespace yapyjit {
 		}
 	};
 
+	class CompAdd : public ASTWithTag<ASTTag::EXT_COMPADD> {
+	public:
+		// Adds an element to the result of a comprehension.
+		// `ListAppend` and `SetAdd` take `value`, `MapAdd` also takes `key`.
+		std::unique_ptr<AST> collection, key, value;
+		InsnTag op;
+		CompAdd(std::unique_ptr<AST>&& collection_, std::unique_ptr<AST>&& key_, std::unique_ptr<AST>&& value_, InsnTag op_)
+			: collection(std::move(collection_)), key(std::move(key_)), value(std::move(value_)), op(op_) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
+	class Yield : public ASTWithTag<ASTTag::YIELD> {
+	public:
+		// Only usable as a statement for now, the value of the expression is not available.
+		std::unique_ptr<AST> value;
+		Yield(std::unique_ptr<AST>&& value_) : value(std::move(value_)) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
+	class GeneratorExp : public ASTWithTag<ASTTag::GENERATOREXP> {
+	public:
+		// Argument of the generator body holding the iterator of the outermost loop.
+		static constexpr const char* iter_name = "_yapyjit_genexp_iter";
+		// Iterable of the outermost loop, `iter` of it is taken eagerly in the enclosing function.
+		std::unique_ptr<AST> first_iter;
+		// Loops yielding the elements, emitted into a function of its own.
+		std::unique_ptr<AST> body;
+		// Names read by the body other than the loop variables.
+		std::vector<std::string> free_names;
+		GeneratorExp(std::unique_ptr<AST>&& first_iter_, std::unique_ptr<AST>&& body_, const std::vector<std::string>& free_names_)
+			: first_iter(std::move(first_iter_)), body(std::move(body_)), free_names(free_names_) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
 	class Global : public ASTWithTag<ASTTag::GLOBAL> {
 	public:
 		std::vector<std::string> names;
@@ -343,13 +396,44 @@ namespace yapyjit {
 		virtual local_t emit_ir(Function& appender);
 	};
 
+	class LocalDecl : public ASTWithTag<ASTTag::EXT_LOCALDECL> {
+	public:
+		// Names bound in dead code that is dropped, which are still local to the function.
+		std::vector<std::string> names;
+		LocalDecl(const std::vector<std::string>& names_) : names(names_) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
+	class CellDecl : public ASTWithTag<ASTTag::EXT_CELLDECL> {
+	public:
+		// Variables of a comprehension captured by lambdas in it, in new cells each time it runs.
+		std::vector<std::string> names;
+		CellDecl(const std::vector<std::string>& names_) : names(names_) {}
+		virtual local_t emit_ir(Function& appender);
+	};
+
 	class FuncDef : public ASTWithTag<ASTTag::FUNCDEF> {
 	public:
 		std::string name;
 		std::vector<std::string> args;
+		std::string vararg, kwarg;  // Names of `*args` and `**kwargs`, empty if absent.
+		bool forwards = false;  // Both are only passed on as in `f(*args, **kwargs)`, see `Function::forwards`.
 		std::vector<std::unique_ptr<AST>> body_stmts;
+		// Evaluated by the enclosing function when a nested function is made.
+		std::vector<std::unique_ptr<AST>> decorators, defaults;
+		std::vector<std::pair<std::string, std::unique_ptr<AST>>> kw_defaults;
+		int lineno = 1;  // First line of the code object, at the first decorator if any.
+		bool lambda = false;  // The value of a `lambda` expression is the function, a `def` assigns it.
+		// Names in the enclosing function of the free variables that were renamed there, see `lower_comprehension`.
+		std::map<std::string, std::string> free_renames;
+		// Error converting the parameters or body. Nested functions are then left to CPython.
+		std::exception_ptr unsupported;
 		FuncDef() {}
 		virtual local_t emit_ir(Function& appender);
 		std::unique_ptr<Function> emit_ir_f(ManagedPyo pyfunc);
+		// Registers of the parameters in `appender`, in the order of `wf_fastcall`.
+		void bind_args(Function& appender);
+		// Prolog, cells, body and epilog in `appender` compiled from `code`, whose arguments are set up.
+		void emit_body(Function& appender, ManagedPyo code);
 	};
 };
\ No newline at end of file
@@ -1,18 +1,74 @@
 #pragma once
 #include <memory>
 #include <map>
+#include <set>
+#include <unordered_map>
 #include <Python.h>
 #include <mpyo.h>
 #include <pyast.h>
 #include <ir.h>
+#include <ir_inline.h>
+#include <ir_refcount.h>
 #include <ir_interpret_trace.h>
 
 static_assert(sizeof(Py_ssize_t) == 8, "Only 64 bit machines are supported");
 
+struct JitEntrance;
+
 namespace yapyjit {
+    // Source of the IR: the python AST from `inspect.getsource`, or the CPython bytecode in `__code__`.
+    BETTER_ENUM(Frontend, uint8_t, AST, Bytecode)
+
     // extern MIRContext mir_ctx;
 	extern std::unique_ptr<AST> ast_py2native(ManagedPyo ast);
-    extern bool force_trace_p;
+	extern std::unique_ptr<Function> bytecode_emit_ir(ManagedPyo pyfunc);
+
+    // Dispatch info of an AST node type, see `ast_type_info`.
+    struct AstTypeInfo {
+        long long hash;
+        std::string name;
+        PyObject* fields;
+    };
+
+    // Mutable state of yapyjit in one interpreter, so that subinterpreters do not share any.
+    // Owned by a capsule in the interpreter dict, the modules imported into the interpreter,
+    // jitted functions and generator expressions hold references to it (`owner`).
+    struct Context {
+        PyObject* owner = nullptr;
+        bool force_trace_p = false;
+        // Run jitted code through `ir_profile`, see `yapyjit.set_profile`.
+        bool profile_p = false;
+        bool profile_cycles = false;
+        int inline_threshold = 8;
+        size_t code_budget = 0;
+        Frontend frontend = Frontend::AST;
+        std::list<Tracer*> trace_chain;
+        PyTypeObject* jit_entrance_type = nullptr;
+        PyTypeObject* generator_code_type = nullptr;
+        PyTypeObject* generator_type = nullptr;
+        PyTypeObject* range_counter_type = nullptr;
+        // Entrances holding compiled code, and the total size of that code.
+        std::set<JitEntrance*> compiled_entrances;
+        size_t code_usage = 0;
+        // Counts calls to all entrances, used as the clock of the LRU code budget.
+        uint64_t call_clock = 0;
+        // Entrances called at least once, reported by `yapyjit.stats()`.
+        std::set<JitEntrance*> called_entrances;
+        // Canonical `kwnames` tuples of call sites, see `callsite_kwnames`.
+        PyObject* kwnames = nullptr;
+        // Types are kept alive by the cache so that keys are never reused.
+        std::unordered_map<PyTypeObject*, AstTypeInfo> ast_types;
+        // Interned strings of attribute names, see `intern`.
+        std::unordered_map<std::string, PyObject*> strings;
+
+        // Borrowed reference to the interned `name`, kept for the lifetime of the context.
+        PyObject* intern(const std::string& name);
+
+        ~Context();
+    };
+
+    // Context of the current interpreter, created when yapyjit is first imported into it.
+    Context& context();
 
 	inline ManagedPyo get_py_ast(PyObject* pyfunc) {
         auto locals = ManagedPyo(PyDict_New());
@@ -36,6 +92,16 @@ namespace yapyjit {
             throw std::runtime_error("BUG: AST root is not function definition.");
         }
 
-        return funcast->emit_ir_f(pyfunc);
+        auto func = funcast->emit_ir_f(pyfunc);
+        func->refcount_elided = elide_refcounts(*func);
+        return func;
+    }
+
+    inline std::unique_ptr<yapyjit::Function> get_ir(ManagedPyo pyfunc, Frontend source) {
+        if (source == +Frontend::AST)
+            return get_ir(get_py_ast(pyfunc.borrow()), pyfunc);
+        auto func = bytecode_emit_ir(pyfunc);
+        func->refcount_elided = elide_refcounts(*func);
+        return func;
     }
 }
@@ -1,7 +1,24 @@
 #include <pyast.h>
+#include <ir_walker.h>
+#include <ir_refcount.h>
+#include <ir_builtins.h>
+#include <perf_map.h>
 #include <iostream>
 
 namespace yapyjit {
+	Function::~Function() {
+		perf_map_detach(*this);
+		if (!owns_constants)
+			return;
+		uint8_t* p = bytecode().data();
+		uint8_t* end = p + bytecode().size();
+		while (p < end) {
+			p = walk_insn(p, [](OperandKind kind, uint8_t* operand) {
+				if (kind == OperandKind::PyObj)
+					Py_XDECREF(*reinterpret_cast<PyObject**>(operand));
+			});
+		}
+	}
 
 	void assn_ir(Function& appender, AST* dst, local_t src);
 	void del_ir(Function& appender, AST* dst);
@@ -23,6 +40,18 @@ namespace yapyjit {
 		}
 	};
 
+	// Body of an except clause, leaving it ends the handling of the exception.
+	class ExceptHandlerBlock : public PBlock {
+	public:
+		std::vector<AST*> finalbody;
+		virtual void emit_exit(Function& appender) {
+			appender.add_insn(clear_error_ctx_ins());
+			for (auto astptr : finalbody) {
+				astptr->emit_ir(appender);
+			}
+		}
+	};
+
 	local_t BoolOp::emit_ir(Function& appender) {
 		local_t result = new_temp_var(appender);
 		// a && b
@@ -53,10 +82,11 @@ namespace yapyjit {
 	}
 	local_t BinOp::emit_ir(Function& appender) {
 		local_t result = new_temp_var(appender);
+		local_t left_rs = left->emit_ir(appender);
+		local_t right_rs = right->emit_ir(appender);
 		appender.add_insn(binop_ins(
-			op, result,
-			left->emit_ir(appender),
-			right->emit_ir(appender)
+			op, result, left_rs, right_rs,
+			appender.new_binop_icache(op)
 		));
 		return result;
 	}
@@ -114,9 +144,112 @@ namespace yapyjit {
 			*lab_e = appender.next_addr();
 		return result;
 	}
-	local_t Call::emit_ir(Function& appender) {
+	// Iterator of a `for` loop or comprehension over `iterable`.
+	local_t loop_iter_ir(Function& appender, local_t iterable) {
 		local_t result = new_temp_var(appender);
+		appender.add_insn(get_iter_ins(result, iterable));
+		return result;
+	}
+	// Call of `func` with `*` or `**` arguments.
+	local_t call_ex_ir(Function& appender, Call& call) {
+		local_t result = new_temp_var(appender);
+		local_t func = call.func->emit_ir(appender);
+		auto is_reg = [&appender](const std::unique_ptr<AST>& node, local_t reg) {
+			if (!node || node->tag() != +ASTTag::NAME)
+				return false;
+			const auto& id = static_cast<Name*>(node.get())->identifier;
+			auto it = appender.locals.find(id);
+			return !appender.cells.count(id) && it != appender.locals.end() && it->second == reg;
+		};
+		if (appender.forwards && call.args.empty() && call.kwargs.empty()
+			&& is_reg(call.star_args, appender.nargs + 1) && is_reg(call.star_kwargs, appender.nargs + 2)) {
+			appender.add_insn(call_forward_ins(result, func, appender.nargs + 1, appender.nargs + 2));
+			return result;
+		}
+		auto method = [&appender](PyTypeObject* type, const char* name) {
+			local_t reg = new_temp_var(appender);
+			appender.add_insn(constant_ins(reg, ManagedPyo((PyObject*)type, true).attr(name)));
+			return reg;
+		};
+		local_t args;
+		if (call.star_args && call.args.empty()) {
+			args = call.star_args->emit_ir(appender);
+		}
+		else {
+			std::vector<local_t> items;
+			for (auto& arg : call.args) {
+				items.push_back(arg->emit_ir(appender));
+			}
+			args = new_temp_var(appender);
+			appender.add_insn(build_ins(call.star_args ? InsnTag::BuildList : InsnTag::BuildTuple, args, items));
+			if (call.star_args) {
+				local_t extend = method(&PyList_Type, "extend");
+				appender.add_insn(call_ins(new_temp_var(appender), extend, { args, call.star_args->emit_ir(appender) }, {}, appender.new_callsite()));
+			}
+		}
+		local_t kwargs;
+		if (call.kwargs.empty()) {
+			if (call.star_kwargs) {
+				kwargs = call.star_kwargs->emit_ir(appender);
+			}
+			else {
+				kwargs = new_temp_var(appender);
+				appender.add_insn(constant_ins(kwargs, ManagedPyo(Py_None, true)));
+			}
+		}
+		else {
+			// As in the bytecode front end, `**` is merged by `dict.update`, so repeated keys are not an error.
+			std::vector<local_t> items;
+			for (auto& kwarg : call.kwargs) {
+				items.push_back(new_temp_var(appender));
+				appender.add_insn(constant_ins(items.back(), ManagedPyo(PyUnicode_InternFromString(kwarg.first.c_str()))));
+				items.push_back(kwarg.second->emit_ir(appender));
+			}
+			kwargs = new_temp_var(appender);
+			appender.add_insn(build_ins(InsnTag::BuildDict, kwargs, items));
+			if (call.star_kwargs) {
+				local_t update = method(&PyDict_Type, "update");
+				appender.add_insn(call_ins(new_temp_var(appender), update, { kwargs, call.star_kwargs->emit_ir(appender) }, {}, appender.new_callsite()));
+			}
+		}
+		appender.add_insn(call_ex_ins(result, func, args, kwargs));
+		return result;
+	}
+	local_t Call::emit_ir(Function& appender) {
+		if (star_args || star_kwargs)
+			return call_ex_ir(appender, *this);
 		std::vector<local_t> argvec;
+		if (func->tag() == +ASTTag::NAME && kwargs.empty()) {
+			const auto& identifier = static_cast<Name*>(func.get())->identifier;
+			auto id = builtin_id(identifier);
+			const bool global = !appender.closure.count(identifier)
+				&& (!appender.locals.count(identifier) || appender.globals.count(identifier));
+			// Not specialized if a global shadows the builtin already, the guard would always fail.
+			PyObject* expected = id && global ? builtin_object(*id) : nullptr;
+			if (expected && !PyDict_GetItemString(appender.globals_ns.borrow(), identifier.c_str())) {
+				appender.globals.insert(identifier);
+				local_t result = new_temp_var(appender);
+				for (auto& arg : args) {
+					argvec.push_back(arg->emit_ir(appender));
+				}
+				appender.add_insn(call_builtin_ins(
+					result, *id, ManagedPyo(PyUnicode_InternFromString(identifier.c_str())), ManagedPyo(expected, true), argvec
+				));
+				return result;
+			}
+		}
+		local_t result = new_temp_var(appender);
+		local_t method = 0;
+		if (func->tag() == +ASTTag::ATTR) {
+			// `obj.attr(...)` looks up the method before the arguments, then passes `obj` as the first one.
+			auto attribute = static_cast<Attribute*>(func.get());
+			local_t self = new_temp_var(appender);
+			method = new_temp_var(appender);
+			appender.add_insn(load_method_ins(
+				method, self, attribute->expr->emit_ir(appender), ManagedPyo(PyUnicode_InternFromString(attribute->attr.c_str()))
+			));
+			argvec.push_back(self);
+		}
 		for (auto& arg : args) {
 			argvec.push_back(arg->emit_ir(appender));
 		}
@@ -124,10 +257,18 @@ namespace yapyjit {
 		for (auto& kwarg : kwargs) {
 			kwargmap[kwarg.first] = kwarg.second->emit_ir(appender);
 		}
-		appender.add_insn(call_ins(result, func->emit_ir(appender), argvec, kwargmap));
+		if (method)
+			appender.add_insn(call_method_ins(result, method, argvec, kwargmap, appender.new_callsite()));
+		else
+			appender.add_insn(call_ins(result, func->emit_ir(appender), argvec, kwargmap, appender.new_callsite()));
 		return result;
 	}
 	local_t Name::emit_ir(Function& appender) {
+		if (appender.cells.count(identifier)) {
+			local_t result = new_temp_var(appender);
+			appender.add_insn(load_cell_ins(result, appender.locals[identifier], identifier));
+			return result;
+		}
 		const auto ins_pair = appender.locals.insert(
 			{ identifier, (local_t)(appender.locals.size() + 1) }
 		);
@@ -185,6 +326,48 @@ namespace yapyjit {
 		}
 		return -1;
 	}
+	local_t AugAssign::emit_ir(Function& appender) {
+		// Attribute and subscript targets are evaluated once, for both the load and the store.
+		local_t obj = -1, subscr = -1, current;
+		switch (target->tag())
+		{
+		case ASTTag::NAME:
+			current = target->emit_ir(appender);
+			break;
+		case ASTTag::ATTR: {
+			const Attribute* dst_attr = (Attribute*)target.get();
+			obj = dst_attr->expr->emit_ir(appender);
+			current = new_temp_var(appender);
+			appender.add_insn(load_attr_ins(current, obj, dst_attr->attr));
+			break;
+		}
+		case ASTTag::SUBSCR: {
+			const Subscript* dst_subscr = (Subscript*)target.get();
+			obj = dst_subscr->expr->emit_ir(appender);
+			subscr = dst_subscr->slice->emit_ir(appender);
+			current = new_temp_var(appender);
+			appender.add_insn(load_item_ins(current, obj, subscr));
+			break;
+		}
+		default:
+			throw std::invalid_argument(
+				std::string(__FUNCTION__" got unsupported target with kind ")
+				+ target->tag()._to_string()
+			);
+		}
+		local_t result = new_temp_var(appender);
+		appender.add_insn(inplaceop_ins(
+			op, result, current, value->emit_ir(appender),
+			appender.new_binop_icache(op)
+		));
+		if (obj == -1)
+			assn_ir(appender, target.get(), result);
+		else if (subscr == -1)
+			appender.add_insn(store_attr_ins(obj, result, ((Attribute*)target.get())->attr));
+		else
+			appender.add_insn(store_item_ins(obj, result, subscr));
+		return -1;
+	}
 	local_t Delete::emit_ir(Function& appender) {
 		for (auto& target : targets) {
 			del_ir(appender, target.get());
@@ -202,16 +385,7 @@ namespace yapyjit {
 
 		// for target in iter body orelse end
 		// get_iter; start; fornx orelse; body; j start; orelse; end;
-		auto blt = PyEval_GetBuiltins();
-		if (!blt) throw std::logic_error(__FUNCTION__" cannot get builtins.");
-		if (!PyDict_CheckExact(blt)) throw std::logic_error(__FUNCTION__" builtins is not a dict.");
-		auto iterfn = PyDict_GetItemString(blt, "iter");
-		if (!iterfn) throw std::logic_error(__FUNCTION__" cannot get builtins.iter.");
-
-		auto iterconst = new_temp_var(appender);
-		appender.add_insn(constant_ins(iterconst, ManagedPyo(iterfn, true)));
-		auto iterobj = new_temp_var(appender);
-		appender.add_insn(call_ins(iterobj, iterconst, { iter->emit_ir(appender) }, {}));
+		auto iterobj = loop_iter_ir(appender, iter->emit_ir(appender));
 
 		auto target_tmp = new_temp_var(appender);
 		// appender.add_insn(std::move(label_st));
@@ -237,14 +411,19 @@ namespace yapyjit {
 
 		// while test body orelse end
 		// start; test; jt body; j orelse; body; j start; orelse; end;
+		// A literal test is always true (see `ast_py2native`), then: start; body; j start; end;
 		auto addr_st = appender.next_addr();
-		auto test_rs = test->emit_ir(appender);
-		auto label_body = appender.add_insn_label(jump_truthy_ins(test_rs));
-		auto label_orelse = appender.add_insn_label(jump_ins());
-		*label_body = appender.next_addr();
+		ilabel_t label_orelse;
+		if (test->tag() != +ASTTag::CONST) {
+			auto test_rs = test->emit_ir(appender);
+			auto label_body = appender.add_insn_label(jump_truthy_ins(test_rs));
+			label_orelse = appender.add_insn_label(jump_ins());
+			*label_body = appender.next_addr();
+		}
 		for (auto& stmt : body) stmt->emit_ir(appender);
 		appender.add_insn(jump_ins(addr_st));
-		*label_orelse = appender.next_addr();
+		if (label_orelse.valid())
+			*label_orelse = appender.next_addr();
 		for (auto& stmt : orelse) stmt->emit_ir(appender);
 
 		for (auto& ptr : loopblock.break_pts)
@@ -348,6 +527,8 @@ namespace yapyjit {
 			appender.exctable_val[ptr] = appender.next_addr();
 		}
 		// Start error handlers
+		ExceptHandlerBlock handler_blk;
+		handler_blk.finalbody = err_blk.finalbody;
 		for (auto& handler : handlers) {
 			ilabel_t end;
 			auto bounderr = new_temp_var(appender);
@@ -362,9 +543,11 @@ namespace yapyjit {
 			else {
 				end = appender.add_insn_label(check_error_type_ins(bounderr, -1));
 			}
+			appender.pblocks.push_back(&handler_blk);
 			for (auto& stmt : handler.body) {
 				stmt->emit_ir(appender);
 			}
+			appender.pblocks.pop_back();
 			label_blk_next.push_back(appender.add_insn_label(jump_ins()));
 			*end = appender.next_addr();
 		}
@@ -385,40 +568,276 @@ namespace yapyjit {
 		}
 		return result;
 	}
+	local_t CompAdd::emit_ir(Function& appender) {
+		local_t coll = collection->emit_ir(appender);
+		local_t k = key ? key->emit_ir(appender) : -1;
+		local_t v = value->emit_ir(appender);
+		if (op == +InsnTag::ListAppend)
+			appender.add_insn(list_append_ins(coll, v));
+		else if (op == +InsnTag::SetAdd)
+			appender.add_insn(set_add_ins(coll, v));
+		else
+			appender.add_insn(map_add_ins(coll, k, v));
+		return -1;
+	}
+	local_t Yield::emit_ir(Function& appender) {
+		appender.add_insn(yield_ins(value->emit_ir(appender)));
+		return -1;
+	}
+	local_t GeneratorExp::emit_ir(Function& appender) {
+		auto body_fn = std::make_unique<Function>(appender.globals_ns, appender.deref_ns, appender.name + ".<genexpr>", 1);
+		body_fn->generator = true;
+		body_fn->closure = appender.closure;
+		body_fn->nested_code = appender.nested_code;
+		body_fn->first_line = appender.first_line;
+		body_fn->locals[iter_name] = 1;
+		std::vector<local_t> args{ loop_iter_ir(appender, first_iter->emit_ir(appender)) };
+		// Locals of the enclosing function are passed as arguments, their cells if they are captured.
+		for (const auto& name : free_names) {
+			auto it = appender.locals.find(name);
+			if (it == appender.locals.end() || appender.globals.count(name) || appender.closure.count(name))
+				continue;
+			body_fn->locals[name] = static_cast<local_t>(++body_fn->nargs);
+			if (appender.cells.count(name))
+				body_fn->cells.insert(name);
+			args.push_back(it->second);
+		}
+		body_fn->add_insn(prolog_ins());
+		body->emit_ir(*body_fn);
+		Return(std::unique_ptr<AST>(new Constant(ManagedPyo(Py_None, true)))).emit_ir(*body_fn);
+		body_fn->add_insn(epilog_ins());
+		body_fn->refcount_elided = elide_refcounts(*body_fn);
+
+		auto code = new_temp_var(appender);
+		appender.add_insn(constant_ins(code, ManagedPyo(new_generator_code(std::move(body_fn)))));
+		local_t result = new_temp_var(appender);
+		appender.add_insn(call_ins(result, code, args, {}, appender.new_callsite()));
+		return result;
+	}
 	local_t Global::emit_ir(Function& appender) {
 		for (const auto& name : names) {
 			appender.globals.insert(name);
 		}
 		return -1;
 	}
+	local_t CellDecl::emit_ir(Function& appender) {
+		local_t cell_type = new_temp_var(appender);
+		appender.add_insn(constant_ins(cell_type, ManagedPyo((PyObject*)&PyCell_Type, true)));
+		for (const auto& name : names) {
+			local_t cell = appender.locals.insert({ name, (local_t)(appender.locals.size() + 1) }).first->second;
+			appender.add_insn(call_ins(cell, cell_type, {}, {}, appender.new_callsite()));
+			appender.cells.insert(name);
+		}
+		return -1;
+	}
+	local_t LocalDecl::emit_ir(Function& appender) {
+		for (const auto& name : names) {
+			if (!appender.globals.count(name) && !appender.closure.count(name))
+				appender.locals.insert({ name, (local_t)(appender.locals.size() + 1) });
+		}
+		return -1;
+	}
+	// Code objects of the functions defined in `code`, also in the comprehensions that are inlined here.
+	void collect_nested_code(std::vector<ManagedPyo>& into, ManagedPyo code) {
+		for (auto konst : code.attr("co_consts")) {
+			if (!PyCode_Check(konst.borrow()))
+				continue;
+			const std::string name = konst.attr("co_name").to_cstr();
+			if (name == "<listcomp>" || name == "<setcomp>" || name == "<dictcomp>" || name == "<genexpr>")
+				collect_nested_code(into, konst);
+			else
+				into.push_back(konst);
+		}
+	}
+	// Takes the code object of `def` from those nested in `appender`, by name and first line.
+	ManagedPyo take_nested_code(Function& appender, const FuncDef& def) {
+		for (auto it = appender.nested_code.begin(); it != appender.nested_code.end(); ++it) {
+			if (it->attr("co_name").to_cstr() == def.name
+				&& it->attr("co_firstlineno").to_cLL() - appender.first_line + 1 == def.lineno) {
+				auto code = *it;
+				appender.nested_code.erase(it);
+				return code;
+			}
+		}
+		throw std::logic_error("BUG: code object of nested function `" + def.name + "` not found.");
+	}
+	// Free variables of the generator expressions in `code`, also in the comprehensions that are inlined here.
+	void collect_genexpr_freevars(std::set<std::string>& into, ManagedPyo code) {
+		for (auto konst : code.attr("co_consts")) {
+			if (!PyCode_Check(konst.borrow()))
+				continue;
+			const std::string name = konst.attr("co_name").to_cstr();
+			if (name == "<genexpr>")
+				for (auto free : konst.attr("co_freevars"))
+					into.insert(free.to_cstr());
+			if (name == "<listcomp>" || name == "<setcomp>" || name == "<dictcomp>")
+				collect_genexpr_freevars(into, konst);
+		}
+	}
+	// Cells of the variables in `code` captured by nested functions, made right after the prolog.
+	// Generator expressions read them through the cells too, as they may run after later assignments.
+	// Comprehensions are inlined and need no cells.
+	void cells_ir(Function& appender, ManagedPyo code) {
+		std::set<std::string> captured;
+		for (const auto& nested : appender.nested_code)
+			for (auto name : nested.attr("co_freevars"))
+				captured.insert(name.to_cstr());
+		collect_genexpr_freevars(captured, code);
+		local_t cell_type = -1;
+		for (auto name_obj : code.attr("co_cellvars")) {
+			const std::string name = name_obj.to_cstr();
+			if (!captured.count(name))
+				continue;
+			if (cell_type < 0) {
+				cell_type = new_temp_var(appender);
+				appender.add_insn(constant_ins(cell_type, ManagedPyo((PyObject*)&PyCell_Type, true)));
+			}
+			local_t cell = new_temp_var(appender);
+			std::vector<local_t> args;
+			auto it = appender.locals.find(name);
+			if (it != appender.locals.end()) {
+				// An argument, its register is kept under another name.
+				args.push_back(it->second);
+				appender.locals["_yapyjit_arg_" + name] = it->second;
+			}
+			appender.add_insn(call_ins(cell, cell_type, args, {}, appender.new_callsite()));
+			appender.locals[name] = cell;
+			appender.cells.insert(name);
+		}
+	}
+	void FuncDef::bind_args(Function& appender) {
+		for (size_t i = 0; i < args.size(); i++) {
+			appender.locals[args[i]] = (int)i + 1;
+		}
+		auto reg = static_cast<local_t>(args.size() + 1);
+		if (!vararg.empty()) {
+			appender.locals[vararg] = reg++;
+			appender.varargs = true;
+		}
+		if (!kwarg.empty()) {
+			appender.locals[kwarg] = reg;
+			appender.varkw = true;
+		}
+	}
+	void FuncDef::emit_body(Function& appender, ManagedPyo code) {
+		collect_nested_code(appender.nested_code, code);
+		appender.add_insn(prolog_ins());
+		cells_ir(appender, code);
+		// A captured `*args` or `**kwargs` is read through its cell.
+		appender.forwards = forwards && !appender.cells.count(vararg) && !appender.cells.count(kwarg);
+		for (auto& stmt : body_stmts) {
+			stmt->emit_ir(appender);
+		}
+		// Return none if not yet.
+		Return ret_none_default = Return(
+			std::unique_ptr<AST>(new Constant(ManagedPyo(Py_None, true)))
+		);
+		ret_none_default.emit_ir(appender);
+		appender.add_insn(epilog_ins());
+	}
 	local_t FuncDef::emit_ir(Function& appender) {
-		throw std::logic_error("Nested functions are not supported yet");
+		// Decorators, defaults and the closure are evaluated in the enclosing function, in the order of CPython.
+		std::vector<local_t> decorator_regs;
+		for (auto& decorator : decorators) {
+			decorator_regs.push_back(decorator->emit_ir(appender));
+		}
+		local_t none = new_temp_var(appender);
+		appender.add_insn(constant_ins(none, ManagedPyo(Py_None, true)));
+		local_t defaults_reg = none, kw_defaults_reg = none, closure_reg = none;
+		if (!defaults.empty()) {
+			std::vector<local_t> values;
+			for (auto& value : defaults) {
+				values.push_back(value->emit_ir(appender));
+			}
+			defaults_reg = new_temp_var(appender);
+			appender.add_insn(build_ins(InsnTag::BuildTuple, defaults_reg, values));
+		}
+		if (!kw_defaults.empty()) {
+			std::vector<local_t> items;
+			for (auto& kw_default : kw_defaults) {
+				items.push_back(new_temp_var(appender));
+				appender.add_insn(constant_ins(items.back(), ManagedPyo(PyUnicode_InternFromString(kw_default.first.c_str()))));
+				items.push_back(kw_default.second->emit_ir(appender));
+			}
+			kw_defaults_reg = new_temp_var(appender);
+			appender.add_insn(build_ins(InsnTag::BuildDict, kw_defaults_reg, items));
+		}
+		auto code = take_nested_code(appender, *this);
+		std::vector<local_t> cells;
+		for (auto free_obj : code.attr("co_freevars")) {
+			auto renamed = free_renames.find(free_obj.to_cstr());
+			const std::string free = renamed == free_renames.end() ? free_obj.to_cstr() : renamed->second;
+			if (appender.cells.count(free)) {
+				cells.push_back(appender.locals[free]);
+			}
+			else if (appender.closure.count(free)) {
+				cells.push_back(new_temp_var(appender));
+				appender.add_insn(constant_ins(
+					cells.back(), ManagedPyo(PyTuple_GET_ITEM(appender.deref_ns.borrow(), appender.closure[free]), true)
+				));
+			}
+			else {
+				throw std::invalid_argument("`" + name + "` captures `" + free + "`, which is not a cell in the enclosing function.");
+			}
+		}
+		if (!cells.empty()) {
+			closure_reg = new_temp_var(appender);
+			appender.add_insn(build_ins(InsnTag::BuildTuple, closure_reg, cells));
+		}
+
+		// Without a body, the nested function is left to CPython.
+		std::unique_ptr<Function> body;
+		if (!unsupported && !(code.attr("co_flags").to_cLL() & (CO_GENERATOR | CO_COROUTINE | CO_ASYNC_GENERATOR))) {
+			try {
+				body = std::make_unique<Function>(appender.globals_ns, ManagedPyo(Py_None, true), name, static_cast<int>(args.size()));
+				body->first_line = appender.first_line;
+				bind_args(*body);
+				for (auto free_obj : code.attr("co_freevars")) {
+					auto reg = static_cast<local_t>(body->locals.size() + 1);
+					body->locals[free_obj.to_cstr()] = reg;
+					body->cells.insert(free_obj.to_cstr());
+					body->free_cells.push_back(reg);
+				}
+				emit_body(*body, code);
+			}
+			catch (std::exception&) {
+				PyErr_Clear();
+				body.reset();
+			}
+		}
+		local_t result = new_temp_var(appender);
+		appender.add_insn(make_function_ins(
+			result, ManagedPyo(new_function_proto(code, appender.globals_ns, std::move(body))),
+			defaults_reg, kw_defaults_reg, closure_reg
+		));
+		for (auto it = decorator_regs.rbegin(); it != decorator_regs.rend(); ++it) {
+			local_t decorated = new_temp_var(appender);
+			appender.add_insn(call_ins(decorated, *it, { result }, {}, appender.new_callsite()));
+			result = decorated;
+		}
+		if (lambda)
+			return result;
+		Name target(name);
+		assn_ir(appender, &target, result);
+		return -1;
 	}
 	std::unique_ptr<Function> FuncDef::emit_ir_f(ManagedPyo pyfunc) {
+		if (unsupported)
+			std::rethrow_exception(unsupported);
 		auto global_ns = pyfunc.attr("__globals__");
 		auto deref_ns = pyfunc.attr("__closure__");
+		auto code = pyfunc.attr("__code__");
 		auto appender = std::make_unique<Function>(global_ns, deref_ns, name, static_cast<int>(args.size()));
+		appender->first_line = static_cast<int>(code.attr("co_firstlineno").to_cLL());
 
-		for (size_t i = 0; i < args.size(); i++) {
-			appender->locals[args[i]] = (int)i + 1;
-		}
+		bind_args(*appender);
 		if (!(deref_ns == Py_None)) {
 			local_t idx = 0;
-			for (const auto& closurevar : pyfunc.attr("__code__").attr("co_freevars")) {
+			for (const auto& closurevar : code.attr("co_freevars")) {
 				appender->closure[closurevar.to_cstr()] = idx++;
 			}
 		}
-
-		appender->add_insn(prolog_ins());
-		for (auto& stmt : body_stmts) {
-			stmt->emit_ir(*appender);
-		}
-		// Return none if not yet.
-		Return ret_none_default = Return(
-			std::unique_ptr<AST>(new Constant(ManagedPyo(Py_None, true)))
-		);
-		ret_none_default.emit_ir(*appender);
-		appender->add_insn(epilog_ins());
+		emit_body(*appender, code);
 
 		/*std::cout << appender->name << " exctable:" << std::endl;
 		for (auto i = 0; i < appender->exctable_key.size(); i++)
@@ -437,6 +856,10 @@ namespace yapyjit {
 		{
 		case ASTTag::NAME: {
 			const auto& id = ((Name*)dst)->identifier;
+			if (appender.cells.count(id)) {
+				appender.add_insn(store_cell_ins(src, appender.locals[id]));
+				break;
+			}
 			// TODO: Check validity by analysis after IR is gen.
 			/*if (appender.globals.count(id)) {
 				throw std::invalid_argument(
@@ -1,4 +1,8 @@
 #include <stdint.h>
+#include <algorithm>
+#include <iterator>
+#include <set>
+#include <unordered_map>
 #include <yapyjit.h>
 #include <mpyo.h>
 
@@ -13,8 +17,27 @@ constexpr inline long long simple_hash(const char* s) {
 }
 
 #define TARGET(cls) case simple_hash(#cls):
+// Interned attribute name, created once per use site.
+#define FIELD(name) (context().intern(#name))
 
 namespace yapyjit {
+	// Per-type dispatch info of AST nodes, keyed by type object.
+	// The node types of the `ast` module differ between interpreters, so is the cache.
+	const AstTypeInfo& ast_type_info(const ManagedPyo& node) {
+		auto& cache = context().ast_types;
+		PyTypeObject* ty = Py_TYPE(node.borrow());
+		auto it = cache.find(ty);
+		if (it != cache.end())
+			return it->second;
+		auto name = node.type().attr(FIELD(__name__));
+		PyObject* fields = PyObject_GetAttr((PyObject*)ty, FIELD(_fields));
+		if (!fields) PyErr_Clear();
+		Py_INCREF(ty);
+		return cache.emplace(ty, AstTypeInfo{ simple_hash(name.to_cstr()), name.to_cstr(), fields }).first->second;
+	}
+	inline const char* ast_type_name(const ManagedPyo& node) {
+		return ast_type_info(node).name.c_str();
+	}
 	inline std::unique_ptr<AST> _helper_slice_cvt(const ManagedPyo& pyo) {
 		return pyo == Py_None ? std::make_unique<Constant>(ManagedPyo(Py_None, true)) : ast_py2native(pyo);
 	}
@@ -26,123 +49,574 @@ namespace yapyjit {
 		if (!obj) throw std::logic_error(__FUNCTION__" cannot get builtins." + name + ".");
 		return std::make_unique<Constant>(ManagedPyo(obj, true));
 	}
-	void recursive_var_replacement(ManagedPyo ast_man, ManagedPyo oldv, ManagedPyo newv) {
-		auto ast_mod = ManagedPyo(PyImport_ImportModule("ast"));
-		auto name_type = ast_mod.attr("Name");
-		for (auto node : ast_mod.attr("walk").call(ast_man.borrow()).list()) {
-			if (node.type().ref_eq(name_type)) {
-				if (PyObject_RichCompareBool(node.attr("id").borrow(), oldv.borrow(), Py_EQ)) {
-					node.attr("id", newv);
+	// Calls `fn` on each node of type `type_hash` (see `simple_hash`) in the subtree, not looking into those nodes.
+	template<typename F>
+	void for_each_node(ManagedPyo node, long long type_hash, F&& fn) {
+		const auto& info = ast_type_info(node);
+		if (info.hash == type_hash) {
+			fn(node);
+			return;
+		}
+		if (!info.fields)
+			return;
+		for (auto field : ManagedPyo(info.fields, true)) {
+			auto child = node.attr(field.borrow());
+			if (PyList_CheckExact(child.borrow())) {
+				for (auto sub : child)
+					if (ast_type_info(sub).fields)
+						for_each_node(sub, type_hash, fn);
+			}
+			else if (ast_type_info(child).fields)
+				for_each_node(child, type_hash, fn);
+		}
+	}
+	// Calls `fn` on each `Name` node in the subtree.
+	template<typename F>
+	void for_each_name(ManagedPyo node, F&& fn) {
+		for_each_node(node, simple_hash("Name"), fn);
+	}
+	// Renames `Name` nodes in the subtree according to `renames` (str -> str) in a single walk.
+	// Lambdas keep the names in their bodies, which match their code objects, and note the renames instead.
+	void rename_vars(ManagedPyo node, PyObject* renames) {
+		if (PyList_CheckExact(node.borrow())) {
+			for (auto sub : node)
+				rename_vars(sub, renames);
+			return;
+		}
+		const auto& info = ast_type_info(node);
+		if (info.hash == simple_hash("Name")) {
+			PyObject* newv = PyDict_GetItemWithError(renames, node.attr(FIELD(id)).borrow());
+			if (newv)
+				PyObject_SetAttr(node.borrow(), FIELD(id), newv);
+			else if (PyErr_Occurred())
+				throw registered_pyexc();
+			return;
+		}
+		if (info.hash == simple_hash("Lambda")) {
+			// Defaults are evaluated in the enclosing function.
+			auto arguments = node.attr(FIELD(args));
+			rename_vars(arguments.attr(FIELD(defaults)), renames);
+			rename_vars(arguments.attr(FIELD(kw_defaults)), renames);
+			// Renames of an enclosing comprehension apply to its variables renamed again by this one.
+			ManagedPyo merged = PyDict_New();
+			PyObject* noted = PyObject_GetAttr(node.borrow(), FIELD(_yapyjit_free_renames));
+			if (noted) {
+				PyObject *key, *value;
+				Py_ssize_t pos = 0;
+				while (PyDict_Next(noted, &pos, &key, &value)) {
+					PyObject* newv = PyDict_GetItemWithError(renames, value);
+					PyDict_SetItem(merged.borrow(), key, newv ? newv : value);
 				}
+				Py_DECREF(noted);
 			}
+			else
+				PyErr_Clear();
+			if (PyDict_Merge(merged.borrow(), renames, 0) < 0
+				|| PyObject_SetAttr(node.borrow(), FIELD(_yapyjit_free_renames), merged.borrow()) < 0)
+				throw registered_pyexc();
+			return;
 		}
+		if (!info.fields)
+			return;
+		for (auto field : ManagedPyo(info.fields, true)) {
+			auto child = node.attr(field.borrow());
+			if (PyList_CheckExact(child.borrow()) || ast_type_info(child).fields)
+				rename_vars(child, renames);
+		}
+	}
+	// Adds the names in `binds` that lambdas in `node` capture to `captured`.
+	void collect_captured_binds(ManagedPyo node, const std::set<std::string>& binds, std::set<std::string>& captured) {
+		for_each_node(node, simple_hash("Lambda"), [&](ManagedPyo lambda) {
+			PyObject* renames = PyObject_GetAttr(lambda.borrow(), FIELD(_yapyjit_free_renames));
+			if (!renames)
+				PyErr_Clear();
+			for_each_name(lambda.attr(FIELD(body)), [&](ManagedPyo name) {
+				auto id = name.attr(FIELD(id));
+				PyObject* renamed = renames ? PyDict_GetItemWithError(renames, id.borrow()) : nullptr;
+				const std::string bound = renamed ? PyUnicode_AsUTF8(renamed) : id.to_cstr();
+				if (binds.count(bound))
+					captured.insert(bound);
+			});
+			Py_XDECREF(renames);
+		});
+	}
+	// Variables of the comprehension or generator expression `ast_man` captured by lambdas in it, out of `binds`.
+	std::set<std::string> comprehension_captures(ManagedPyo ast_man, const std::vector<ManagedPyo>& binds, bool dict) {
+		std::set<std::string> names, captured;
+		for (auto bind : binds)
+			names.insert(bind.to_cstr());
+		if (dict) {
+			collect_captured_binds(ast_man.attr(FIELD(key)), names, captured);
+			collect_captured_binds(ast_man.attr(FIELD(value)), names, captured);
+		}
+		else
+			collect_captured_binds(ast_man.attr(FIELD(elt)), names, captured);
+		bool first = true;
+		for (auto gen : ast_man.attr(FIELD(generators))) {
+			for (auto cond : gen.attr(FIELD(ifs)))
+				collect_captured_binds(cond, names, captured);
+			if (!first)
+				collect_captured_binds(gen.attr(FIELD(iter)), names, captured);
+			first = false;
+		}
+		return captured;
 	}
-	void collect_comprehension_binds(std::vector<ManagedPyo>& names, ManagedPyo target, short mode) {
-		switch (simple_hash(target.type().attr("__name__").to_cstr())) {
+	void collect_comprehension_binds(std::vector<ManagedPyo>& names, ManagedPyo target) {
+		switch (ast_type_info(target).hash) {
 			TARGET(Name) {
-				names.push_back(target.attr("id"));
+				names.push_back(target.attr(FIELD(id)));
 				break;
 			}
 			TARGET(List)
 			TARGET(Tuple) {
-				if (mode == 0)
-					for (auto sub : target.attr("elts")) {
-						collect_comprehension_binds(names, sub, mode);
-					}
-				else {
-					for (auto sub : target.attr("key")) {
-						collect_comprehension_binds(names, sub, mode);
-					}
-					for (auto sub : target.attr("value")) {
-						collect_comprehension_binds(names, sub, mode);
-					}
+				for (auto sub : target.attr(FIELD(elts))) {
+					collect_comprehension_binds(names, sub);
 				}
 				break;
 			}
 		}
 	}
-	std::unique_ptr<AST> lower_comprehension(ManagedPyo ast_man, ManagedPyo init_callable, ManagedPyo add_callable, short mode = 0) {
+	// Wraps `current` into the loops and conditions of comprehension `generators`.
+	// If `genexp`, the outermost loop iterates the argument of a generator body.
+	AST* wrap_comprehension_loops(ManagedPyo generators, AST* current, bool genexp = false) {
+		for (int i = generators.length() - 1; i >= 0; i--) {
+			auto gen = generators[i];
+			for (auto cond : gen.attr(FIELD(ifs))) {
+				std::vector<std::unique_ptr<AST>> body, orelse;
+				body.push_back(std::unique_ptr<AST>(current));
+				current = new If(
+					ast_py2native(cond), body, orelse
+				);
+			}
+			{
+				std::vector<std::unique_ptr<AST>> body, orelse;
+				body.push_back(std::unique_ptr<AST>(current));
+				std::unique_ptr<AST> iter = genexp && i == 0
+					? std::make_unique<Name>(GeneratorExp::iter_name)
+					: ast_py2native(gen.attr(FIELD(iter)));
+				current = new For(
+					ast_py2native(gen.attr(FIELD(target))),
+					std::move(iter),
+					body, orelse
+				);
+			}
+		}
+		return current;
+	}
+	std::unique_ptr<AST> lower_comprehension(ManagedPyo ast_man, std::unique_ptr<AST>&& init, InsnTag add_op) {
+		const short mode = add_op == +InsnTag::MapAdd ? 1 : 0;
 		auto result = std::make_unique<ValueBlock>();
-		auto init_fn = new Constant(init_callable);
 		auto comp_name = std::string("_yapyjit_comp_r_") + std::to_string((intptr_t)ast_man.borrow());
 		result->new_stmt(new Assign(
-			std::unique_ptr<AST>(new Call(std::unique_ptr<AST>(init_fn))),
+			std::move(init),
 			std::unique_ptr<AST>(new Name(comp_name))
 		));
+		auto generators = ast_man.attr(FIELD(generators));
 		std::vector<ManagedPyo> names;
-		for (auto gen : ast_man.attr("generators")) {
-			collect_comprehension_binds(names, gen.attr("target"), mode);
+		for (auto gen : generators) {
+			collect_comprehension_binds(names, gen.attr(FIELD(target)));
 		}
+		// Captured variables get names of their own, the cells are not shared with other comprehensions.
+		const auto captured = comprehension_captures(ast_man, names, mode == 1);
+		const std::string captured_prefix = "_yapyjit_comp_" + std::to_string((intptr_t)ast_man.borrow()) + "_";
+		std::vector<std::string> cells;
+		ManagedPyo renames = PyDict_New();
 		for (auto old_name : names) {
-			auto new_name = ManagedPyo::from_str("_yapyjit_comp_").attr("__add__").call(old_name.borrow());
+			const bool cell = captured.count(old_name.to_cstr());
+			auto new_name = ManagedPyo(PyUnicode_Concat(
+				ManagedPyo::from_str(cell ? captured_prefix.c_str() : "_yapyjit_comp_").borrow(), old_name.borrow()
+			));
+			if (cell)
+				cells.push_back(new_name.to_cstr());
+			PyDict_SetItem(renames.borrow(), old_name.borrow(), new_name.borrow());
+		}
+		if (!names.empty()) {
 			if (mode == 0)
-				recursive_var_replacement(ast_man.attr("elt"), old_name, new_name);
+				rename_vars(ast_man.attr(FIELD(elt)), renames.borrow());
 			else {
-				recursive_var_replacement(ast_man.attr("key"), old_name, new_name);
-				recursive_var_replacement(ast_man.attr("value"), old_name, new_name);
+				rename_vars(ast_man.attr(FIELD(key)), renames.borrow());
+				rename_vars(ast_man.attr(FIELD(value)), renames.borrow());
 			}
 			bool first = true;
-			for (auto gen : ast_man.attr("generators")) {
-				recursive_var_replacement(gen.attr("target"), old_name, new_name);
-				for (auto cond : gen.attr("ifs")) {
-					recursive_var_replacement(cond, old_name, new_name);
+			for (auto gen : generators) {
+				rename_vars(gen.attr(FIELD(target)), renames.borrow());
+				for (auto cond : gen.attr(FIELD(ifs))) {
+					rename_vars(cond, renames.borrow());
 				}
 				if (!first) {
-					recursive_var_replacement(gen.attr("iter"), old_name, new_name);
+					rename_vars(gen.attr(FIELD(iter)), renames.borrow());
 				}
 				first = false;
 			}
 		}
-		std::vector<std::unique_ptr<AST>> args_add;
-		args_add.push_back(std::unique_ptr<AST>(new Name(comp_name)));
-		if (mode == 0)
-			args_add.push_back(ast_py2native(ast_man.attr("elt")));
-		else {
-			args_add.push_back(ast_py2native(ast_man.attr("key")));
-			args_add.push_back(ast_py2native(ast_man.attr("value")));
+		AST* current = mode == 0
+			? new CompAdd(std::make_unique<Name>(comp_name), nullptr, ast_py2native(ast_man.attr(FIELD(elt))), add_op)
+			: new CompAdd(
+				std::make_unique<Name>(comp_name),
+				ast_py2native(ast_man.attr(FIELD(key))),
+				ast_py2native(ast_man.attr(FIELD(value))),
+				add_op
+			);
+		if (!cells.empty())
+			result->new_stmt(new CellDecl(cells));
+		result->new_stmt(wrap_comprehension_loops(generators, current));
+		result->new_stmt(new Name(comp_name));
+		return result;
+	}
+	// Defaults of a `def` or `lambda`, evaluated by the enclosing function.
+	void defaults_py2native(FuncDef& def, ManagedPyo arguments) {
+		for (auto value : arguments.attr(FIELD(defaults)))
+			def.defaults.push_back(ast_py2native(value));
+		auto kw_defaults = arguments.attr(FIELD(kw_defaults));
+		int i = 0;
+		for (auto arg : arguments.attr(FIELD(kwonlyargs))) {
+			auto value = kw_defaults[i++];
+			if (!(value == Py_None))
+				def.kw_defaults.push_back({ arg.attr(FIELD(arg)).to_cstr(), ast_py2native(value) });
 		}
-		AST* current = new Call(
-			std::unique_ptr<AST>(new Constant(add_callable)), args_add
+	}
+	bool is_name(ManagedPyo node, const std::string& id) {
+		return ast_type_info(node).hash == simple_hash("Name") && id == node.attr(FIELD(id)).to_cstr();
+	}
+	// Number of calls `f(*vararg, **kwarg)` in `node`, a node or a list of them.
+	int count_forwards(ManagedPyo node, const std::string& vararg, const std::string& kwarg) {
+		if (PyList_CheckExact(node.borrow())) {
+			int result = 0;
+			for (auto sub : node)
+				result += count_forwards(sub, vararg, kwarg);
+			return result;
+		}
+		int result = 0;
+		for_each_node(node, simple_hash("Call"), [&](ManagedPyo call) {
+			auto args = call.attr(FIELD(args));
+			auto keywords = call.attr(FIELD(keywords));
+			if (args.length() == 1 && keywords.length() == 1
+				&& ast_type_info(args[0]).hash == simple_hash("Starred") && is_name(args[0].attr(FIELD(value)), vararg)
+				&& keywords[0].attr(FIELD(arg)) == Py_None && is_name(keywords[0].attr(FIELD(value)), kwarg))
+				result++;
+			result += count_forwards(call.attr(FIELD(func)), vararg, kwarg);
+			result += count_forwards(args, vararg, kwarg);
+			result += count_forwards(keywords, vararg, kwarg);
+		});
+		return result;
+	}
+	// Whether `*vararg` and `**kwarg` are only passed on unchanged in `body`, a node or a list of them.
+	bool only_forwards(ManagedPyo body, const std::string& vararg, const std::string& kwarg) {
+		int nvararg = 0, nkwarg = 0;
+		auto count = [&](ManagedPyo name) {
+			nvararg += is_name(name, vararg);
+			nkwarg += is_name(name, kwarg);
+		};
+		if (PyList_CheckExact(body.borrow()))
+			for (auto stmt : body)
+				for_each_name(stmt, count);
+		else
+			for_each_name(body, count);
+		const int nforwards = count_forwards(body, vararg, kwarg);
+		return nforwards > 0 && nvararg == nforwards && nkwarg == nforwards;
+	}
+	// Parameters and body of `node`, a `def` or `lambda`. If they are not supported, the error is kept in `def`.
+	template<typename BodyT>
+	void body_py2native(FuncDef& def, ManagedPyo node, BodyT body) {
+		try {
+			auto arguments = node.attr(FIELD(args));
+			for (auto arg : arguments.attr(FIELD(posonlyargs)))
+				def.args.push_back(arg.attr(FIELD(arg)).to_cstr());
+			for (auto arg : arguments.attr(FIELD(args)))
+				def.args.push_back(arg.attr(FIELD(arg)).to_cstr());
+			for (auto arg : arguments.attr(FIELD(kwonlyargs)))
+				def.args.push_back(arg.attr(FIELD(arg)).to_cstr());
+			auto vararg = arguments.attr(FIELD(vararg));
+			if (!(vararg == Py_None))
+				def.vararg = vararg.attr(FIELD(arg)).to_cstr();
+			auto kwarg = arguments.attr(FIELD(kwarg));
+			if (!(kwarg == Py_None))
+				def.kwarg = kwarg.attr(FIELD(arg)).to_cstr();
+			if (!def.vararg.empty() && !def.kwarg.empty())
+				def.forwards = only_forwards(node.attr(FIELD(body)), def.vararg, def.kwarg);
+			body(def.body_stmts);
+		}
+		catch (std::exception&) {
+			PyErr_Clear();
+			def.args.clear();
+			def.vararg.clear();
+			def.kwarg.clear();
+			def.forwards = false;
+			def.body_stmts.clear();
+			def.unsupported = std::current_exception();
+		}
+	}
+	std::unique_ptr<AST> lower_generator_exp(ManagedPyo ast_man) {
+		auto generators = ast_man.attr(FIELD(generators));
+		std::vector<ManagedPyo> binds;
+		for (auto gen : generators) {
+			collect_comprehension_binds(binds, gen.attr(FIELD(target)));
+		}
+		std::set<std::string> names;
+		auto collect = [&names](ManagedPyo name) { names.insert(name.attr(FIELD(id)).to_cstr()); };
+		for_each_name(ast_man.attr(FIELD(elt)), collect);
+		bool first = true;
+		for (auto gen : generators) {
+			for (auto cond : gen.attr(FIELD(ifs))) {
+				for_each_name(cond, collect);
+			}
+			if (!first) {
+				for_each_name(gen.attr(FIELD(iter)), collect);
+			}
+			first = false;
+		}
+		for (auto bind : binds) {
+			names.erase(bind.to_cstr());
+		}
+
+		AST* yield = new Assign(std::unique_ptr<AST>(new Yield(ast_py2native(ast_man.attr(FIELD(elt))))));
+		auto body = std::make_unique<ValueBlock>();
+		const auto captured = comprehension_captures(ast_man, binds, false);
+		if (!captured.empty())
+			body->new_stmt(new CellDecl(std::vector<std::string>(captured.begin(), captured.end())));
+		body->new_stmt(wrap_comprehension_loops(generators, yield, true));
+		return std::make_unique<GeneratorExp>(
+			ast_py2native(generators[0].attr(FIELD(iter))),
+			std::move(body),
+			std::vector<std::string>(names.begin(), names.end())
 		);
-		auto it = ast_man.attr("generators").end();
-		while (it != ast_man.attr("generators").begin())
-		{
-			--it;
-			for (auto cond : (*it).attr("ifs")) {
-				std::vector<std::unique_ptr<AST>> body, orelse;
-				body.push_back(std::unique_ptr<AST>(current));
-				current = new If(
-					ast_py2native(cond), body, orelse
-				);
+	}
+	/*
+	 * Constant folding and dead code removal. The bytecode front end gets these from the CPython compiler.
+	 * Results that may be huge are left to runtime, with the limits of CPython (`ast_opt.c`).
+	 */
+	constexpr Py_ssize_t fold_max_str_size = 4096;
+	constexpr Py_ssize_t fold_max_collection_size = 256;
+	constexpr long long fold_max_shift = 128;
+
+	// Literal value of `node` (borrowed), nullptr if it is not a `Constant`.
+	inline PyObject* literal_of(const std::unique_ptr<AST>& node) {
+		return node->tag() == +ASTTag::CONST ? static_cast<Constant*>(node.get())->value.borrow() : nullptr;
+	}
+	// Whether `obj` is immutable: None, Ellipsis, numbers, strings and tuples of these.
+	bool is_immutable_literal(PyObject* obj) {
+		if (obj == Py_None || obj == Py_Ellipsis || PyLong_CheckExact(obj) || PyBool_Check(obj) || PyFloat_CheckExact(obj)
+			|| PyComplex_CheckExact(obj) || PyUnicode_CheckExact(obj) || PyBytes_CheckExact(obj))
+			return true;
+		if (!PyTuple_CheckExact(obj))
+			return false;
+		for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(obj); i++)
+			if (!is_immutable_literal(PyTuple_GET_ITEM(obj, i)))
+				return false;
+		return true;
+	}
+	// Size of a str, bytes or tuple literal, -1 for other objects.
+	inline Py_ssize_t literal_seq_size(PyObject* obj) {
+		if (PyUnicode_CheckExact(obj))
+			return PyUnicode_GET_LENGTH(obj);
+		if (PyBytes_CheckExact(obj) || PyTuple_CheckExact(obj))
+			return Py_SIZE(obj);
+		return -1;
+	}
+	// Whether `l op r` might build a huge object or format a string, and is not folded.
+	bool fold_unsafe(InsnTag op, PyObject* l, PyObject* r) {
+		switch (op) {
+		case InsnTag::Mult:
+			for (int i = 0; i < 2; i++) {
+				PyObject* seq = i ? r : l;
+				PyObject* n = i ? l : r;
+				Py_ssize_t size = literal_seq_size(seq);
+				if (size > 0 && PyLong_Check(n)) {
+					const Py_ssize_t limit = PyTuple_CheckExact(seq) ? fold_max_collection_size : fold_max_str_size;
+					const Py_ssize_t times = PyLong_AsSsize_t(n);
+					if (times == -1 && PyErr_Occurred()) {
+						PyErr_Clear();
+						return true;
+					}
+					if (times > limit / size)
+						return true;
+				}
 			}
-			{
-				std::vector<std::unique_ptr<AST>> body, orelse;
-				body.push_back(std::unique_ptr<AST>(current));
-				current = new For(
-					ast_py2native((*it).attr("target")),
-					ast_py2native((*it).attr("iter")),
-					body, orelse
-				);
+			return false;
+		case InsnTag::Pow:
+		case InsnTag::LShift: {
+			if (!PyLong_Check(l) || !PyLong_Check(r))
+				return false;
+			int overflow;
+			return PyLong_AsLongLongAndOverflow(r, &overflow) > fold_max_shift || overflow > 0;
+		}
+		case InsnTag::Mod:
+			return PyUnicode_CheckExact(l) || PyBytes_CheckExact(l);
+		default:
+			return false;
+		}
+	}
+	// Folds `l op r` with a `BinOp` operator. Returns a new reference, or nullptr without an exception set.
+	PyObject* fold_binop(InsnTag op, PyObject* l, PyObject* r) {
+		if (!is_immutable_literal(l) || !is_immutable_literal(r) || fold_unsafe(op, l, r))
+			return nullptr;
+		PyObject* result;
+		switch (op) {
+		case InsnTag::Add: result = PyNumber_Add(l, r); break;
+		case InsnTag::Sub: result = PyNumber_Subtract(l, r); break;
+		case InsnTag::Mult: result = PyNumber_Multiply(l, r); break;
+		case InsnTag::Div: result = PyNumber_TrueDivide(l, r); break;
+		case InsnTag::Mod: result = PyNumber_Remainder(l, r); break;
+		case InsnTag::Pow: result = PyNumber_Power(l, r, Py_None); break;
+		case InsnTag::LShift: result = PyNumber_Lshift(l, r); break;
+		case InsnTag::RShift: result = PyNumber_Rshift(l, r); break;
+		case InsnTag::BitOr: result = PyNumber_Or(l, r); break;
+		case InsnTag::BitXor: result = PyNumber_Xor(l, r); break;
+		case InsnTag::BitAnd: result = PyNumber_And(l, r); break;
+		case InsnTag::FloorDiv: result = PyNumber_FloorDivide(l, r); break;
+		default: return nullptr;
+		}
+		// Errors such as `1 / 0` are raised at runtime.
+		if (!result)
+			PyErr_Clear();
+		return result;
+	}
+	// Folds `op operand` with a `UnaryOp` operator. Returns a new reference, or nullptr without an exception set.
+	PyObject* fold_unaryop(InsnTag op, PyObject* operand) {
+		if (!is_immutable_literal(operand))
+			return nullptr;
+		PyObject* result;
+		switch (op) {
+		case InsnTag::Invert: result = PyNumber_Invert(operand); break;
+		case InsnTag::UAdd: result = PyNumber_Positive(operand); break;
+		case InsnTag::USub: result = PyNumber_Negative(operand); break;
+		case InsnTag::Not: {
+			const int r = PyObject_Not(operand);
+			result = r < 0 ? nullptr : PyBool_FromLong(r);
+			break;
+		}
+		default: return nullptr;
+		}
+		if (!result)
+			PyErr_Clear();
+		return result;
+	}
+	// Truth of a literal condition: 1 or 0, -1 if it is not known at compile time.
+	int literal_truth(const std::unique_ptr<AST>& test) {
+		PyObject* value = literal_of(test);
+		if (!value || !is_immutable_literal(value))
+			return -1;
+		const int truth = PyObject_IsTrue(value);
+		if (truth < 0)
+			PyErr_Clear();
+		return truth;
+	}
+	// Adds the names bound by `node`, dropped code or a list of it, to `names`. Nested scopes are skipped.
+	void collect_local_binds(ManagedPyo node, std::vector<std::string>& names) {
+		if (PyList_CheckExact(node.borrow())) {
+			for (auto sub : node)
+				collect_local_binds(sub, names);
+			return;
+		}
+		const auto& info = ast_type_info(node);
+		switch (info.hash) {
+			TARGET(Name) {
+				if (ast_type_info(node.attr(FIELD(ctx))).hash != simple_hash("Load"))
+					names.push_back(node.attr(FIELD(id)).to_cstr());
+				return;
+			}
+			TARGET(FunctionDef)
+			TARGET(AsyncFunctionDef)
+			TARGET(ClassDef) {
+				names.push_back(node.attr(FIELD(name)).to_cstr());
+				return;
+			}
+			TARGET(Lambda)
+			TARGET(ListComp)
+			TARGET(SetComp)
+			TARGET(DictComp)
+			TARGET(GeneratorExp)
+				return;
+			TARGET(ExceptHandler) {
+				auto name = node.attr(FIELD(name));
+				if (!(name == Py_None))
+					names.push_back(name.to_cstr());
+				break;
+			}
+			TARGET(alias) {
+				// `import a.b` binds `a`.
+				auto asname = node.attr(FIELD(asname));
+				const std::string name = (asname == Py_None ? node.attr(FIELD(name)) : asname).to_cstr();
+				if (name != "*")
+					names.push_back(name.substr(0, name.find('.')));
+				return;
 			}
 		}
-		result->new_stmt(current);
-		result->new_stmt(new Name(comp_name));
+		if (!info.fields)
+			return;
+		for (auto field : ManagedPyo(info.fields, true)) {
+			auto child = node.attr(field.borrow());
+			if (PyList_CheckExact(child.borrow()) || ast_type_info(child).fields)
+				collect_local_binds(child, names);
+		}
+	}
+	// Adds the declarations in dropped statements `stmts`, which still apply to the function:
+	// the `global` statements, and the names bound, which are local.
+	void keep_declarations(ManagedPyo stmts, std::vector<std::unique_ptr<AST>>& into) {
+		for (auto stmt : stmts)
+			for_each_node(stmt, simple_hash("Global"), [&into](ManagedPyo decl) {
+				into.push_back(ast_py2native(decl));
+			});
+		std::vector<std::string> names;
+		collect_local_binds(stmts, names);
+		if (!names.empty())
+			into.push_back(std::make_unique<LocalDecl>(names));
+	}
+	// Converts a list of statements, dropping those after a `return`, `raise`, `break` or `continue`.
+	std::vector<std::unique_ptr<AST>> block_py2native(ManagedPyo stmts) {
+		std::vector<std::unique_ptr<AST>> result;
+		const int n = stmts.length();
+		for (int i = 0; i < n; i++) {
+			auto stmt = ast_py2native(stmts[i]);
+			if (!stmt)
+				continue;
+			const auto tag = stmt->tag();
+			result.push_back(std::move(stmt));
+			if (tag == +ASTTag::RETURN || tag == +ASTTag::RAISE || tag == +ASTTag::BREAK || tag == +ASTTag::CONTINUE) {
+				// Declared first, the names may be read before.
+				ManagedPyo rest = PyList_GetSlice(stmts.borrow(), i + 1, n);
+				std::vector<std::unique_ptr<AST>> declarations;
+				keep_declarations(rest, declarations);
+				result.insert(result.begin(), std::make_move_iterator(declarations.begin()), std::make_move_iterator(declarations.end()));
+				break;
+			}
+		}
+		return result;
+	}
+	// Block of the statements `stmts` in place of a statement whose other branch is dropped.
+	std::unique_ptr<AST> live_branch(std::vector<std::unique_ptr<AST>>& stmts, ManagedPyo dropped) {
+		auto result = std::make_unique<ValueBlock>();
+		keep_declarations(dropped, result->body_stmts);
+		for (auto& stmt : stmts)
+			result->body_stmts.push_back(std::move(stmt));
 		return result;
 	}
+	// Expression `expr` in place of one whose other branch `dropped` is dropped, which may bind names with `:=`.
+	std::unique_ptr<AST> live_expr(std::unique_ptr<AST>&& expr, ManagedPyo dropped) {
+		std::vector<std::string> names;
+		collect_local_binds(dropped, names);
+		if (names.empty())
+			return std::move(expr);
+		auto result = std::make_unique<ValueBlock>();
+		result->new_stmt(new LocalDecl(names));
+		result->body_stmts.push_back(std::move(expr));
+		return result;
+	}
+
 	std::unique_ptr<AST> ast_py2native(ManagedPyo ast_man) {
 		// auto ast_mod = ManagedPyo(PyImport_ImportModule("ast"));
-		switch (simple_hash(ast_man.type().attr("__name__").to_cstr())) {
+		switch (ast_type_info(ast_man).hash) {
 			TARGET(BoolOp) {
 				OpBool op = OpBool::_from_string(
-					ast_man.attr("op").type().attr("__name__").to_cstr()
+					ast_type_name(ast_man.attr(FIELD(op)))
 				);
 				std::unique_ptr<AST> ret = std::make_unique<BoolOp>(
-					ast_py2native(ast_man.attr("values")[0]),
-					ast_py2native(ast_man.attr("values")[1]),
+					ast_py2native(ast_man.attr(FIELD(values))[0]),
+					ast_py2native(ast_man.attr(FIELD(values))[1]),
 					op
 				);
 				int skip = 0;
-				for (auto val : ast_man.attr("values")) {
+				for (auto val : ast_man.attr(FIELD(values))) {
 					if (skip < 2) { ++skip; continue; }
 					ret = std::make_unique<BoolOp>(
 						std::move(ret),
@@ -154,87 +628,106 @@ namespace yapyjit {
 			}
 			TARGET(NamedExpr) {
 				return std::make_unique<NamedExpr>(
-					ast_py2native(ast_man.attr("value")),
-					ast_py2native(ast_man.attr("target"))
+					ast_py2native(ast_man.attr(FIELD(value))),
+					ast_py2native(ast_man.attr(FIELD(target)))
 				);
 			}
 			TARGET(BinOp) {
 				InsnTag op = InsnTag::_from_string(
-					ast_man.attr("op").type().attr("__name__").to_cstr()
-				);
-				return std::make_unique<BinOp>(
-					ast_py2native(ast_man.attr("left")),
-					ast_py2native(ast_man.attr("right")),
-					op
+					ast_type_name(ast_man.attr(FIELD(op)))
 				);
+				auto left = ast_py2native(ast_man.attr(FIELD(left)));
+				auto right = ast_py2native(ast_man.attr(FIELD(right)));
+				if (literal_of(left) && literal_of(right)) {
+					PyObject* folded = fold_binop(op, literal_of(left), literal_of(right));
+					if (folded)
+						return std::make_unique<Constant>(ManagedPyo(folded));
+				}
+				return std::make_unique<BinOp>(std::move(left), std::move(right), op);
 			}
 			TARGET(UnaryOp) {
 				InsnTag op = InsnTag::_from_string(
-					ast_man.attr("op").type().attr("__name__").to_cstr()
-				);
-				return std::make_unique<UnaryOp>(
-					ast_py2native(ast_man.attr("operand")),
-					op
+					ast_type_name(ast_man.attr(FIELD(op)))
 				);
+				auto operand = ast_py2native(ast_man.attr(FIELD(operand)));
+				if (literal_of(operand)) {
+					PyObject* folded = fold_unaryop(op, literal_of(operand));
+					if (folded)
+						return std::make_unique<Constant>(ManagedPyo(folded));
+				}
+				return std::make_unique<UnaryOp>(std::move(operand), op);
 			}
 			TARGET(IfExp) {
+				auto test = ast_py2native(ast_man.attr(FIELD(test)));
+				switch (literal_truth(test)) {
+				case 1: return live_expr(ast_py2native(ast_man.attr(FIELD(body))), ast_man.attr(FIELD(orelse)));
+				case 0: return live_expr(ast_py2native(ast_man.attr(FIELD(orelse))), ast_man.attr(FIELD(body)));
+				}
 				return std::make_unique<IfExp>(
-					ast_py2native(ast_man.attr("test")),
-					ast_py2native(ast_man.attr("body")),
-					ast_py2native(ast_man.attr("orelse"))
+					std::move(test),
+					ast_py2native(ast_man.attr(FIELD(body))),
+					ast_py2native(ast_man.attr(FIELD(orelse)))
 				);
 			}
 			TARGET(Dict) {
 				std::vector<std::unique_ptr<AST>> keys{};
 				std::vector<std::unique_ptr<AST>> values{};
-				for (auto val : ast_man.attr("keys"))
+				for (auto val : ast_man.attr(FIELD(keys)))
 					keys.push_back(ast_py2native(val));
-				for (auto val : ast_man.attr("values"))
+				for (auto val : ast_man.attr(FIELD(values)))
 					values.push_back(ast_py2native(val));
 				return std::make_unique<Dict>(keys, values);
 			}
 			TARGET(List) {
 				std::vector<std::unique_ptr<AST>> elts{};
-				for (auto val : ast_man.attr("elts"))
+				for (auto val : ast_man.attr(FIELD(elts)))
 					elts.push_back(ast_py2native(val));
 				return std::make_unique<List>(elts);
 			}
 			TARGET(Set) {
 				std::vector<std::unique_ptr<AST>> elts{};
-				for (auto val : ast_man.attr("elts"))
+				for (auto val : ast_man.attr(FIELD(elts)))
 					elts.push_back(ast_py2native(val));
 				return std::make_unique<Set>(elts);
 			}
 			TARGET(Tuple) {
 				std::vector<std::unique_ptr<AST>> elts{};
-				for (auto val : ast_man.attr("elts"))
+				bool literal = ast_type_info(ast_man.attr(FIELD(ctx))).hash == simple_hash("Load");
+				for (auto val : ast_man.attr(FIELD(elts))) {
 					elts.push_back(ast_py2native(val));
+					literal = literal && literal_of(elts.back()) && is_immutable_literal(literal_of(elts.back()));
+				}
+				if (literal) {
+					ManagedPyo tuple = PyTuple_New(elts.size());
+					for (size_t i = 0; i < elts.size(); i++)
+						PyTuple_SET_ITEM(tuple.borrow(), i, ManagedPyo(literal_of(elts[i]), true).transfer());
+					return std::make_unique<Constant>(tuple);
+				}
 				return std::make_unique<Tuple>(elts);
 			}
-			TARGET(GeneratorExp)
+			TARGET(GeneratorExp) {
+				return lower_generator_exp(ast_man);
+			}
 			TARGET(ListComp) {
-				ManagedPyo init_callable((PyObject*)&PyList_Type, true);
-				ManagedPyo add_callable = init_callable.attr("append");
-				return lower_comprehension(ast_man, init_callable, add_callable);
+				std::vector<std::unique_ptr<AST>> elts{};
+				return lower_comprehension(ast_man, std::make_unique<List>(elts), InsnTag::ListAppend);
 			}
 			TARGET(SetComp) {
-				ManagedPyo init_callable((PyObject*)&PySet_Type, true);
-				ManagedPyo add_callable = init_callable.attr("add");
-				return lower_comprehension(ast_man, init_callable, add_callable);
+				std::vector<std::unique_ptr<AST>> elts{};
+				return lower_comprehension(ast_man, std::make_unique<Set>(elts), InsnTag::SetAdd);
 			}
 			TARGET(DictComp) {
-				ManagedPyo init_callable((PyObject*)&PyDict_Type, true);
-				ManagedPyo add_callable = init_callable.attr("__setitem__");
-				return lower_comprehension(ast_man, init_callable, add_callable, 1);
+				std::vector<std::unique_ptr<AST>> keys{}, values{};
+				return lower_comprehension(ast_man, std::make_unique<Dict>(keys, values), InsnTag::MapAdd);
 			}
 			TARGET(Compare) {
 				std::vector<InsnTag> ops{};
-				for (auto op : ast_man.attr("ops")) {
-					ops.push_back(InsnTag::_from_string(op.type().attr("__name__").to_cstr()));
+				for (auto op : ast_man.attr(FIELD(ops))) {
+					ops.push_back(InsnTag::_from_string(ast_type_name(op)));
 				}
 				std::vector<std::unique_ptr<AST>> values{};
-				values.push_back(ast_py2native(ast_man.attr("left")));
-				for (auto val : ast_man.attr("comparators")) {
+				values.push_back(ast_py2native(ast_man.attr(FIELD(left))));
+				for (auto val : ast_man.attr(FIELD(comparators))) {
 					values.push_back(ast_py2native(val));
 				}
 				return std::make_unique<Compare>(ops, values);
@@ -242,38 +735,53 @@ namespace yapyjit {
 			TARGET(Call) {
 				std::vector<std::unique_ptr<AST>> args{};
 				std::map<std::string, std::unique_ptr<AST>> kwargs;
-				for (auto val : ast_man.attr("args")) {
-					args.push_back(ast_py2native(val));
+				std::unique_ptr<AST> star_args, star_kwargs;
+				for (auto val : ast_man.attr(FIELD(args))) {
+					if (star_args)
+						throw std::invalid_argument("Only a trailing `*` argument is supported in calls.");
+					if (ast_type_info(val).hash == simple_hash("Starred"))
+						star_args = ast_py2native(val.attr(FIELD(value)));
+					else
+						args.push_back(ast_py2native(val));
 				}
-				for (auto kw : ast_man.attr("keywords")) {
-					kwargs[kw.attr("arg").to_cstr()] = ast_py2native(kw.attr("value"));
+				for (auto kw : ast_man.attr(FIELD(keywords))) {
+					if (kw.attr(FIELD(arg)) == Py_None) {
+						if (star_kwargs)
+							throw std::invalid_argument("Only one `**` argument is supported in calls.");
+						star_kwargs = ast_py2native(kw.attr(FIELD(value)));
+					}
+					else
+						kwargs[kw.attr(FIELD(arg)).to_cstr()] = ast_py2native(kw.attr(FIELD(value)));
 				}
-				return std::make_unique<Call>(
-					ast_py2native(ast_man.attr("func")), args, kwargs
+				auto result = std::make_unique<Call>(
+					ast_py2native(ast_man.attr(FIELD(func))), args, kwargs
 				);
+				result->star_args = std::move(star_args);
+				result->star_kwargs = std::move(star_kwargs);
+				return result;
 			}
 			TARGET(Attribute) {
 				return std::make_unique<Attribute>(
-					ast_py2native(ast_man.attr("value")),
-					ast_man.attr("attr").to_cstr()
+					ast_py2native(ast_man.attr(FIELD(value))),
+					ast_man.attr(FIELD(attr)).to_cstr()
 				);
 			}
 			TARGET(Subscript) {
 				return std::make_unique<Subscript>(
-					ast_py2native(ast_man.attr("value")),
-					ast_py2native(ast_man.attr("slice"))
+					ast_py2native(ast_man.attr(FIELD(value))),
+					ast_py2native(ast_man.attr(FIELD(slice)))
 				);
 			}
 			TARGET(Name) {
 				return std::make_unique<Name>(
-					ast_man.attr("id").to_cstr()
+					ast_man.attr(FIELD(id)).to_cstr()
 				);
 			}
 			TARGET(FormattedValue) {
-				std::unique_ptr<AST> val = ast_py2native(ast_man.attr("value"));
+				std::unique_ptr<AST> val = ast_py2native(ast_man.attr(FIELD(value)));
 				std::unique_ptr<AST> cvt = nullptr;
-				auto spec = ast_man.attr("format_spec");
-				switch (ast_man.attr("conversion").to_cLL()) {
+				auto spec = ast_man.attr(FIELD(format_spec));
+				switch (ast_man.attr(FIELD(conversion)).to_cLL()) {
 				case 97:
 					cvt = _helper_get_builtin_as_ast_constant("ascii"); break;
 				case 114:
@@ -289,7 +797,7 @@ namespace yapyjit {
 				std::vector<std::unique_ptr<AST>> fmtargs {};
 				fmtargs.push_back(std::move(val));
 				if (!(spec == Py_None))
-					fmtargs.push_back(ast_py2native(ast_man.attr("format_spec")));
+					fmtargs.push_back(ast_py2native(ast_man.attr(FIELD(format_spec))));
 				return std::make_unique<Call>(
 					_helper_get_builtin_as_ast_constant("format"),
 					fmtargs
@@ -297,10 +805,10 @@ namespace yapyjit {
 			}
 			TARGET(JoinedStr) {
 				std::unique_ptr<AST> joiner = std::make_unique<Constant>(
-					ManagedPyo(PyUnicode_FromString("")).attr("join")
+					ManagedPyo(PyUnicode_FromString("")).attr(FIELD(join))
 				);
 				std::vector<std::unique_ptr<AST>> args {};
-				for (auto val : ast_man.attr("values")) {
+				for (auto val : ast_man.attr(FIELD(values))) {
 					args.push_back(ast_py2native(val));
 				}
 				std::unique_ptr<AST> argtuple = std::make_unique<Tuple>(args);
@@ -310,73 +818,69 @@ namespace yapyjit {
 			}
 			TARGET(Constant) {
 				return std::make_unique<Constant>(
-					ast_man.attr("value")
+					ast_man.attr(FIELD(value))
 				);
 			}
 			TARGET(Num) {
-				return std::make_unique<Constant>(ast_man.attr("n"));
+				return std::make_unique<Constant>(ast_man.attr(FIELD(n)));
 			}
 			TARGET(Str) {
-				return std::make_unique<Constant>(ast_man.attr("s"));
+				return std::make_unique<Constant>(ast_man.attr(FIELD(s)));
 			}
 			TARGET(Bytes) {
-				return std::make_unique<Constant>(ast_man.attr("s"));
+				return std::make_unique<Constant>(ast_man.attr(FIELD(s)));
 			}
 			TARGET(Ellipsis) {
 				return std::make_unique<Constant>(ManagedPyo(Py_Ellipsis, true));
 			}
 			TARGET(NameConstant) {
-				return std::make_unique<Constant>(ast_man.attr("value"));
+				return std::make_unique<Constant>(ast_man.attr(FIELD(value)));
 			}
 			TARGET(Raise) {
-				auto val = ast_man.attr("exc");
+				auto val = ast_man.attr(FIELD(exc));
 				return std::make_unique<Raise>(
 					val == Py_None ? nullptr : ast_py2native(val)
 				);
 			}
 			TARGET(Try) {
 				auto nast = new Try();
-				for (auto stmt : ast_man.attr("body"))
-					nast->body.push_back(ast_py2native(stmt));
-				for (auto stmt : ast_man.attr("orelse"))
-					nast->orelse.push_back(ast_py2native(stmt));
-				for (auto stmt : ast_man.attr("finalbody"))
-					nast->finalbody.push_back(ast_py2native(stmt));
-				for (auto handler : ast_man.attr("handlers")) {
+				nast->body = block_py2native(ast_man.attr(FIELD(body)));
+				nast->orelse = block_py2native(ast_man.attr(FIELD(orelse)));
+				nast->finalbody = block_py2native(ast_man.attr(FIELD(finalbody)));
+				for (auto handler : ast_man.attr(FIELD(handlers))) {
 					nast->handlers.push_back(ExceptHandler());
-					for (auto stmt : handler.attr("body"))
-						nast->handlers.rbegin()->body.push_back(ast_py2native(stmt));
-					nast->handlers.rbegin()->name = handler.attr("name") == Py_None ? "" : handler.attr("name").to_cstr();
-					if (!(handler.attr("type") == Py_None)) {
-						nast->handlers.rbegin()->type = ast_py2native(handler.attr("type"));
+					nast->handlers.rbegin()->body = block_py2native(handler.attr(FIELD(body)));
+					nast->handlers.rbegin()->name = handler.attr(FIELD(name)) == Py_None ? "" : handler.attr(FIELD(name)).to_cstr();
+					if (!(handler.attr(FIELD(type)) == Py_None)) {
+						nast->handlers.rbegin()->type = ast_py2native(handler.attr(FIELD(type)));
 					}
 				}
 				return std::unique_ptr<Try>(nast);
 			}
 			TARGET(With) {
 				auto nast = new Try();
-				for (auto item : ast_man.attr("items")) {
+				for (auto item : ast_man.attr(FIELD(items))) {
 					auto with_name = std::string("_yapyjit_with_r_") + std::to_string((intptr_t)item.borrow());
 					nast->body.push_back(std::unique_ptr<AST>(new Assign(
-						ast_py2native(item.attr("context_expr")),
+						ast_py2native(item.attr(FIELD(context_expr))),
 						std::unique_ptr<AST>(new Name(with_name))
 					)));
 					auto enter = std::unique_ptr<AST>(new Call(
 						std::unique_ptr<AST>(new Attribute(std::unique_ptr<AST>(new Name(with_name)), "__enter__"))
 					));
-					if (item.attr("optional_vars") == Py_None) {
+					if (item.attr(FIELD(optional_vars)) == Py_None) {
 						nast->body.push_back(std::unique_ptr<AST>(new Assign(std::move(enter))));
 					}
 					else {
 						nast->body.push_back(std::unique_ptr<AST>(new Assign(
 							std::move(enter),
-							ast_py2native(item.attr("optional_vars"))
+							ast_py2native(item.attr(FIELD(optional_vars)))
 						)));
 					}
 				}
-				for (auto stmt : ast_man.attr("body"))
+				for (auto stmt : ast_man.attr(FIELD(body)))
 					nast->body.push_back(ast_py2native(stmt));
-				for (auto item : ast_man.attr("items")) {
+				for (auto item : ast_man.attr(FIELD(items))) {
 					auto with_name = std::string("_yapyjit_with_r_") + std::to_string((intptr_t)item.borrow());
 					auto exit = new Call(
 						std::unique_ptr<AST>(new Attribute(std::unique_ptr<AST>(new Name(with_name)), "__exit__"))
@@ -390,9 +894,9 @@ namespace yapyjit {
 				return std::unique_ptr<Try>(nast);
 			}
 			TARGET(Return) {
-				auto val = ast_man.attr("value");
+				auto val = ast_man.attr(FIELD(value));
 				if (val == Py_None) {
-					std::unique_ptr<AST> none_const = std::make_unique<Constant>(Py_None);
+					std::unique_ptr<AST> none_const = std::make_unique<Constant>(ManagedPyo(Py_None, true));
 					return std::make_unique<Return>(std::move(none_const));
 				}
 				else
@@ -402,17 +906,17 @@ namespace yapyjit {
 			}
 			TARGET(Assign) {
 				std::vector<std::unique_ptr<AST>> targets{};
-				for (auto target : ast_man.attr("targets")) {
+				for (auto target : ast_man.attr(FIELD(targets))) {
 					targets.push_back(ast_py2native(target));
 				}
 				return std::make_unique<Assign>(
-					ast_py2native(ast_man.attr("value")),
+					ast_py2native(ast_man.attr(FIELD(value))),
 					targets
 				);
 			}
 			TARGET(Delete) {
 				std::vector<std::unique_ptr<AST>> targets{};
-				for (auto target : ast_man.attr("targets")) {
+				for (auto target : ast_man.attr(FIELD(targets))) {
 					targets.push_back(ast_py2native(target));
 				}
 				return std::make_unique<Delete>(
@@ -420,51 +924,43 @@ namespace yapyjit {
 				);
 			}
 			TARGET(If) {
-				std::vector<std::unique_ptr<AST>> body{};
-				for (auto stmt : ast_man.attr("body")) {
-					body.push_back(ast_py2native(stmt));
+				auto test = ast_py2native(ast_man.attr(FIELD(test)));
+				auto body = block_py2native(ast_man.attr(FIELD(body)));
+				auto orelse = block_py2native(ast_man.attr(FIELD(orelse)));
+				switch (literal_truth(test)) {
+				case 1: return live_branch(body, ast_man.attr(FIELD(orelse)));
+				case 0: return live_branch(orelse, ast_man.attr(FIELD(body)));
 				}
-				std::vector<std::unique_ptr<AST>> orelse{};
-				for (auto stmt : ast_man.attr("orelse")) {
-					orelse.push_back(ast_py2native(stmt));
-				}
-				return std::make_unique<If>(
-					ast_py2native(ast_man.attr("test")),
-					body, orelse
-				);
+				return std::make_unique<If>(std::move(test), body, orelse);
 			}
 			TARGET(For) {
-				std::vector<std::unique_ptr<AST>> body{};
-				for (auto stmt : ast_man.attr("body")) {
-					body.push_back(ast_py2native(stmt));
-				}
-				std::vector<std::unique_ptr<AST>> orelse{};
-				for (auto stmt : ast_man.attr("orelse")) {
-					orelse.push_back(ast_py2native(stmt));
-				}
+				auto body = block_py2native(ast_man.attr(FIELD(body)));
+				auto orelse = block_py2native(ast_man.attr(FIELD(orelse)));
 				return std::make_unique<For>(
-					ast_py2native(ast_man.attr("target")),
-					ast_py2native(ast_man.attr("iter")),
+					ast_py2native(ast_man.attr(FIELD(target))),
+					ast_py2native(ast_man.attr(FIELD(iter))),
 					body, orelse
 				);
 			}
 			TARGET(While) {
-				std::vector<std::unique_ptr<AST>> body{};
-				for (auto stmt : ast_man.attr("body")) {
-					body.push_back(ast_py2native(stmt));
+				auto test = ast_py2native(ast_man.attr(FIELD(test)));
+				auto body = block_py2native(ast_man.attr(FIELD(body)));
+				auto orelse = block_py2native(ast_man.attr(FIELD(orelse)));
+				switch (literal_truth(test)) {
+				case 1: {
+					// Loops forever unless broken out of, which skips `orelse`. See `While::emit_ir`.
+					std::vector<std::unique_ptr<AST>> loop, never;
+					loop.push_back(std::make_unique<While>(std::move(test), body, never));
+					return live_branch(loop, ast_man.attr(FIELD(orelse)));
 				}
-				std::vector<std::unique_ptr<AST>> orelse{};
-				for (auto stmt : ast_man.attr("orelse")) {
-					orelse.push_back(ast_py2native(stmt));
+				case 0:
+					return live_branch(orelse, ast_man.attr(FIELD(body)));
 				}
-				return std::make_unique<While>(
-					ast_py2native(ast_man.attr("test")),
-					body, orelse
-				);
+				return std::make_unique<While>(std::move(test), body, orelse);
 			}
 			TARGET(Global) {
 				auto names = std::vector<std::string>();
-				for (auto name : ast_man.attr("names")) {
+				for (auto name : ast_man.attr(FIELD(names))) {
 					names.push_back(name.to_cstr());
 				}
 				return std::make_unique<Global>(names);
@@ -478,34 +974,26 @@ namespace yapyjit {
 			TARGET(Expr) {
 				auto empty_assn_targets = std::vector<std::unique_ptr<AST>>{};
 				return std::make_unique<Assign>(
-					ast_py2native(ast_man.attr("value")),
+					ast_py2native(ast_man.attr(FIELD(value))),
 					empty_assn_targets
 				);
 			}
 			TARGET(AugAssign) {
-				// FIXME: correct implementation
-				// Currently a poly-fill: a @= b -> a = a @ b
-				// But in some cases results will differ
-				// Performance may differ as well such as [list] += [short list]
 				InsnTag op = InsnTag::_from_string(
-					ast_man.attr("op").type().attr("__name__").to_cstr()
+					("Inplace" + std::string(ast_type_name(ast_man.attr(FIELD(op))))).c_str()
 				);
-				std::unique_ptr<AST> binop = std::make_unique<BinOp>(
-					ast_py2native(ast_man.attr("target")),
-					ast_py2native(ast_man.attr("value")),
+				return std::make_unique<AugAssign>(
+					ast_py2native(ast_man.attr(FIELD(target))),
+					ast_py2native(ast_man.attr(FIELD(value))),
 					op
 				);
-				return std::make_unique<Assign>(
-					std::move(binop),
-					ast_py2native(ast_man.attr("target"))
-				);
 			}
 			TARGET(AnnAssign) {
-				auto val = ast_man.attr("value");
+				auto val = ast_man.attr(FIELD(value));
 				if (val == Py_None)
 					return std::make_unique<Pass>();
 				return std::make_unique<Assign>(
-					ast_py2native(val), ast_py2native(ast_man.attr("target"))
+					ast_py2native(val), ast_py2native(ast_man.attr(FIELD(target)))
 				);
 			}
 			TARGET(Pass) {
@@ -515,9 +1003,9 @@ namespace yapyjit {
 				return std::make_unique<Pass>();
 			}
 			TARGET(Slice) {
-				auto lower = ast_man.attr("lower");
-				auto upper = ast_man.attr("upper");
-				auto step = ast_man.attr("step");
+				auto lower = ast_man.attr(FIELD(lower));
+				auto upper = ast_man.attr(FIELD(upper));
+				auto step = ast_man.attr(FIELD(step));
 				std::vector<std::unique_ptr<AST>> args {};
 				args.push_back(_helper_slice_cvt(lower));
 				args.push_back(_helper_slice_cvt(upper));
@@ -529,43 +1017,58 @@ namespace yapyjit {
 			}
 			TARGET(ExtSlice) {
 				std::vector<std::unique_ptr<AST>> elts{};
-				for (auto val : ast_man.attr("dims"))
+				for (auto val : ast_man.attr(FIELD(dims)))
 					elts.push_back(ast_py2native(val));
 				return std::make_unique<Tuple>(elts);
 			}
 			TARGET(Index) {
-				return ast_py2native(ast_man.attr("value"));
+				return ast_py2native(ast_man.attr(FIELD(value)));
 			}
 			TARGET(FunctionDef) {
 				auto result = std::make_unique<FuncDef>();
 
-				auto name = ast_man.attr("name");
+				auto name = ast_man.attr(FIELD(name));
 				result->name = name.to_cstr();
-
-				for (auto arg : ast_man.attr("args").attr("posonlyargs")) {
-					result->args.push_back(arg.attr("arg").to_cstr());
-				}
-
-				for (auto arg : ast_man.attr("args").attr("args")) {
-					result->args.push_back(arg.attr("arg").to_cstr());
+				result->lineno = (int)ast_man.attr(FIELD(lineno)).to_cLL();
+				for (auto decorator : ast_man.attr(FIELD(decorator_list))) {
+					result->lineno = std::min(result->lineno, (int)decorator.attr(FIELD(lineno)).to_cLL());
+					result->decorators.push_back(ast_py2native(decorator));
 				}
-
-				for (auto arg : ast_man.attr("args").attr("kwonlyargs")) {
-					result->args.push_back(arg.attr("arg").to_cstr());
-				}
-
-				auto stmts = ast_man.attr("body");
-				for (auto pystmt : stmts) {
-					auto stmt = ast_py2native(pystmt);
-					if (stmt)
-						result->body_stmts.push_back(std::move(stmt));
+				defaults_py2native(*result, ast_man.attr(FIELD(args)));
+				body_py2native(*result, ast_man, [&ast_man](std::vector<std::unique_ptr<AST>>& body) {
+					body = block_py2native(ast_man.attr(FIELD(body)));
+				});
+				return result;
+			}
+			TARGET(Lambda) {
+				auto result = std::make_unique<FuncDef>();
+				result->name = "<lambda>";
+				result->lambda = true;
+				result->lineno = (int)ast_man.attr(FIELD(lineno)).to_cLL();
+				PyObject* renames = PyObject_GetAttr(ast_man.borrow(), FIELD(_yapyjit_free_renames));
+				if (renames) {
+					PyObject *key, *value;
+					Py_ssize_t pos = 0;
+					while (PyDict_Next(renames, &pos, &key, &value))
+						result->free_renames[PyUnicode_AsUTF8(key)] = PyUnicode_AsUTF8(value);
+					Py_DECREF(renames);
 				}
+				else
+					PyErr_Clear();
+				defaults_py2native(*result, ast_man.attr(FIELD(args)));
+				body_py2native(*result, ast_man, [&ast_man](std::vector<std::unique_ptr<AST>>& body) {
+					body.push_back(std::make_unique<Return>(ast_py2native(ast_man.attr(FIELD(body)))));
+				});
 				return result;
 			}
+			TARGET(Nonlocal) {
+				// Cells are known from the code object, see `FuncDef::emit_ir`.
+				return std::make_unique<Pass>();
+			}
 		}
 		throw std::invalid_argument(
 			std::string(__FUNCTION__" met unsupported AST type ")
-			+ ast_man.type().attr("__name__").to_cstr()
+			+ ast_type_name(ast_man)
 		);
 	}
 }
@@ -0,0 +1,292 @@
+#include <yapyjit.h>
+#include <perf_map.h>
+#include "structmember.h"
+
+// Callable creating generators that run `body`, one per generator expression.
+// Generators keep it alive, so suspended frames survive eviction of the enclosing function.
+typedef struct {
+    PyObject_HEAD
+    yapyjit::Function* body;
+    yapyjit::Context* ctx;  // Holds a reference to `ctx->owner`.
+    vectorcallfunc callable_impl;
+} GeneratorCode;
+
+typedef struct {
+    PyObject_HEAD
+    GeneratorCode* code;
+    yapyjit::GenFrame* frame;  // nullptr once finished.
+    int running;
+} Generator;
+
+static PyObject*
+gc_fastcall(GeneratorCode* self, PyObject* const* args, size_t nargsf, PyObject* kwnames)
+{
+    auto nargs = PyVectorcall_NARGS(nargsf);
+    if (kwnames || nargs != self->body->nargs) {
+        PyErr_Format(PyExc_TypeError, "%s expects %d positional arguments", self->body->name.c_str(), self->body->nargs);
+        return nullptr;
+    }
+    auto type = self->ctx->generator_type;
+    auto gen = (Generator*)type->tp_alloc(type, 0);
+    if (!gen)
+        return nullptr;
+    Py_INCREF(self);
+    gen->code = self;
+    gen->running = 0;
+    gen->frame = new yapyjit::GenFrame();
+    auto& locals = gen->frame->locals;
+    locals.resize(self->body->locals.size() + 1);
+    for (Py_ssize_t i = 0; i < nargs; i++) {
+        Py_INCREF(args[i]);
+        locals[i + 1] = args[i];
+    }
+    for (size_t i = nargs + 1; i < locals.size(); i++) {
+        Py_INCREF(Py_None);
+        locals[i] = Py_None;
+    }
+    return (PyObject*)gen;
+}
+
+static void
+gc_dealloc(GeneratorCode* self)
+{
+    auto type = Py_TYPE(self);
+    auto owner = self->ctx->owner;
+    delete self->body;
+    type->tp_free((PyObject*)self);
+    Py_DECREF(type);
+    Py_DECREF(owner);
+}
+
+static PyObject*
+gen_iternext(Generator* self)
+{
+    auto frame = self->frame;
+    if (!frame)
+        return nullptr;
+    if (self->running) {
+        PyErr_SetString(PyExc_ValueError, "generator already executing");
+        return nullptr;
+    }
+    auto& body = *self->code->body;
+    uint8_t* p = body.bytecode().data() + frame->resume;
+    frame->resume = -1;
+    self->running = 1;
+    PyObject* result;
+    auto& ctx = *self->code->ctx;
+    if (ctx.force_trace_p)
+        result = yapyjit::guarded<yapyjit::ir_trace>()(p, frame->locals, body, frame, nullptr);
+    else if (ctx.profile_p) {
+        yapyjit::start_profile(body, ctx.profile_cycles);
+        result = yapyjit::ir_profile(p, frame->locals, body, frame, nullptr);
+    }
+    else
+        result = body.interpret(p, frame->locals, body, frame, nullptr);
+    self->running = 0;
+    if (frame->resume >= 0)
+        return result;
+
+    // Finished, `Epilog` released the registers.
+    delete frame;
+    self->frame = nullptr;
+    if (result) {
+        Py_DECREF(result);
+        return nullptr;
+    }
+    if (PyErr_ExceptionMatches(PyExc_StopIteration))
+        _PyErr_FormatFromCause(PyExc_RuntimeError, "generator raised StopIteration");
+    return nullptr;
+}
+
+// Drops the registers of a suspended frame, finishing the generator.
+static void
+gen_release_frame(Generator* self)
+{
+    auto frame = self->frame;
+    if (!frame)
+        return;
+    self->frame = nullptr;
+    for (size_t i = 1; i < frame->locals.size(); i++)
+        Py_CLEAR(frame->locals[i]);
+    delete frame;
+}
+
+static PyObject*
+gen_send(Generator* self, PyObject* value)
+{
+    // Yields of generator expressions are statements, the value sent is dropped.
+    if (self->frame && self->frame->resume == 0 && value != Py_None) {
+        PyErr_SetString(PyExc_TypeError, "can't send non-None value to a just-started generator");
+        return nullptr;
+    }
+    auto result = gen_iternext(self);
+    if (!result && !PyErr_Occurred())
+        PyErr_SetNone(PyExc_StopIteration);
+    return result;
+}
+
+static PyObject*
+gen_throw(Generator* self, PyObject* args)
+{
+    PyObject* typ;
+    PyObject* val = nullptr;
+    PyObject* tb = nullptr;
+    if (!PyArg_UnpackTuple(args, "throw", 1, 3, &typ, &val, &tb))
+        return nullptr;
+    if (self->running) {
+        PyErr_SetString(PyExc_ValueError, "generator already executing");
+        return nullptr;
+    }
+    if (tb == Py_None)
+        tb = nullptr;
+    if (tb && !PyTraceBack_Check(tb)) {
+        PyErr_SetString(PyExc_TypeError, "throw() third argument must be a traceback object");
+        return nullptr;
+    }
+    if (PyExceptionClass_Check(typ))
+        PyErr_SetObject(typ, val == Py_None ? nullptr : val);
+    else if (PyExceptionInstance_Check(typ)) {
+        if (val && val != Py_None) {
+            PyErr_SetString(PyExc_TypeError, "instance exception may not have a separate value");
+            return nullptr;
+        }
+        PyErr_SetObject((PyObject*)Py_TYPE(typ), typ);
+    }
+    else {
+        PyErr_Format(PyExc_TypeError, "exceptions must be classes or instances deriving from BaseException, not %s",
+            Py_TYPE(typ)->tp_name);
+        return nullptr;
+    }
+    if (tb) {
+        PyObject *exc_type, *exc, *exc_tb;
+        PyErr_Fetch(&exc_type, &exc, &exc_tb);
+        PyErr_NormalizeException(&exc_type, &exc, &exc_tb);
+        PyException_SetTraceback(exc, tb);
+        Py_XDECREF(exc_tb);
+        Py_INCREF(tb);
+        PyErr_Restore(exc_type, exc, tb);
+    }
+    // Generator expressions have no handlers, the exception leaves the frame at once.
+    gen_release_frame(self);
+    return nullptr;
+}
+
+static PyObject*
+gen_close(Generator* self, PyObject*)
+{
+    if (self->running) {
+        PyErr_SetString(PyExc_ValueError, "generator already executing");
+        return nullptr;
+    }
+    gen_release_frame(self);
+    Py_RETURN_NONE;
+}
+
+static int
+gen_traverse(Generator* self, visitproc visit, void* arg)
+{
+#if PY_VERSION_HEX >= 0x03090000
+    Py_VISIT(Py_TYPE(self));
+#endif
+    Py_VISIT(self->code);
+    if (self->frame) {
+        for (size_t i = 1; i < self->frame->locals.size(); i++)
+            Py_VISIT(self->frame->locals[i]);
+    }
+    return 0;
+}
+
+static int
+gen_clear(Generator* self)
+{
+    if (!self->running)
+        gen_release_frame(self);
+    Py_CLEAR(self->code);
+    return 0;
+}
+
+static void
+gen_dealloc(Generator* self)
+{
+    PyObject_GC_UnTrack(self);
+    gen_release_frame(self);
+    Py_CLEAR(self->code);
+    auto type = Py_TYPE(self);
+    type->tp_free((PyObject*)self);
+    Py_DECREF(type);
+}
+
+PyObject* yapyjit::new_generator_code(std::unique_ptr<yapyjit::Function> body) {
+    auto& ctx = yapyjit::context();
+    auto self = (GeneratorCode*)ctx.generator_code_type->tp_alloc(ctx.generator_code_type, 0);
+    if (!self)
+        throw registered_pyexc();
+    Py_INCREF(ctx.owner);
+    self->ctx = &ctx;
+    if (yapyjit::perf_map_enabled()) {
+        auto module = PyDict_GetItemString(body->globals_ns.borrow(), "__name__");
+        auto file = PyDict_GetItemString(body->globals_ns.borrow(), "__file__");
+        auto prefix = module && PyUnicode_Check(module) ? std::string(PyUnicode_AsUTF8(module)) + "." : std::string();
+        auto filename = file && PyUnicode_Check(file) ? std::string(PyUnicode_AsUTF8(file)) : std::string();
+        yapyjit::perf_map_attach(*body, prefix + body->name, filename, body->first_line);
+    }
+    self->body = body.release();
+    self->callable_impl = (vectorcallfunc)gc_fastcall;
+    return (PyObject*)self;
+}
+
+static PyMemberDef gc_members[] = {
+    {"__vectorcalloffset__", T_PYSSIZET, offsetof(GeneratorCode, callable_impl), READONLY},
+    {NULL}
+};
+
+static PyType_Slot gc_slots[] = {
+    {Py_tp_doc, (void*)"Creates generators of a generator expression."},
+    {Py_tp_dealloc, (void*)gc_dealloc},
+    {Py_tp_call, (void*)PyVectorcall_Call},
+    {Py_tp_members, gc_members},
+    {0, NULL}
+};
+
+static PyType_Spec gc_spec = {
+    "yapyjit.GeneratorCode", sizeof(GeneratorCode), 0, Py_TPFLAGS_DEFAULT | _Py_TPFLAGS_HAVE_VECTORCALL, gc_slots
+};
+
+static PyMethodDef gen_methods[] = {
+    {"send", (PyCFunction)gen_send, METH_O,
+     "send(arg) -> send 'arg' into generator,\nreturn next yielded value or raise StopIteration."},
+    {"throw", (PyCFunction)gen_throw, METH_VARARGS,
+     "throw(typ[,val[,tb]]) -> raise exception in generator,\nfinishing it."},
+    {"close", (PyCFunction)gen_close, METH_NOARGS, "close() -> finish the generator."},
+    {NULL}
+};
+
+static PyType_Slot gen_slots[] = {
+    {Py_tp_doc, (void*)"Generator running jitted code, suspended at each yielded value."},
+    {Py_tp_dealloc, (void*)gen_dealloc},
+    {Py_tp_traverse, (void*)gen_traverse},
+    {Py_tp_clear, (void*)gen_clear},
+    {Py_tp_iter, (void*)PyObject_SelfIter},
+    {Py_tp_iternext, (void*)gen_iternext},
+    {Py_tp_methods, gen_methods},
+    {0, NULL}
+};
+
+static PyType_Spec gen_spec = {
+    "yapyjit.Generator", sizeof(Generator), 0, Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC, gen_slots
+};
+
+int init_generator(PyObject* m, yapyjit::Context& ctx) {
+    if (!ctx.generator_code_type)
+        ctx.generator_code_type = (PyTypeObject*)PyType_FromSpec(&gc_spec);
+    if (!ctx.generator_type)
+        ctx.generator_type = (PyTypeObject*)PyType_FromSpec(&gen_spec);
+    if (!ctx.generator_code_type || !ctx.generator_type)
+        return -1;
+    Py_INCREF(ctx.generator_type);
+    if (PyModule_AddObject(m, "Generator", (PyObject*)ctx.generator_type) < 0) {
+        Py_DECREF(ctx.generator_type);
+        return -1;
+    }
+    return 0;
+}
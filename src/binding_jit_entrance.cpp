@@ -1,35 +1,185 @@
+#include <algorithm>
+#include <set>
 #include <yapyjit.h>
+#include <perf_map.h>
 #include "structmember.h"
 
-typedef struct {
+// Parameter of each keyword in one `kwnames` tuple, see `wf_kw_shape`.
+struct KwShape {
+    PyObject* kwnames = nullptr;  // Owned, so that no other tuple takes its address.
+    std::vector<int> slots;  // Index into the parameters, -1 for `**kwargs`.
+    Py_ssize_t nextra = 0;  // Keywords with no parameter.
+};
+
+// Keyword binding of the functions of one code object. The shapes of recent
+// `kwnames` tuples, usually constants of the calling code, are found by address.
+struct KwBinding {
+    static constexpr int cache_size = 4;
+    PyObject* names = nullptr;  // Parameters in order, interned by the code object.
+    KwShape shapes[cache_size];
+    int next = 0;  // Shape replaced on the next miss.
+
+    ~KwBinding() {
+        Py_XDECREF(names);
+        for (auto& shape : shapes)
+            Py_XDECREF(shape.kwnames);
+    }
+};
+
+struct JitEntrance {
     PyObject_HEAD
+    yapyjit::Context* ctx;  // Holds a reference to `ctx->owner`.
     PyObject* wrapped;
-    std::unique_ptr<yapyjit::Function> compiled;
-    std::map<std::string, int>* argid_lookup;
+    std::shared_ptr<yapyjit::Function> compiled;  // Shared by the functions of one nested `def` or `lambda`.
+    std::shared_ptr<std::map<std::string, int>> argid_lookup;  // Used when compiling, calls use `kw_binding`.
+    std::shared_ptr<KwBinding> kw_binding;
+    std::vector<PyObject*> spare_locals;  // Storage of the registers, reused by calls that do not recurse.
     std::vector<PyObject*>* defaults;
+    int argcount;  // Positional parameters, those after them in `defaults` are keyword-only.
     // std::vector<PyObject*>* call_args_fill;
     vectorcallfunc callable_impl;
     PyObject* extra_attrdict;
     int call_count;
     int tier;
-} JitEntrance;
-
-PyTypeObject JitEntranceType = {
-    PyVarObject_HEAD_INIT(NULL, 0)
+    int active;  // Number of running activations.
+    int inlined;  // Number of call sites inlined, -1 if not yet tried.
+    uint64_t last_call;  // Value of `call_clock` at the latest call.
+    yapyjit::RuntimeStats stats;  // Kept across evictions, see `yapyjit.stats()`.
+    size_t code_size;  // Accounted in `code_usage`.
+    uint8_t frontend;  // `yapyjit::Frontend` at creation, also used to compile again after eviction.
+    uint8_t nested;  // Made by `MakeFunction`, the code cannot be compiled again so it is never evicted or inlined into.
 };
 
+size_t jit_code_usage(yapyjit::Context& ctx) {
+    return ctx.code_usage;
+}
+
+// Updates the accounting after the compiled code of `self` is created, changed or released.
+static void
+wf_account(JitEntrance* self)
+{
+    auto& ctx = *self->ctx;
+    size_t size = self->compiled && !self->nested ? self->compiled->code_size() : 0;
+    ctx.code_usage = ctx.code_usage - self->code_size + size;
+    self->code_size = size;
+    if (size)
+        ctx.compiled_entrances.insert(self);
+    else
+        ctx.compiled_entrances.erase(self);
+}
+
+// Drops compiled code, the function is compiled again on the next call.
+static void
+wf_evict(JitEntrance* self)
+{
+    self->compiled.reset();
+    self->tier = 0;
+    self->stats.tier_changes++;
+    self->inlined = -1;
+    self->call_count = 0;
+    wf_account(self);
+}
+
+// Evicts least recently called functions until code usage fits into the budget.
+static void
+wf_enforce_budget(yapyjit::Context& ctx, JitEntrance* keep)
+{
+    while (ctx.code_budget > 0 && ctx.code_usage > ctx.code_budget) {
+        JitEntrance* victim = nullptr;
+        for (auto entrance : ctx.compiled_entrances) {
+            if (entrance == keep || entrance->active)
+                continue;
+            if (!victim || entrance->last_call < victim->last_call)
+                victim = entrance;
+        }
+        if (!victim)
+            break;
+        wf_evict(victim);
+    }
+}
+
+void enforce_code_budget(yapyjit::Context& ctx) {
+    wf_enforce_budget(ctx, nullptr);
+}
+
+// Runs the compiled code through a stub named after the wrapped function if perf maps are enabled.
+static void
+wf_perf_map(JitEntrance* self)
+{
+    if (!yapyjit::perf_map_enabled())
+        return;
+    auto wrapped = yapyjit::ManagedPyo(self->wrapped, true);
+    auto module = wrapped.attr("__module__").str();
+    auto qualname = wrapped.attr("__qualname__").str();
+    auto code = wrapped.attr("__code__");
+    yapyjit::perf_map_attach(
+        *self->compiled, std::string(module.to_cstr()) + "." + qualname.to_cstr(),
+        code.attr("co_filename").to_cstr(), (int)code.attr("co_firstlineno").to_cLL()
+    );
+}
+
+// Compiles without enforcing the budget, so no other code is released.
+static int
+wf_compile_only(JitEntrance* self)
+{
+    self->compiled = yapyjit::get_ir(
+        yapyjit::ManagedPyo(self->wrapped, true), yapyjit::Frontend::_from_integral(self->frontend)
+    );
+    self->tier = 1;
+    self->stats.tier_changes++;
+    wf_perf_map(self);
+    wf_account(self);
+    return 0;
+}
+
+static int
+wf_compile(JitEntrance* self)
+{
+    wf_compile_only(self);
+    wf_enforce_budget(*self->ctx, self);
+    return 0;
+}
+
 static PyObject*
 wf_fastcall(JitEntrance* self, PyObject* const* args, size_t nargsf, PyObject* kwnames);
 
 static void
 wf_dealloc(JitEntrance* self)
 {
-    self->compiled.reset(nullptr);
-    delete self->argid_lookup;
+    PyObject_GC_UnTrack(self);
+    self->compiled.reset();
+    wf_account(self);
+    self->ctx->called_entrances.erase(self);
+    self->compiled.~shared_ptr();
+    self->argid_lookup.~shared_ptr();
+    self->kw_binding.~shared_ptr();
+    self->spare_locals.~vector();
     delete self->defaults;
     // delete self->call_args_fill;
     Py_CLEAR(self->wrapped);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    Py_CLEAR(self->extra_attrdict);
+    auto type = Py_TYPE(self);
+    auto owner = self->ctx->owner;
+    type->tp_free((PyObject*)self);
+    Py_DECREF(type);
+    Py_DECREF(owner);
+}
+
+// Closures of nested functions may refer to the function itself.
+static int
+wf_traverse(JitEntrance* self, visitproc visit, void* arg)
+{
+    Py_VISIT(Py_TYPE(self));
+    Py_VISIT(self->wrapped);
+    Py_VISIT(self->extra_attrdict);
+    return 0;
+}
+
+static int
+wf_clear(JitEntrance* self)
+{
+    Py_CLEAR(self->extra_attrdict);
+    return 0;
 }
 
 static PyObject*
@@ -38,19 +188,65 @@ wf_new(PyTypeObject* type, PyObject* args, PyObject* kwds)
     JitEntrance* self;
     self = (JitEntrance*)type->tp_alloc(type, 0);
     if (self != NULL) {
+        self->ctx = &yapyjit::context();
+        Py_INCREF(self->ctx->owner);
         Py_INCREF(Py_None);
         self->wrapped = Py_None;
-        self->compiled = nullptr;
-        self->argid_lookup = new std::map<std::string, int>();
+        new (&self->compiled) std::shared_ptr<yapyjit::Function>();
+        new (&self->argid_lookup) std::shared_ptr<std::map<std::string, int>>(new std::map<std::string, int>());
+        new (&self->kw_binding) std::shared_ptr<KwBinding>(new KwBinding());
+        new (&self->spare_locals) std::vector<PyObject*>();
         self->defaults = new std::vector<PyObject*>();
         // self->call_args_fill = new std::vector<PyObject*>();
         self->callable_impl = (vectorcallfunc)wf_fastcall;
         self->call_count = 0;
         self->tier = 0;
+        self->active = 0;
+        self->inlined = -1;
+        self->last_call = 0;
+        self->stats = yapyjit::RuntimeStats();
+        self->code_size = 0;
+        self->frontend = self->ctx->frontend;
+        self->nested = 0;
     }
     return (PyObject*)self;
 }
 
+// Named parameters of the wrapped function of `self` from its code. `*args` and `**kwargs` are bound in `wf_fastcall`.
+static void
+wf_bind_code(JitEntrance* self)
+{
+    auto code = yapyjit::ManagedPyo(self->wrapped, true).attr("__code__");
+    auto varnames = code.attr("co_varnames");
+    self->argcount = (int)code.attr("co_argcount").to_cLL();
+    auto nparams = self->argcount + code.attr("co_kwonlyargcount").to_cLL();
+    for (int i = 0; i < nparams; i++)
+        (*self->argid_lookup)[PyUnicode_AsUTF8(PyTuple_GET_ITEM(varnames.borrow(), i))] = i;
+    self->defaults->assign(nparams, nullptr);
+    Py_XSETREF(self->kw_binding->names, PyTuple_GetSlice(varnames.borrow(), 0, nparams));
+    if (!self->kw_binding->names)
+        throw yapyjit::registered_pyexc();
+}
+
+// Defaults of the parameters bound by `wf_bind_code`, borrowed from the wrapped function.
+static void
+wf_bind_defaults(JitEntrance* self)
+{
+    auto wrapped = yapyjit::ManagedPyo(self->wrapped, true);
+    auto positional = wrapped.attr("__defaults__");
+    if (PyTuple_Check(positional.borrow())) {
+        auto start = self->argcount - PyTuple_GET_SIZE(positional.borrow());
+        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(positional.borrow()); i++)
+            (*self->defaults)[start + i] = PyTuple_GET_ITEM(positional.borrow(), i);
+    }
+    auto kwonly = wrapped.attr("__kwdefaults__");
+    PyObject* key, * value;
+    Py_ssize_t pos = 0;
+    if (PyDict_Check(kwonly.borrow()))
+        while (PyDict_Next(kwonly.borrow(), &pos, &key, &value))
+            (*self->defaults)[self->argid_lookup->at(PyUnicode_AsUTF8(key))] = value;
+}
+
 static int
 wf_init(JitEntrance* self, PyObject* args)
 {
@@ -64,47 +260,12 @@ wf_init(JitEntrance* self, PyObject* args)
         Py_CLEAR(self->wrapped);
         self->wrapped = pyfunc;
 
-        auto inspect_mod = yapyjit::ManagedPyo(PyImport_ImportModule("inspect"));
-
-        /*auto closure = inspect_mod.attr("getclosurevars").call(pyfunc);
-        if (PyObject_IsTrue(closure.attr("nonlocals").borrow())) {
-            throw std::invalid_argument(std::string("closure vars are not supported yet."));
-        }*/
-
-        auto spec = inspect_mod.attr("getfullargspec").call(pyfunc);
-        if (spec.attr("varargs") == Py_None && spec.attr("varkw") == Py_None) {
-            for (auto arg : spec.attr("args")) {
-                (*self->argid_lookup)[arg.to_cstr()] = self->defaults->size();
-                self->defaults->push_back(nullptr);
-            }
-            if (!(spec.attr("defaults") == Py_None)) {
-                int start = spec.attr("args").length() - spec.attr("defaults").length();
-                for (auto val : spec.attr("defaults")) {
-                    (*self->defaults)[start++] = val.borrow();
-                }
-            }
-            for (auto arg : spec.attr("kwonlyargs")) {
-                (*self->argid_lookup)[arg.to_cstr()] = self->defaults->size();
-                self->defaults->push_back(nullptr);
-            }
-            PyObject* key, * value;
-            Py_ssize_t pos = 0;
-            auto kwonlydef = spec.attr("kwonlydefaults");
-            if (PyDict_CheckExact(kwonlydef.borrow()))
-                while (PyDict_Next(kwonlydef.borrow(), &pos, &key, &value)) {
-                    assert(PyUnicode_CheckExact(key));
-                    auto name = PyUnicode_AsUTF8(key);
-                    (*self->defaults)[self->argid_lookup->at(name)] = value;
-                }
-        }
-        else {
-            throw std::invalid_argument(std::string("varargs and varkw funcs are not supported yet."));
-        }
-        self->compiled = yapyjit::get_ir(yapyjit::get_py_ast(pyfunc), yapyjit::ManagedPyo(pyfunc, true));
+        wf_bind_code(self);
+        wf_bind_defaults(self);
+        wf_compile(self);
         // self->call_args_fill->resize(self->compiled->locals.size() + 1, nullptr);
         /*if (pyclass && pyclass != Py_None)
             self->compiled->py_cls = yapyjit::ManagedPyo(pyclass, true);*/
-        self->tier = 1;
     }
     return 0;
 }
@@ -112,6 +273,131 @@ wf_init(JitEntrance* self, PyObject* args)
 static PyMemberDef wf_members[] = {
     {"wrapped", T_OBJECT_EX, offsetof(JitEntrance, wrapped), 0, "wrapped python function"},
     {"tier", T_INT, offsetof(JitEntrance, tier), READONLY, "JIT tier (0: not ready, 1: ready, 2: hot trace head)"},
+    {"inlined", T_INT, offsetof(JitEntrance, inlined), READONLY, "number of call sites inlined into the function, -1 if the inliner has not run yet"},
+    {"calls", T_ULONGLONG, offsetof(JitEntrance, stats.calls), READONLY, "number of calls"},
+    {"instructions", T_ULONGLONG, offsetof(JitEntrance, stats.instructions), READONLY, "number of instructions executed by the interpreter"},
+    {"ticks", T_ULONGLONG, offsetof(JitEntrance, stats.ticks), READONLY, "time stamp counter ticks spent running the function, callees included"},
+    {"exceptions", T_ULONGLONG, offsetof(JitEntrance, stats.exceptions), READONLY, "number of calls left by an exception"},
+    {"tier_changes", T_ULONGLONG, offsetof(JitEntrance, stats.tier_changes), READONLY, "number of times the function was compiled or evicted"},
+    {"__dictoffset__", T_PYSSIZET, offsetof(JitEntrance, extra_attrdict), READONLY},
+    {"__vectorcalloffset__", T_PYSSIZET, offsetof(JitEntrance, callable_impl), READONLY},
+    {NULL}
+};
+
+static PyObject*
+wf_icache_stats(JitEntrance* self, PyObject* args)
+{
+    auto result = yapyjit::ManagedPyo(PyList_New(0));
+    if (!self->compiled)
+        return result.transfer();
+    for (const auto& site : self->compiled->icache_sites) {
+        auto cache = site.second;
+        auto stat = yapyjit::ManagedPyo(Py_BuildValue(
+            "{s:i,s:s,s:K,s:K,s:i}",
+            "offset", (int)site.first,
+            "state", yapyjit::icache_state_name(cache->state),
+            "hits", (unsigned long long)cache->hits,
+            "misses", (unsigned long long)cache->misses,
+            "entries", (int)cache->size
+        ));
+        if (PyList_Append(result.borrow(), stat.borrow()) < 0)
+            return nullptr;
+    }
+    return result.transfer();
+}
+
+static PyObject*
+wf_insn_profile(JitEntrance* self, PyObject* args)
+{
+    auto result = yapyjit::ManagedPyo(PyList_New(0));
+    if (!self->compiled || !self->compiled->profile)
+        return result.transfer();
+    const auto& profile = *self->compiled->profile;
+    const auto& bytecode = self->compiled->bytecode();
+    for (size_t offset = 0; offset < profile.counts.size(); offset++) {
+        // Only offsets where an instruction starts are ever counted.
+        if (!profile.counts[offset])
+            continue;
+        auto stat = yapyjit::ManagedPyo(Py_BuildValue(
+            "{s:n,s:s,s:K,s:K}",
+            "offset", (Py_ssize_t)offset,
+            "insn", yapyjit::InsnTag::_from_integral(bytecode[offset])._to_string(),
+            "count", (unsigned long long)profile.counts[offset],
+            "cycles", (unsigned long long)(profile.cycles.empty() ? 0 : profile.cycles[offset])
+        ));
+        if (PyList_Append(result.borrow(), stat.borrow()) < 0)
+            return nullptr;
+    }
+    return result.transfer();
+}
+
+static PyObject*
+wf_get_refcount_elided(JitEntrance* self, void* closure)
+{
+    return PyLong_FromLong(self->compiled ? self->compiled->refcount_elided : 0);
+}
+
+static PyObject*
+wf_get_code_size(JitEntrance* self, void* closure)
+{
+    return PyLong_FromSize_t(self->code_size);
+}
+
+static uint64_t
+wf_icache_misses(JitEntrance* self)
+{
+    uint64_t misses = 0;
+    if (self->compiled)
+        for (const auto& site : self->compiled->icache_sites)
+            misses += site.second->misses;
+    return misses;
+}
+
+static PyObject*
+wf_get_icache_misses(JitEntrance* self, void* closure)
+{
+    return PyLong_FromUnsignedLongLong(wf_icache_misses(self));
+}
+
+PyObject* jit_stats(yapyjit::Context& ctx) {
+    std::vector<JitEntrance*> entrances(ctx.called_entrances.begin(), ctx.called_entrances.end());
+    std::sort(entrances.begin(), entrances.end(), [](JitEntrance* a, JitEntrance* b) {
+        return a->stats.ticks > b->stats.ticks;
+    });
+    auto result = yapyjit::ManagedPyo(PyList_New(0));
+    for (auto entrance : entrances) {
+        const auto& stats = entrance->stats;
+        auto name = yapyjit::ManagedPyo(entrance->wrapped, true).attr("__qualname__");
+        auto stat = yapyjit::ManagedPyo(Py_BuildValue(
+            "{s:O,s:O,s:K,s:K,s:K,s:K,s:K,s:K}",
+            "function", (PyObject*)entrance,
+            "name", name.borrow(),
+            "calls", (unsigned long long)stats.calls,
+            "instructions", (unsigned long long)stats.instructions,
+            "ticks", (unsigned long long)stats.ticks,
+            "exceptions", (unsigned long long)stats.exceptions,
+            "tier_changes", (unsigned long long)stats.tier_changes,
+            "icache_misses", (unsigned long long)wf_icache_misses(entrance)
+        ));
+        if (PyList_Append(result.borrow(), stat.borrow()) < 0)
+            return nullptr;
+    }
+    return result.transfer();
+}
+
+static PyGetSetDef wf_getset[] = {
+    {"refcount_elided", (getter)wf_get_refcount_elided, NULL, "number of refcount operations removed from the compiled code", NULL},
+    {"code_size", (getter)wf_get_code_size, NULL, "bytes of memory held by the compiled code, 0 if not compiled", NULL},
+    {"icache_misses", (getter)wf_get_icache_misses, NULL, "number of inline cache misses in the compiled code", NULL},
+    {NULL}
+};
+
+static PyMethodDef wf_methods[] = {
+    {"icache_stats", (PyCFunction)yapyjit::guarded<wf_icache_stats>(), METH_NOARGS,
+     "Statistics of inline caches as a list of dicts with offset, state, hits, misses and entries."},
+    {"insn_profile", (PyCFunction)yapyjit::guarded<wf_insn_profile>(), METH_NOARGS,
+     "Counters of yapyjit.set_profile for the instructions executed, as a list of dicts with offset,\n"
+     "insn, count and cycles, by offset. Empty if the compiled code has not run with profiling."},
     {NULL}
 };
 
@@ -124,19 +410,200 @@ wf_descr_get(PyObject* self, PyObject* obj, PyObject* type) {
     else return PyMethod_New(self, obj);
 }
 
+// Entrances of all interpreters, each has its own type.
+static bool
+is_jit_entrance(PyObject* obj)
+{
+    return Py_TYPE(obj)->tp_dealloc == (destructor)wf_dealloc;
+}
+
+// Compiled code of `obj`, empty if it is not a jitted function or not compiled.
+std::shared_ptr<yapyjit::Function>
+jit_compiled(PyObject* obj)
+{
+    if (!is_jit_entrance(obj))
+        return nullptr;
+    return ((JitEntrance*)obj)->compiled;
+}
+
+static bool
+resolve_inline_callee(PyObject* obj, yapyjit::InlineCallee& callee)
+{
+    if (!is_jit_entrance(obj))
+        return false;
+    auto entrance = (JitEntrance*)obj;
+    // Evicted callees are compiled again, the budget is enforced after inlining.
+    if (!entrance->compiled && yapyjit::guarded<wf_compile_only>()(entrance) < 0) {
+        PyErr_Clear();
+        return false;
+    }
+    callee.func = entrance->compiled.get();
+    callee.argid_lookup = entrance->argid_lookup.get();
+    callee.defaults = entrance->defaults;
+    return true;
+}
+
+// Tuple of `n` items from `items`.
 static PyObject*
-wf_fastcall(JitEntrance* self, PyObject* const* args, size_t nargsf, PyObject* kwnames) {
+tuple_of(PyObject* const* items, Py_ssize_t n)
+{
+    auto result = PyTuple_New(n);
+    if (!result)
+        return nullptr;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_INCREF(items[i]);
+        PyTuple_SET_ITEM(result, i, items[i]);
+    }
+    return result;
+}
+
+// Shape of `kwnames`, a tuple of strings, for the parameters of `self`. Found by address if it was
+// seen recently, otherwise matched by identity against the interned parameter names, then by value.
+static const KwShape&
+wf_kw_shape(JitEntrance* self, PyObject* kwnames)
+{
+    auto& binding = *self->kw_binding;
+    for (const auto& shape : binding.shapes)
+        if (shape.kwnames == kwnames)
+            return shape;
+    auto& shape = binding.shapes[binding.next];
+    binding.next = (binding.next + 1) % KwBinding::cache_size;
+    const Py_ssize_t nkw = PyTuple_GET_SIZE(kwnames), nparams = PyTuple_GET_SIZE(binding.names);
+    shape.slots.assign(nkw, -1);
+    shape.nextra = 0;
+    for (Py_ssize_t i = 0; i < nkw; i++) {
+        auto name = PyTuple_GET_ITEM(kwnames, i);
+        auto& slot = shape.slots[i];
+        for (Py_ssize_t j = 0; j < nparams && slot < 0; j++)
+            if (PyTuple_GET_ITEM(binding.names, j) == name)
+                slot = (int)j;
+        for (Py_ssize_t j = 0; j < nparams && slot < 0; j++)
+            if (PyUnicode_Compare(PyTuple_GET_ITEM(binding.names, j), name) == 0)
+                slot = (int)j;
+        shape.nextra += slot < 0;
+    }
+    Py_INCREF(kwnames);
+    Py_XSETREF(shape.kwnames, kwnames);
+    return shape;
+}
+
+// Raises `TypeError` for arguments not matching the parameters, as CPython does. `npos` of the
+// `posargs` positional arguments are bound to parameters, `shape` describes the keywords if any.
+static bool
+wf_check_args(JitEntrance* self, Py_ssize_t npos, Py_ssize_t posargs, PyObject* kwnames, const KwShape* shape)
+{
+    const auto& func = *self->compiled;
+    if (posargs > npos && !func.varargs) {
+        PyErr_Format(PyExc_TypeError, "%s() takes %d positional arguments but %zd were given",
+                     func.name.c_str(), self->argcount, posargs);
+        return false;
+    }
+    const int* slots = shape ? shape->slots.data() : nullptr;
+    const Py_ssize_t nkw = shape ? (Py_ssize_t)shape->slots.size() : 0;
+    for (Py_ssize_t i = 0; i < nkw; i++) {
+        if (slots[i] < 0 && !func.varkw) {
+            PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'",
+                         func.name.c_str(), PyTuple_GET_ITEM(kwnames, i));
+            return false;
+        }
+        if (slots[i] >= 0 && slots[i] < npos) {
+            PyErr_Format(PyExc_TypeError, "%s() got multiple values for argument '%U'",
+                         func.name.c_str(), PyTuple_GET_ITEM(kwnames, i));
+            return false;
+        }
+    }
+    const auto& defaults = *self->defaults;
+    for (Py_ssize_t i = npos; i < (Py_ssize_t)defaults.size(); i++) {
+        if (!defaults[i] && std::find(slots, slots + nkw, (int)i) == slots + nkw) {
+            PyErr_Format(PyExc_TypeError, "%s() missing required argument '%U'",
+                         func.name.c_str(), PyTuple_GET_ITEM(self->kw_binding->names, i));
+            return false;
+        }
+    }
+    return true;
+}
+
+// Values of `*args` and `**kwargs` from the arguments not bound to named parameters, nullptr if absent.
+// Positional arguments from `npos` on are extra. See `Function::forwards` for the other layout.
+static bool
+wf_bind_extra(JitEntrance* self, PyObject* const* args, Py_ssize_t npos, Py_ssize_t posargs, PyObject* kwnames,
+              const KwShape* shape, PyObject** extra_args, PyObject** extra_kwargs)
+{
+    const auto& func = *self->compiled;
+    const Py_ssize_t nkw = shape ? (Py_ssize_t)shape->slots.size() : 0, nextra = shape ? shape->nextra : 0;
+    if (func.forwards && nextra == nkw) {
+        // The common case, the arguments are passed on as they came in.
+        *extra_args = tuple_of(args + npos, posargs - npos + nkw);
+        *extra_kwargs = nkw ? kwnames : Py_None;
+        Py_INCREF(*extra_kwargs);
+        return *extra_args;
+    }
+    if (func.forwards) {
+        *extra_args = PyTuple_New(posargs - npos + nextra);
+        *extra_kwargs = PyTuple_New(nextra);
+        if (!*extra_args || !*extra_kwargs)
+            return false;
+        for (Py_ssize_t i = npos; i < posargs; i++) {
+            Py_INCREF(args[i]);
+            PyTuple_SET_ITEM(*extra_args, i - npos, args[i]);
+        }
+        for (Py_ssize_t i = 0, j = 0; i < nkw; i++) {
+            if (shape->slots[i] >= 0)
+                continue;
+            auto name = PyTuple_GET_ITEM(kwnames, i);
+            Py_INCREF(name);
+            PyTuple_SET_ITEM(*extra_kwargs, j, name);
+            Py_INCREF(args[posargs + i]);
+            PyTuple_SET_ITEM(*extra_args, posargs - npos + j, args[posargs + i]);
+            j++;
+        }
+        return true;
+    }
+    if (func.varargs && !(*extra_args = tuple_of(args + npos, posargs - npos)))
+        return false;
+    if (func.varkw) {
+        if (!(*extra_kwargs = PyDict_New()))
+            return false;
+        for (Py_ssize_t i = 0; i < nkw; i++) {
+            if (shape->slots[i] < 0 && PyDict_SetItem(*extra_kwargs, PyTuple_GET_ITEM(kwnames, i), args[posargs + i]) < 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Checks the arguments of a call of `self` and binds them to the registers in `locals`.
+static bool
+wf_bind(JitEntrance* self, PyObject* const* args, size_t nargsf, PyObject* kwnames, std::vector<PyObject*>& locals)
+{
     Py_ssize_t nargs = (Py_ssize_t)self->defaults->size();
     auto posargs = PyVectorcall_NARGS(nargsf);
-    auto locals = std::vector<PyObject*>(self->compiled->locals.size() + 1);
+    // Positional arguments beyond the parameters go to `*args`.
+    const auto npos = std::min<Py_ssize_t>(posargs, self->argcount);
+    const auto& func = *self->compiled;
+    // The shape is used up before any code runs, which may replace it.
+    const KwShape* shape = kwnames && PyTuple_GET_SIZE(kwnames) ? &wf_kw_shape(self, kwnames) : nullptr;
+    if (!wf_check_args(self, npos, posargs, kwnames, shape))
+        return false;
+    PyObject* extra_args = nullptr, * extra_kwargs = nullptr;
+    if ((func.varargs || func.varkw) && !wf_bind_extra(self, args, npos, posargs, kwnames, shape, &extra_args, &extra_kwargs)) {
+        Py_XDECREF(extra_args);
+        Py_XDECREF(extra_kwargs);
+        return false;
+    }
+    locals.assign(self->compiled->locals.size() + 1, nullptr);
 
-    for (Py_ssize_t i = 0; i < posargs; i++) {
+    // Borrowed arguments are never written, so the references of the caller suffice.
+    Py_ssize_t nborrowed = self->compiled->nborrowed;
+    for (Py_ssize_t i = 0; i < npos; i++) {
         locals[i + 1] = args[i];
-        Py_INCREF(locals[i + 1]);
+        if (i >= nborrowed)
+            Py_INCREF(locals[i + 1]);
     }
-    for (Py_ssize_t i = posargs; i < nargs; i++) {
+    for (Py_ssize_t i = npos; i < nargs; i++) {
         locals[i + 1] = self->defaults->at(i);
-        Py_XINCREF(locals[i + 1]);
+        if (i >= nborrowed)
+            Py_XINCREF(locals[i + 1]);
     }
     // Issue #1, rely on compiler optimization and avoid using opaque structures.
     // Py_None->ob_refcnt += self->compiled->locals.size() - nargs;
@@ -144,45 +611,236 @@ wf_fastcall(JitEntrance* self, PyObject* const* args, size_t nargsf, PyObject* k
         Py_INCREF(Py_None);
     for (Py_ssize_t i = nargs; i < self->compiled->locals.size(); i++)
         locals[i + 1] = Py_None;
+    Py_ssize_t extra_reg = nargs + 1;
+    if (func.varargs) {
+        Py_DECREF(locals[extra_reg]);
+        locals[extra_reg++] = extra_args;
+    }
+    if (func.varkw) {
+        Py_DECREF(locals[extra_reg]);
+        locals[extra_reg] = extra_kwargs;
+    }
+    const auto& free_cells = self->compiled->free_cells;
+    for (size_t i = 0; i < free_cells.size(); i++) {
+        auto cell = PyTuple_GET_ITEM(PyFunction_GET_CLOSURE(self->wrapped), i);
+        Py_INCREF(cell);
+        Py_DECREF(locals[free_cells[i]]);
+        locals[free_cells[i]] = cell;
+    }
 
-    if (kwnames) {
-        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(kwnames); i++) {
-            auto name = PyUnicode_AsUTF8(PyTuple_GET_ITEM(kwnames, i));
-            auto& slot = locals[self->argid_lookup->at(name) + 1];
-            Py_XDECREF(slot);
+    if (shape) {
+        for (Py_ssize_t i = 0; i < (Py_ssize_t)shape->slots.size(); i++) {
+            auto argid = shape->slots[i];
+            if (argid < 0)
+                continue;  // In `**kwargs`.
+            auto& slot = locals[argid + 1];
+            if (argid >= nborrowed)
+                Py_XDECREF(slot);
             slot = args[posargs + i];
-            Py_INCREF(slot);
+            if (argid >= nborrowed)
+                Py_INCREF(slot);
         }
     }
-    if (!yapyjit::force_trace_p)
-        return yapyjit::ir_interpret(self->compiled->bytecode().data(), locals, *self->compiled);
-    else
-        return yapyjit::guarded<yapyjit::ir_trace>()(self->compiled->bytecode().data(), locals, *self->compiled);
+    return true;
+}
+
+static void
+wf_count_call(JitEntrance* self)
+{
+    self->last_call = ++self->ctx->call_clock;
+    if (self->call_count < INT_MAX)
+        self->call_count++;
+    if (!self->stats.calls++)
+        self->ctx->called_entrances.insert(self);
+}
+
+static PyObject*
+wf_fastcall(JitEntrance* self, PyObject* const* args, size_t nargsf, PyObject* kwnames) {
+    wf_count_call(self);
+    if (!self->compiled && yapyjit::guarded<wf_compile>()(self) < 0)
+        return nullptr;
+    // Bytecode is rewritten in place, so only inline when no activation is running.
+    const auto& ctx = *self->ctx;
+    if (self->inlined < 0 && ctx.inline_threshold > 0
+        && self->call_count >= ctx.inline_threshold && !self->active) {
+        self->inlined = yapyjit::guarded<yapyjit::inline_calls>()(*self->compiled, resolve_inline_callee, yapyjit::InlineBudget());
+        if (self->inlined < 0) {
+            // The bytecode is only replaced when inlining succeeds, so the call goes on without it.
+            PyErr_Clear();
+            self->inlined = 0;
+        }
+        wf_account(self);
+        wf_enforce_budget(*self->ctx, self);
+    }
+    // Every activation runs on the native stack, deep recursion fails with `RecursionError` instead.
+    if (Py_EnterRecursiveCall(" while calling a jitted function"))
+        return nullptr;
+    // A recursive call cannot take the registers of the running one.
+    std::vector<PyObject*> own_locals;
+    auto& locals = self->active ? own_locals : self->spare_locals;
+    PyObject* result = nullptr;
+    if (wf_bind(self, args, nargsf, kwnames, locals)) {
+        // Recursive activations are inside the outermost one, so only that is timed.
+        const uint64_t start = self->active ? 0 : yapyjit::read_tsc();
+        self->active++;
+        auto& func = *self->compiled;
+        if (ctx.force_trace_p)
+            result = yapyjit::guarded<yapyjit::ir_trace>()(func.bytecode().data(), locals, func, nullptr, &self->stats);
+        else if (ctx.profile_p) {
+            yapyjit::start_profile(func, ctx.profile_cycles);
+            result = yapyjit::ir_profile(func.bytecode().data(), locals, func, nullptr, &self->stats);
+        }
+        else
+            result = func.interpret(func.bytecode().data(), locals, func, nullptr, &self->stats);
+        if (!--self->active)
+            self->stats.ticks += yapyjit::read_tsc() - start;
+    }
+    Py_LeaveRecursiveCall();
+    return result;
 }
 
+PyObject* yapyjit::call_function(PyObject* callee, PyObject* const* args, size_t nargsf, PyObject* kwnames) {
+    if (is_jit_entrance(callee))
+        return wf_fastcall((JitEntrance*)callee, args, nargsf, kwnames);
+    return _PyObject_Vectorcall(callee, args, nargsf, kwnames);
+}
 
-int init_jit_entrance(PyObject* m) {
-    JitEntranceType.tp_name = "yapyjit.JitEntrance";
-    JitEntranceType.tp_doc = "Entry point to yapyjit runtime.";
-    JitEntranceType.tp_basicsize = sizeof(JitEntrance);
-    JitEntranceType.tp_itemsize = 0;
-    JitEntranceType.tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_METHOD_DESCRIPTOR | _Py_TPFLAGS_HAVE_VECTORCALL;
+int yapyjit::SelfCallStack::enter(PyObject* callee, const uint8_t* code, PyObject* const* args, size_t nargsf,
+                                  PyObject* kwnames, std::vector<PyObject*>& locals, uint8_t* resume, local_t dst) {
+    auto self = (JitEntrance*)callee;
+    if (!is_jit_entrance(callee) || !self->compiled || self->compiled->bytecode().data() != code)
+        return 0;
+    if (depth == calls.size())
+        calls.emplace_back();
+    auto& call = calls[depth];
+    // Compiled and running already, so there is nothing to compile or inline.
+    wf_count_call(self);
+    if (Py_EnterRecursiveCall(" while calling a jitted function"))
+        return -1;
+    if (!wf_bind(self, args, nargsf, kwnames, call.locals)) {
+        Py_LeaveRecursiveCall();
+        return -1;
+    }
+    self->active++;
+    call.resume = resume;
+    call.dst = dst;
+    call.callee = callee;
+    std::swap(locals, call.locals);
+    depth++;
+    return 1;
+}
 
-    JitEntranceType.tp_new = wf_new;
-    JitEntranceType.tp_init = (initproc)yapyjit::guarded<wf_init>();
-    JitEntranceType.tp_dealloc = (destructor)wf_dealloc;
-    JitEntranceType.tp_members = wf_members;
-    JitEntranceType.tp_dictoffset = offsetof(JitEntrance, extra_attrdict);
-    JitEntranceType.tp_call = PyVectorcall_Call;
-    JitEntranceType.tp_vectorcall_offset = offsetof(JitEntrance, callable_impl);
-    JitEntranceType.tp_descr_get = wf_descr_get;
+const yapyjit::SelfCall* yapyjit::SelfCallStack::leave(std::vector<PyObject*>& locals) {
+    if (!depth)
+        return nullptr;
+    auto& call = calls[--depth];
+    ((JitEntrance*)call.callee)->active--;
+    Py_LeaveRecursiveCall();
+    std::swap(locals, call.locals);
+    return &call;
+}
+
+PyObject* yapyjit::callsite_kwnames(const uint8_t* names, int n) {
+    // Canonical tuple of each set of names, so that the entrances see few distinct `kwnames`.
+    auto interned = yapyjit::context().kwnames;
+    auto kwnames = yapyjit::ManagedPyo(PyTuple_New(n));
+    if (!kwnames.borrow())
+        return nullptr;
+    for (int i = 0; i < n; i++) {
+        auto name = PyUnicode_InternFromString((const char*)names);
+        if (!name)
+            return nullptr;
+        PyTuple_SET_ITEM(kwnames.borrow(), i, name);
+        while (*names++);
+        names += sizeof(yapyjit::local_t);
+    }
+    return PyDict_SetDefault(interned, kwnames.borrow(), kwnames.borrow());
+}
+
+PyObject* yapyjit::new_function_proto(ManagedPyo code, ManagedPyo globals, std::unique_ptr<Function> body) {
+    auto func = ManagedPyo(PyFunction_New(code.borrow(), globals.borrow()));
+    if (!body)
+        return func.transfer();
+    body->refcount_elided = elide_refcounts(*body);
+    auto self = (JitEntrance*)wf_new(yapyjit::context().jit_entrance_type, nullptr, nullptr);
+    if (!self)
+        throw registered_pyexc();
+    Py_SETREF(self->wrapped, func.transfer());
+    self->compiled = std::move(body);
+    self->tier = 1;
+    self->inlined = 0;
+    self->nested = 1;
+    wf_bind_code(self);
+    wf_perf_map(self);
+    return (PyObject*)self;
+}
+
+PyObject* yapyjit::make_function(PyObject* proto, PyObject* defaults, PyObject* kwdefaults, PyObject* closure) {
+    const bool jitted = is_jit_entrance(proto);
+    auto source = (JitEntrance*)proto;
+    auto wrapped = jitted ? source->wrapped : proto;
+    auto func = PyFunction_New(PyFunction_GET_CODE(wrapped), PyFunction_GET_GLOBALS(wrapped));
+    if (!func)
+        return nullptr;
+    if ((defaults != Py_None && PyFunction_SetDefaults(func, defaults) < 0)
+        || (kwdefaults != Py_None && PyFunction_SetKwDefaults(func, kwdefaults) < 0)
+        || (closure != Py_None && PyFunction_SetClosure(func, closure) < 0)) {
+        Py_DECREF(func);
+        return nullptr;
+    }
+    if (!jitted)
+        return func;
+    auto self = (JitEntrance*)wf_new(Py_TYPE(proto), nullptr, nullptr);
+    if (!self) {
+        Py_DECREF(func);
+        return nullptr;
+    }
+    Py_SETREF(self->wrapped, func);
+    self->compiled = source->compiled;
+    self->argid_lookup = source->argid_lookup;
+    self->kw_binding = source->kw_binding;
+    self->argcount = source->argcount;
+    *self->defaults = *source->defaults;
+    wf_bind_defaults(self);
+    self->tier = 1;
+    self->inlined = 0;
+    self->nested = 1;
+    self->frontend = source->frontend;
+    return (PyObject*)self;
+}
+
+static PyType_Slot wf_slots[] = {
+    {Py_tp_doc, (void*)"Entry point to yapyjit runtime."},
+    {Py_tp_new, (void*)wf_new},
+    {Py_tp_init, (void*)yapyjit::guarded<wf_init>()},
+    {Py_tp_dealloc, (void*)wf_dealloc},
+    {Py_tp_traverse, (void*)wf_traverse},
+    {Py_tp_clear, (void*)wf_clear},
+    {Py_tp_members, wf_members},
+    {Py_tp_methods, wf_methods},
+    {Py_tp_getset, wf_getset},
+    {Py_tp_call, (void*)PyVectorcall_Call},
+    {Py_tp_descr_get, (void*)wf_descr_get},
+    {0, NULL}
+};
+
+static PyType_Spec wf_spec = {
+    "yapyjit.JitEntrance", sizeof(JitEntrance), 0,
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_METHOD_DESCRIPTOR | _Py_TPFLAGS_HAVE_VECTORCALL | Py_TPFLAGS_HAVE_GC,
+    wf_slots
+};
 
-    if (PyType_Ready(&JitEntranceType) < 0)
+int init_jit_entrance(PyObject* m, yapyjit::Context& ctx) {
+    if (!ctx.jit_entrance_type)
+        ctx.jit_entrance_type = (PyTypeObject*)PyType_FromSpec(&wf_spec);
+    if (!ctx.kwnames)
+        ctx.kwnames = PyDict_New();
+    if (!ctx.jit_entrance_type || !ctx.kwnames)
         return -1;
 
-    Py_INCREF(&JitEntranceType);
-    if (PyModule_AddObject(m, "JitEntrance", (PyObject*)&JitEntranceType) < 0) {
-        Py_DECREF(&JitEntranceType);
+    Py_INCREF(ctx.jit_entrance_type);
+    if (PyModule_AddObject(m, "JitEntrance", (PyObject*)ctx.jit_entrance_type) < 0) {
+        Py_DECREF(ctx.jit_entrance_type);
         return -1;
     }
     return 0;
@@ -0,0 +1,927 @@
+#include <algorithm>
+#include <yapyjit.h>
+#include <ir_builtins.h>
+#include <opcode.h>
+
+/**
+ * Lowering of CPython bytecode (`__code__.co_code`) into LP3.
+ *
+ * The value stack is mapped onto registers: stack depth i owns a slot register,
+ * and results are written to the slot of the depth they are pushed to.
+ * Entries may also alias other registers without a copy (`LOAD_FAST`, `COPY`, `SWAP`);
+ * such entries are materialized into their slots at jump targets,
+ * and before the aliased register is written.
+ *
+ * The bytecode format changes between CPython versions, only 3.11 is supported.
+ */
+
+namespace yapyjit {
+#if PY_VERSION_HEX >= 0x030B0000 && PY_VERSION_HEX < 0x030C0000
+	namespace {
+		struct BytecodeInsn {
+			int offset;  // Including EXTENDED_ARG prefixes.
+			int opcode;
+			int arg;
+		};
+
+		struct ExcTableEntry {
+			int start, end, target, depth;
+			bool lasti;
+		};
+
+		struct StackEntry {
+			local_t reg;  // 0 for the NULL pushed before callables.
+			PyObject* konst = nullptr;  // Borrowed from `co_consts` if loaded by `LOAD_CONST`.
+			const char* builtin = nullptr;  // Name of a builtin callable not loaded yet, see `CALL`.
+		};
+
+		int parse_varint(const uint8_t*& p) {
+			int val = *p & 63;
+			while (*p++ & 64)
+				val = (val << 6) | (*p & 63);
+			return val;
+		}
+
+		InsnTag binop_tag(int nb_op) {
+			switch (nb_op >= NB_INPLACE_ADD ? nb_op - NB_INPLACE_ADD : nb_op) {
+			case NB_ADD: return InsnTag::Add;
+			case NB_AND: return InsnTag::BitAnd;
+			case NB_FLOOR_DIVIDE: return InsnTag::FloorDiv;
+			case NB_LSHIFT: return InsnTag::LShift;
+			case NB_MATRIX_MULTIPLY: return InsnTag::MatMult;
+			case NB_MULTIPLY: return InsnTag::Mult;
+			case NB_REMAINDER: return InsnTag::Mod;
+			case NB_OR: return InsnTag::BitOr;
+			case NB_POWER: return InsnTag::Pow;
+			case NB_RSHIFT: return InsnTag::RShift;
+			case NB_SUBTRACT: return InsnTag::Sub;
+			case NB_TRUE_DIVIDE: return InsnTag::Div;
+			case NB_XOR: return InsnTag::BitXor;
+			}
+			throw std::invalid_argument("Unknown binary operator " + std::to_string(nb_op));
+		}
+
+		InsnTag compare_tag(int cmp_op) {
+			const InsnTag tags[] = { InsnTag::Lt, InsnTag::LtE, InsnTag::Eq, InsnTag::NotEq, InsnTag::Gt, InsnTag::GtE };
+			if (cmp_op < 0 || cmp_op >= 6)
+				throw std::invalid_argument("Unknown comparison operator " + std::to_string(cmp_op));
+			return tags[cmp_op];
+		}
+
+		class BytecodeLowering {
+			Function& appender;
+			ManagedPyo code, consts, names;
+			std::vector<BytecodeInsn> insns;
+			std::vector<ExcTableEntry> exctable;
+			std::vector<local_t> fast;  // Register of each fast local, -1 for free variables read from `deref_ns`.
+			std::vector<std::string> fast_names;
+			int nfast_cells;  // Fast locals and cells precede free variables.
+			bool nested;  // Body of a `MakeFunction`, whose free variables are cells in registers.
+			std::vector<StackEntry> stack;
+			std::vector<local_t> slots;
+			std::set<int> targets;
+			// `f(*args, **kwargs)` passing on the extra arguments, see `Function::forwards`:
+			// offsets of `CALL_FUNCTION_EX` and of the instructions merging `kwargs` into a new dict before it.
+			std::set<int> forward_calls, forward_skips;
+			std::map<int, std::vector<bool>> entry_nulls;  // Stack layout at jump targets.
+			std::map<int, iaddr_t> addrs;
+			std::vector<std::pair<ilabel_t, int>> jump_fixups;
+			std::vector<std::pair<size_t, int>> handler_fixups;
+			std::map<PyObject*, local_t> const_regs;
+			std::vector<ManagedPyo> const_keep;
+			local_t scratch = 0;
+			PyObject* kwnames = nullptr;
+			// Last `IterNext` or in-place operator, whose destination `STORE_FAST` may replace right after.
+			iaddr_t retarget_at = -1, retarget_end = -1;
+
+			local_t slot(size_t depth) {
+				while (slots.size() <= depth)
+					slots.push_back(new_temp_var(appender));
+				return slots[depth];
+			}
+
+			// Register holding `obj`, loaded right before use.
+			local_t load_const(ManagedPyo obj) {
+				auto it = const_regs.find(obj.borrow());
+				if (it == const_regs.end()) {
+					const_keep.push_back(obj);
+					it = const_regs.insert({ obj.borrow(), new_temp_var(appender) }).first;
+				}
+				appender.add_insn(constant_ins(it->second, obj));
+				return it->second;
+			}
+
+			local_t load_builtin(const char* name) {
+				auto blt = PyEval_GetBuiltins();
+				if (!blt) throw std::logic_error(__FUNCTION__" cannot get builtins.");
+				auto obj = PyDict_GetItemString(blt, name);
+				if (!obj) throw std::logic_error(__FUNCTION__" cannot get builtins." + std::string(name) + ".");
+				return load_const(ManagedPyo(obj, true));
+			}
+
+			// `CallBuiltin` of `id`, guarded by its name unless the call is implicit in the bytecode.
+			void call_builtin(local_t dst, BuiltinId id, const std::vector<local_t>& args, bool guarded) {
+				auto expected = builtin_object(id);
+				if (!expected) throw std::logic_error(__FUNCTION__" cannot get builtins." + std::string(builtin_name(id)) + ".");
+				appender.add_insn(call_builtin_ins(
+					dst, id,
+					guarded ? ManagedPyo(PyUnicode_InternFromString(builtin_name(id))) : ManagedPyo(Py_None, true),
+					ManagedPyo(expected, true), args
+				));
+			}
+
+			// Emits the `LOAD_GLOBAL` deferred for a builtin callable.
+			StackEntry& materialize(StackEntry& entry) {
+				if (entry.builtin) {
+					appender.add_insn(load_global_ins(entry.reg, entry.builtin));
+					entry.builtin = nullptr;
+				}
+				return entry;
+			}
+
+			local_t load_method(PyTypeObject* type, const char* name) {
+				return load_const(ManagedPyo((PyObject*)type, true).attr(name));
+			}
+
+			local_t discard() {
+				if (!scratch)
+					scratch = new_temp_var(appender);
+				return scratch;
+			}
+
+			// Copies stack entries aliasing `reg` away before it is written.
+			void protect(local_t reg) {
+				local_t copy = 0;
+				for (auto& entry : stack) {
+					if (entry.reg != reg)
+						continue;
+					if (!copy) {
+						copy = new_temp_var(appender);
+						appender.add_insn(move_ins(copy, reg));
+					}
+					entry.reg = copy;
+				}
+			}
+
+			// Defines the stack entry at `depth` in its slot register.
+			local_t def_at(size_t depth) {
+				local_t reg = slot(depth);
+				stack[depth] = { 0 };
+				protect(reg);
+				stack[depth] = { reg };
+				return reg;
+			}
+
+			local_t push_def() {
+				stack.push_back({ 0 });
+				return def_at(stack.size() - 1);
+			}
+
+			StackEntry pop() {
+				if (stack.empty())
+					throw std::logic_error("Bytecode stack underflow.");
+				auto entry = materialize(stack.back());
+				stack.pop_back();
+				return entry;
+			}
+
+			std::vector<local_t> pop_n(int n) {
+				std::vector<local_t> result(n);
+				for (int i = n - 1; i >= 0; i--)
+					result[i] = pop().reg;
+				return result;
+			}
+
+			StackEntry& peek(int n) {
+				if (n < 1 || (size_t)n > stack.size())
+					throw std::logic_error("Bytecode stack underflow.");
+				return materialize(stack[stack.size() - n]);
+			}
+
+			// Materializes all stack entries into their slot registers.
+			void flush() {
+				for (auto& entry : stack)
+					materialize(entry);
+				for (size_t i = 0; i < stack.size(); i++) {
+					auto reg = stack[i].reg;
+					if (reg && reg != slot(i) && std::find(slots.begin(), slots.end(), reg) != slots.end()) {
+						local_t copy = new_temp_var(appender);
+						appender.add_insn(move_ins(copy, reg));
+						stack[i].reg = copy;
+					}
+				}
+				for (size_t i = 0; i < stack.size(); i++) {
+					if (stack[i].reg && stack[i].reg != slot(i)) {
+						appender.add_insn(move_ins(slot(i), stack[i].reg));
+						stack[i].reg = slot(i);
+					}
+				}
+			}
+
+			// Records the layout of the first `depth` entries as the stack at `target`.
+			void enter(int target, size_t depth) {
+				std::vector<bool> nulls;
+				for (size_t i = 0; i < depth; i++)
+					nulls.push_back(stack[i].reg == 0);
+				auto ins = entry_nulls.insert({ target, nulls });
+				if (!ins.second && ins.first->second != nulls)
+					throw std::logic_error("Inconsistent stack layout at bytecode offset " + std::to_string(target));
+			}
+
+			template<typename T>
+			void add_jump(T insn, int target) {
+				jump_fixups.push_back({ appender.add_insn_label(insn), target });
+			}
+
+			// Jumps to `target` if `cond` is truthy (or falsy if `negate`), the stack must be flushed.
+			void add_cond_jump(local_t cond, bool negate, int target) {
+				if (!negate) {
+					add_jump(jump_truthy_ins(cond), target);
+					return;
+				}
+				auto lab_next = appender.add_insn_label(jump_truthy_ins(cond));
+				add_jump(jump_ins(), target);
+				*lab_next = appender.next_addr();
+			}
+
+			const ExcTableEntry* handler_at(int offset) {
+				for (const auto& entry : exctable)
+					if (entry.start <= offset && offset < entry.end)
+						return &entry;
+				return nullptr;
+			}
+
+			void set_handler(const ExcTableEntry* handler) {
+				auto addr = appender.next_addr();
+				if (appender.exctable_key.back() != addr) {
+					appender.exctable_key.push_back(addr);
+					appender.exctable_val.push_back(L_PLACEHOLDER);
+				}
+				else {
+					size_t last = appender.exctable_val.size() - 1;
+					handler_fixups.erase(std::remove_if(
+						handler_fixups.begin(), handler_fixups.end(),
+						[last](const std::pair<size_t, int>& fixup) { return fixup.first == last; }
+					), handler_fixups.end());
+					appender.exctable_val.back() = L_PLACEHOLDER;
+				}
+				if (handler)
+					handler_fixups.push_back({ appender.exctable_val.size() - 1, handler->target });
+			}
+
+			std::string opname(int opcode) {
+				auto dis = ManagedPyo(PyImport_ImportModule("dis"));
+				return dis.attr("opname")[opcode].to_cstr();
+			}
+
+			// Sets `forward_calls` if `*args` and `**kwargs` are only passed on unchanged.
+			void find_forwards() {
+				const int vararg = (int)(code.attr("co_argcount").to_cLL() + code.attr("co_kwonlyargcount").to_cLL());
+				const int varkw = vararg + 1;
+				int uses = 0;
+				for (const auto& insn : insns) {
+					switch (insn.opcode) {
+					case LOAD_FAST: case STORE_FAST: case DELETE_FAST: case MAKE_CELL: case LOAD_CLOSURE:
+					case LOAD_DEREF: case STORE_DEREF: case DELETE_DEREF: case LOAD_CLASSDEREF:
+						uses += insn.arg == vararg || insn.arg == varkw;
+					}
+				}
+				for (size_t i = 0; i + 4 < insns.size(); i++) {
+					const BytecodeInsn* p = &insns[i];
+					if (p[0].opcode == LOAD_FAST && p[0].arg == vararg && p[1].opcode == BUILD_MAP && p[1].arg == 0
+						&& p[2].opcode == LOAD_FAST && p[2].arg == varkw && p[3].opcode == DICT_MERGE && p[3].arg == 1
+						&& p[4].opcode == CALL_FUNCTION_EX && p[4].arg == 1) {
+						forward_calls.insert(p[4].offset);
+						for (int j = 1; j < 4; j++)
+							forward_skips.insert(p[j].offset);
+					}
+				}
+				if (forward_calls.empty() || uses != 2 * (int)forward_calls.size()) {
+					forward_calls.clear();
+					forward_skips.clear();
+				}
+				appender.forwards = !forward_calls.empty();
+			}
+
+			void decode() {
+				auto co_code = code.attr("co_code");
+				auto raw = reinterpret_cast<const uint8_t*>(PyBytes_AsString(co_code.borrow()));
+				if (!raw) throw registered_pyexc();
+				int size = (int)PyBytes_GET_SIZE(co_code.borrow());
+				int ext = 0, start = 0;
+				for (int i = 0; i < size; i += 2) {
+					int op = raw[i], arg = raw[i + 1] | ext;
+					if (op == CACHE)
+						continue;
+					if (!ext)
+						start = i;
+					if (op == EXTENDED_ARG) {
+						ext = arg << 8;
+						continue;
+					}
+					ext = 0;
+					insns.push_back({ start, op, arg });
+					int next = i + 2;
+					switch (op) {
+					case JUMP_FORWARD: case JUMP_IF_FALSE_OR_POP: case JUMP_IF_TRUE_OR_POP:
+					case POP_JUMP_FORWARD_IF_FALSE: case POP_JUMP_FORWARD_IF_TRUE:
+					case POP_JUMP_FORWARD_IF_NONE: case POP_JUMP_FORWARD_IF_NOT_NONE:
+					case FOR_ITER:
+						insns.back().arg = next + arg * 2;
+						targets.insert(insns.back().arg);
+						break;
+					case JUMP_BACKWARD: case JUMP_BACKWARD_NO_INTERRUPT:
+					case POP_JUMP_BACKWARD_IF_FALSE: case POP_JUMP_BACKWARD_IF_TRUE:
+					case POP_JUMP_BACKWARD_IF_NONE: case POP_JUMP_BACKWARD_IF_NOT_NONE:
+						insns.back().arg = next - arg * 2;
+						targets.insert(insns.back().arg);
+						break;
+					}
+				}
+
+				auto table = code.attr("co_exceptiontable");
+				auto p = reinterpret_cast<const uint8_t*>(PyBytes_AsString(table.borrow()));
+				if (!p) throw registered_pyexc();
+				auto end = p + PyBytes_GET_SIZE(table.borrow());
+				while (p < end) {
+					ExcTableEntry entry;
+					entry.start = parse_varint(p) * 2;
+					entry.end = entry.start + parse_varint(p) * 2;
+					entry.target = parse_varint(p) * 2;
+					int depth_lasti = parse_varint(p);
+					entry.depth = depth_lasti >> 1;
+					entry.lasti = depth_lasti & 1;
+					exctable.push_back(entry);
+					targets.insert(entry.target);
+				}
+			}
+
+			void lower(const BytecodeInsn& insn);
+
+		public:
+			BytecodeLowering(Function& appender_, ManagedPyo code_, bool nested_ = false) :
+				appender(appender_), code(code_),
+				consts(code.attr("co_consts")), names(code.attr("co_names")), nested(nested_) { }
+
+			void run() {
+				auto flags = code.attr("co_flags").to_cLL();
+				if (flags & (CO_GENERATOR | CO_COROUTINE | CO_ASYNC_GENERATOR))
+					throw std::invalid_argument("Generators and coroutines are not supported yet.");
+				appender.varargs = flags & CO_VARARGS;
+				appender.varkw = flags & CO_VARKEYWORDS;
+
+				// Fast locals, then cells that are not fast locals, then free variables.
+				for (auto name : code.attr("co_varnames")) {
+					fast.push_back(appender.locals.insert({ name.to_cstr(), (local_t)(appender.locals.size() + 1) }).first->second);
+					fast_names.push_back(name.to_cstr());
+				}
+				for (auto name : code.attr("co_cellvars")) {
+					auto ins = appender.locals.insert({ name.to_cstr(), (local_t)(appender.locals.size() + 1) });
+					if (ins.second) {
+						fast.push_back(ins.first->second);
+						fast_names.push_back(name.to_cstr());
+					}
+				}
+				nfast_cells = (int)fast.size();
+				local_t idx = 0;
+				for (auto name : code.attr("co_freevars")) {
+					if (nested) {
+						fast.push_back(appender.locals.insert({ name.to_cstr(), (local_t)(appender.locals.size() + 1) }).first->second);
+						appender.free_cells.push_back(fast.back());
+					}
+					else {
+						appender.closure[name.to_cstr()] = idx++;
+						fast.push_back(-1);
+					}
+					fast_names.push_back(name.to_cstr());
+				}
+
+				decode();
+				if (appender.varargs && appender.varkw)
+					find_forwards();
+				appender.add_insn(prolog_ins());
+				bool reachable = true;
+				const ExcTableEntry* handler = nullptr;
+				for (const auto& insn : insns) {
+					const ExcTableEntry* handler_entry = nullptr;
+					if (targets.count(insn.offset)) {
+						if (reachable) {
+							flush();
+							enter(insn.offset, stack.size());
+						}
+						for (const auto& entry : exctable)
+							if (entry.target == insn.offset)
+								handler_entry = &entry;
+						auto it = entry_nulls.find(insn.offset);
+						if (handler_entry) {
+							stack.clear();
+							for (int i = 0; i < handler_entry->depth; i++)
+								stack.push_back({ slot(i) });
+							reachable = true;
+						}
+						else if (it != entry_nulls.end()) {
+							stack.clear();
+							for (size_t i = 0; i < it->second.size(); i++)
+								stack.push_back({ it->second[i] ? (local_t)0 : slot(i) });
+							reachable = true;
+						}
+					}
+					if (!reachable)
+						continue;
+					addrs[insn.offset] = appender.next_addr();
+					auto insn_handler = handler_at(insn.offset);
+					if (insn_handler != handler)
+						set_handler(handler = insn_handler);
+					if (handler_entry) {
+						// The stack is unwound to the depth of the handler, then `lasti` and the exception are pushed.
+						if (handler_entry->lasti)
+							appender.add_insn(constant_ins(push_def(), ManagedPyo(Py_None, true)));
+						auto lab = appender.add_insn_label(check_error_type_ins(push_def(), -1));
+						*lab = appender.next_addr();
+					}
+					switch (insn.opcode) {
+					case JUMP_FORWARD: case JUMP_BACKWARD: case JUMP_BACKWARD_NO_INTERRUPT:
+					case RETURN_VALUE: case RAISE_VARARGS: case RERAISE:
+						reachable = false;
+						break;
+					}
+					lower(insn);
+				}
+				if (reachable)
+					throw std::logic_error("Bytecode falls off the end.");
+				appender.add_insn(epilog_ins());
+
+				for (auto& fixup : jump_fixups)
+					*fixup.first = addrs.at(fixup.second);
+				for (auto& fixup : handler_fixups)
+					appender.exctable_val[fixup.first] = addrs.at(fixup.second);
+			}
+		};
+
+		void BytecodeLowering::lower(const BytecodeInsn& insn) {
+			const int arg = insn.arg;
+			if (forward_skips.count(insn.offset))
+				return;
+			switch (insn.opcode) {
+			case NOP: case RESUME: case PRECALL: case COPY_FREE_VARS:
+				break;
+			case POP_TOP:
+				pop();
+				break;
+			case PUSH_NULL:
+				stack.push_back({ 0 });
+				break;
+			case COPY:
+				stack.push_back(peek(arg));
+				break;
+			case SWAP:
+				std::swap(peek(1), peek(arg));
+				break;
+			case LOAD_CONST: {
+				auto konst = PyTuple_GET_ITEM(consts.borrow(), arg);
+				appender.add_insn(constant_ins(push_def(), ManagedPyo(konst, true)));
+				stack.back().konst = konst;
+				break;
+			}
+			case LOAD_ASSERTION_ERROR:
+				appender.add_insn(constant_ins(push_def(), ManagedPyo(PyExc_AssertionError, true)));
+				break;
+			case LOAD_FAST:
+				stack.push_back({ fast[arg] });
+				break;
+			case STORE_FAST: {
+				auto src = pop();
+				if (appender.next_addr() == retarget_end && src.reg == slot(stack.size())
+					&& std::none_of(stack.begin(), stack.end(), [&](const StackEntry& e) { return e.reg == fast[arg]; })) {
+					// Written there directly: loop targets read nowhere stay unboxed (see `elide_refcounts`),
+					// and `s += t` on strings can resize in place.
+					*reinterpret_cast<local_t*>(appender.bytecode().data() + retarget_at + 1) = fast[arg];
+					break;
+				}
+				protect(fast[arg]);
+				appender.add_insn(move_ins(fast[arg], src.reg));
+				break;
+			}
+			case DELETE_FAST:
+				protect(fast[arg]);
+				appender.add_insn(constant_ins(fast[arg], ManagedPyo(Py_None, true)));
+				break;
+			case MAKE_CELL: {
+				auto cell_type = load_const(ManagedPyo((PyObject*)&PyCell_Type, true));
+				std::vector<local_t> args;
+				if (arg < appender.nargs)
+					args.push_back(fast[arg]);
+				protect(fast[arg]);
+				appender.add_insn(call_ins(fast[arg], cell_type, args, {}, appender.new_callsite()));
+				break;
+			}
+			case LOAD_CLOSURE: {
+				if (fast[arg] >= 0) {
+					stack.push_back({ fast[arg] });
+					break;
+				}
+				auto closure = load_const(appender.deref_ns);
+				auto idx = load_const(ManagedPyo::from_int(arg - nfast_cells));
+				appender.add_insn(load_item_ins(push_def(), closure, idx));
+				break;
+			}
+			case LOAD_DEREF:
+				if (fast[arg] >= 0)
+					appender.add_insn(load_cell_ins(push_def(), fast[arg], fast_names[arg]));
+				else
+					appender.add_insn(load_closure_ins(push_def(), arg - nfast_cells));
+				break;
+			case STORE_DEREF: {
+				auto src = pop();
+				if (fast[arg] >= 0)
+					appender.add_insn(store_cell_ins(src.reg, fast[arg]));
+				else
+					appender.add_insn(store_closure_ins(src.reg, arg - nfast_cells));
+				break;
+			}
+			case LOAD_GLOBAL: {
+				const char* name = names[arg >> 1].to_cstr();
+				if (arg & 1) {
+					stack.push_back({ 0 });
+					// Callable of a call, which `CALL` specializes if it is still the builtin there.
+					auto id = builtin_id(name);
+					if (id && builtin_object(*id) && !PyDict_GetItemString(appender.globals_ns.borrow(), name)) {
+						local_t reg = slot(stack.size());
+						stack.push_back({ reg, nullptr, name });
+						break;
+					}
+				}
+				appender.add_insn(load_global_ins(push_def(), name));
+				break;
+			}
+			case STORE_GLOBAL:
+				appender.add_insn(store_global_ins(pop().reg, names[arg].to_cstr()));
+				break;
+			case LOAD_ATTR: {
+				auto obj = pop();
+				appender.add_insn(load_attr_ins(push_def(), obj.reg, names[arg].to_cstr()));
+				break;
+			}
+			case LOAD_METHOD: {
+				// The method and `self`, or None and the attribute, see `CALL`.
+				auto obj = pop();
+				local_t meth = push_def();
+				appender.add_insn(load_method_ins(meth, push_def(), obj.reg, ManagedPyo(PyUnicode_InternFromString(names[arg].to_cstr()))));
+				break;
+			}
+			case STORE_ATTR: {
+				auto obj = pop();
+				auto src = pop();
+				appender.add_insn(store_attr_ins(obj.reg, src.reg, names[arg].to_cstr()));
+				break;
+			}
+			case DELETE_ATTR:
+				appender.add_insn(del_attr_ins(pop().reg, names[arg].to_cstr()));
+				break;
+			case BINARY_SUBSCR: {
+				auto subscr = pop();
+				auto obj = pop();
+				appender.add_insn(load_item_ins(push_def(), obj.reg, subscr.reg));
+				break;
+			}
+			case STORE_SUBSCR: {
+				auto subscr = pop();
+				auto obj = pop();
+				auto src = pop();
+				appender.add_insn(store_item_ins(obj.reg, src.reg, subscr.reg));
+				break;
+			}
+			case DELETE_SUBSCR: {
+				auto subscr = pop();
+				auto obj = pop();
+				appender.add_insn(del_item_ins(obj.reg, subscr.reg));
+				break;
+			}
+			case BINARY_OP: {
+				auto right = pop();
+				auto left = pop();
+				auto dst = push_def();
+				if (arg < NB_INPLACE_ADD) {
+					const InsnTag tag = binop_tag(arg);
+					appender.add_insn(binop_ins(tag, dst, left.reg, right.reg, appender.new_binop_icache(tag)));
+					break;
+				}
+				// The `InplaceOp` group follows `BinOp` in the same order.
+				const InsnTag tag = InsnTag::_from_integral(binop_tag(arg) + InsnTag::InplaceAdd - InsnTag::Add);
+				retarget_at = appender.next_addr();
+				appender.add_insn(inplaceop_ins(tag, dst, left.reg, right.reg, appender.new_binop_icache(tag)));
+				retarget_end = appender.next_addr();
+				break;
+			}
+			case UNARY_POSITIVE: case UNARY_NEGATIVE: case UNARY_NOT: case UNARY_INVERT: {
+				const InsnTag tag = insn.opcode == UNARY_POSITIVE ? +InsnTag::UAdd
+					: insn.opcode == UNARY_NEGATIVE ? +InsnTag::USub
+					: insn.opcode == UNARY_NOT ? +InsnTag::Not : +InsnTag::Invert;
+				auto src = pop();
+				appender.add_insn(unaryop_ins(tag, push_def(), src.reg));
+				break;
+			}
+			case COMPARE_OP: case IS_OP: case CONTAINS_OP: {
+				const InsnTag tag = insn.opcode == COMPARE_OP ? compare_tag(arg)
+					: insn.opcode == IS_OP ? (arg ? +InsnTag::IsNot : +InsnTag::Is)
+					: (arg ? +InsnTag::NotIn : +InsnTag::In);
+				auto right = pop();
+				auto left = pop();
+				appender.add_insn(compare_ins(tag, push_def(), left.reg, right.reg));
+				break;
+			}
+			case BUILD_TUPLE: case BUILD_LIST: case BUILD_SET: case BUILD_MAP: {
+				const InsnTag tag = insn.opcode == BUILD_TUPLE ? +InsnTag::BuildTuple
+					: insn.opcode == BUILD_LIST ? +InsnTag::BuildList
+					: insn.opcode == BUILD_SET ? +InsnTag::BuildSet : +InsnTag::BuildDict;
+				auto args = pop_n(insn.opcode == BUILD_MAP ? arg * 2 : arg);
+				appender.add_insn(build_ins(tag, push_def(), args));
+				break;
+			}
+			case BUILD_CONST_KEY_MAP: {
+				auto keys = pop();
+				if (!keys.konst || !PyTuple_CheckExact(keys.konst))
+					throw std::logic_error("BUILD_CONST_KEY_MAP without constant keys.");
+				auto values = pop_n(arg);
+				std::vector<local_t> args;
+				for (int i = 0; i < arg; i++) {
+					local_t key = new_temp_var(appender);
+					appender.add_insn(constant_ins(key, ManagedPyo(PyTuple_GET_ITEM(keys.konst, i), true)));
+					args.push_back(key);
+					args.push_back(values[i]);
+				}
+				appender.add_insn(build_ins(InsnTag::BuildDict, push_def(), args));
+				break;
+			}
+			case BUILD_SLICE: {
+				auto args = pop_n(arg);
+				auto slice = load_const(ManagedPyo((PyObject*)&PySlice_Type, true));
+				appender.add_insn(call_ins(push_def(), slice, args, {}, appender.new_callsite()));
+				break;
+			}
+			case BUILD_STRING: {
+				auto args = pop_n(arg);
+				auto joiner = load_const(ManagedPyo(PyUnicode_FromString("")).attr("join"));
+				auto parts = discard();
+				appender.add_insn(build_ins(InsnTag::BuildTuple, parts, args));
+				appender.add_insn(call_ins(push_def(), joiner, { parts }, {}, appender.new_callsite()));
+				break;
+			}
+			case FORMAT_VALUE: {
+				std::vector<local_t> args;
+				if (arg & 4)
+					args.push_back(pop().reg);
+				auto value = pop().reg;
+				const char* converters[] = { nullptr, "str", "repr", "ascii" };
+				if (arg & 3) {
+					auto converter = load_builtin(converters[arg & 3]);
+					auto converted = new_temp_var(appender);
+					appender.add_insn(call_ins(converted, converter, { value }, {}, appender.new_callsite()));
+					value = converted;
+				}
+				args.insert(args.begin(), value);
+				auto format = load_builtin("format");
+				appender.add_insn(call_ins(push_def(), format, args, {}, appender.new_callsite()));
+				break;
+			}
+			case LIST_APPEND: case SET_ADD: {
+				auto value = pop();
+				auto container = peek(arg).reg;
+				if (insn.opcode == LIST_APPEND)
+					appender.add_insn(list_append_ins(container, value.reg));
+				else
+					appender.add_insn(set_add_ins(container, value.reg));
+				break;
+			}
+			case LIST_EXTEND: case SET_UPDATE: case DICT_UPDATE: case DICT_MERGE: {
+				auto value = pop();
+				auto container = peek(arg).reg;
+				local_t method = insn.opcode == LIST_EXTEND ? load_method(&PyList_Type, "extend")
+					: insn.opcode == SET_UPDATE ? load_method(&PySet_Type, "update")
+					: load_method(&PyDict_Type, "update");
+				appender.add_insn(call_ins(discard(), method, { container, value.reg }, {}, appender.new_callsite()));
+				break;
+			}
+			case MAP_ADD: {
+				auto value = pop();
+				auto key = pop();
+				auto container = peek(arg).reg;
+				appender.add_insn(map_add_ins(container, key.reg, value.reg));
+				break;
+			}
+			case LIST_TO_TUPLE: {
+				auto list = pop();
+				auto tuple = load_const(ManagedPyo((PyObject*)&PyTuple_Type, true));
+				appender.add_insn(call_ins(push_def(), tuple, { list.reg }, {}, appender.new_callsite()));
+				break;
+			}
+			case UNPACK_SEQUENCE: {
+				auto src = pop();
+				// The first item ends up on the top.
+				size_t base = stack.size();
+				std::vector<local_t> dsts(arg);
+				for (int i = 0; i < arg; i++)
+					stack.push_back({ 0 });
+				for (int i = 0; i < arg; i++)
+					dsts[arg - 1 - i] = def_at(base + i);
+				appender.add_insn(destruct_ins(src.reg, dsts));
+				break;
+			}
+			case GET_ITER: {
+				auto src = pop();
+				appender.add_insn(get_iter_ins(push_def(), src.reg));
+				break;
+			}
+			case FOR_ITER: {
+				flush();
+				auto iter = peek(1).reg;
+				enter(arg, stack.size() - 1);
+				auto [addr, label] = appender.add_insn_addr_and_label(iter_next_ins(push_def(), iter));
+				jump_fixups.push_back({ label, arg });
+				retarget_at = addr;
+				retarget_end = appender.next_addr();
+				break;
+			}
+			case JUMP_FORWARD: case JUMP_BACKWARD: case JUMP_BACKWARD_NO_INTERRUPT:
+				flush();
+				enter(arg, stack.size());
+				add_jump(jump_ins(), arg);
+				break;
+			case POP_JUMP_FORWARD_IF_TRUE: case POP_JUMP_BACKWARD_IF_TRUE:
+			case POP_JUMP_FORWARD_IF_FALSE: case POP_JUMP_BACKWARD_IF_FALSE: {
+				flush();
+				auto cond = pop();
+				enter(arg, stack.size());
+				add_cond_jump(cond.reg, insn.opcode == POP_JUMP_FORWARD_IF_FALSE || insn.opcode == POP_JUMP_BACKWARD_IF_FALSE, arg);
+				break;
+			}
+			case POP_JUMP_FORWARD_IF_NONE: case POP_JUMP_BACKWARD_IF_NONE:
+			case POP_JUMP_FORWARD_IF_NOT_NONE: case POP_JUMP_BACKWARD_IF_NOT_NONE: {
+				flush();
+				auto value = pop();
+				enter(arg, stack.size());
+				auto none = load_const(ManagedPyo(Py_None, true));
+				auto cond = discard();
+				appender.add_insn(compare_ins(InsnTag::Is, cond, value.reg, none));
+				add_cond_jump(cond, insn.opcode == POP_JUMP_FORWARD_IF_NOT_NONE || insn.opcode == POP_JUMP_BACKWARD_IF_NOT_NONE, arg);
+				break;
+			}
+			case JUMP_IF_TRUE_OR_POP: case JUMP_IF_FALSE_OR_POP:
+				flush();
+				enter(arg, stack.size());
+				add_cond_jump(peek(1).reg, insn.opcode == JUMP_IF_FALSE_OR_POP, arg);
+				pop();
+				break;
+			case KW_NAMES:
+				kwnames = PyTuple_GET_ITEM(consts.borrow(), arg);
+				break;
+			case CALL: {
+				if (!kwnames && stack.size() >= (size_t)arg + 2) {
+					auto callable = stack[stack.size() - arg - 1];
+					if (callable.builtin && !stack[stack.size() - arg - 2].reg) {
+						auto args = pop_n(arg);
+						stack.resize(stack.size() - 2);
+						call_builtin(push_def(), *builtin_id(callable.builtin), args, true);
+						break;
+					}
+				}
+				auto args = pop_n(arg);
+				auto callable = pop();
+				// Only `LOAD_METHOD` leaves a register under the callable, which is then `self`.
+				auto method = pop();
+				if (method.reg)
+					args.insert(args.begin(), callable.reg);
+				std::map<std::string, local_t> kwargs;
+				size_t nkw = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+				for (size_t i = 0; i < nkw; i++)
+					kwargs[PyUnicode_AsUTF8(PyTuple_GET_ITEM(kwnames, i))] = args[args.size() - nkw + i];
+				args.resize(args.size() - nkw);
+				kwnames = nullptr;
+				if (method.reg)
+					appender.add_insn(call_method_ins(push_def(), method.reg, args, kwargs, appender.new_callsite()));
+				else
+					appender.add_insn(call_ins(push_def(), callable.reg, args, kwargs, appender.new_callsite()));
+				break;
+			}
+			case CALL_FUNCTION_EX: {
+				if (forward_calls.count(insn.offset)) {
+					pop();  // `*args`, with `**kwargs` skipped
+					auto callable = pop();
+					pop();
+					appender.add_insn(call_forward_ins(push_def(), callable.reg, appender.nargs + 1, appender.nargs + 2));
+					break;
+				}
+				local_t kwargs = arg & 1 ? pop().reg : load_const(ManagedPyo(Py_None, true));
+				auto callargs = pop();
+				auto callable = pop();
+				pop();
+				appender.add_insn(call_ex_ins(push_def(), callable.reg, callargs.reg, kwargs));
+				break;
+			}
+			case MAKE_FUNCTION: {
+				auto code_entry = pop();
+				if (!code_entry.konst)
+					throw std::invalid_argument("MAKE_FUNCTION of a code object that is not a constant.");
+				auto code_obj = ManagedPyo(code_entry.konst, true);
+				auto none = load_const(ManagedPyo(Py_None, true));
+				local_t closure = arg & 8 ? pop().reg : none;
+				local_t annotations = arg & 4 ? pop().reg : 0;
+				local_t kwdefaults = arg & 2 ? pop().reg : none;
+				local_t defaults = arg & 1 ? pop().reg : none;
+				// Compiled along with the enclosing function, or left to CPython if not supported.
+				std::unique_ptr<Function> body;
+				try {
+					body = std::make_unique<Function>(
+						appender.globals_ns, ManagedPyo(Py_None, true), code_obj.attr("co_name").to_cstr(),
+						(int)(code_obj.attr("co_argcount").to_cLL() + code_obj.attr("co_kwonlyargcount").to_cLL())
+					);
+					BytecodeLowering(*body, code_obj, true).run();
+				}
+				catch (std::exception&) {
+					PyErr_Clear();
+					body.reset();
+				}
+				auto function = new_temp_var(appender);
+				appender.add_insn(make_function_ins(
+					function, ManagedPyo(new_function_proto(code_obj, appender.globals_ns, std::move(body))),
+					defaults, kwdefaults, closure
+				));
+				if (annotations)
+					appender.add_insn(store_attr_ins(function, annotations, "__annotations__"));
+				appender.add_insn(move_ins(push_def(), function));
+				break;
+			}
+			case BEFORE_WITH: {
+				auto manager = pop();
+				auto enter = new_temp_var(appender);
+				appender.add_insn(load_attr_ins(enter, manager.reg, "__enter__"));
+				appender.add_insn(load_attr_ins(push_def(), manager.reg, "__exit__"));
+				appender.add_insn(call_ins(push_def(), enter, {}, {}, appender.new_callsite()));
+				break;
+			}
+			case WITH_EXCEPT_START: {
+				// Stack: __exit__, lasti, previous exception, exception.
+				auto exit = peek(4).reg;
+				auto exc = peek(1).reg;
+				auto type = load_const(ManagedPyo((PyObject*)&PyType_Type, true));
+				auto exc_type = new_temp_var(appender);
+				auto exc_tb = new_temp_var(appender);
+				appender.add_insn(call_ins(exc_type, type, { exc }, {}, appender.new_callsite()));
+				appender.add_insn(load_attr_ins(exc_tb, exc, "__traceback__"));
+				appender.add_insn(call_ins(push_def(), exit, { exc_type, exc, exc_tb }, {}, appender.new_callsite()));
+				break;
+			}
+			case PUSH_EXC_INFO: {
+				// The exception is already set as handled by the handler entry, the previous one is not kept.
+				auto exc = peek(1).reg;
+				appender.add_insn(move_ins(push_def(), exc));
+				appender.add_insn(constant_ins(def_at(stack.size() - 2), ManagedPyo(Py_None, true)));
+				break;
+			}
+			case POP_EXCEPT:
+				pop();
+				appender.add_insn(clear_error_ctx_ins());
+				break;
+			case CHECK_EXC_MATCH: {
+				auto type = pop();
+				auto exc = peek(1).reg;
+				call_builtin(push_def(), BuiltinId::IsInstance, { exc, type.reg }, false);
+				break;
+			}
+			case RERAISE:
+				appender.add_insn(raise_ins(pop().reg));
+				break;
+			case RAISE_VARARGS:
+				if (arg == 0)
+					appender.add_insn(raise_ins(-1));
+				else if (arg == 1)
+					appender.add_insn(raise_ins(pop().reg));
+				else
+					throw std::invalid_argument("`raise ... from ...` is not supported yet.");
+				break;
+			case RETURN_VALUE:
+				appender.add_insn(return_ins(pop().reg));
+				break;
+			default:
+				throw std::invalid_argument(
+					std::string(__FUNCTION__" met unsupported opcode ") + opname(insn.opcode)
+				);
+			}
+		}
+	}
+
+	std::unique_ptr<Function> bytecode_emit_ir(ManagedPyo pyfunc) {
+		auto code = pyfunc.attr("__code__");
+		auto appender = std::make_unique<Function>(
+			pyfunc.attr("__globals__"), pyfunc.attr("__closure__"), code.attr("co_name").to_cstr(),
+			(int)(code.attr("co_argcount").to_cLL() + code.attr("co_kwonlyargcount").to_cLL())
+		);
+		BytecodeLowering(*appender, code).run();
+		return appender;
+	}
+#else
+	std::unique_ptr<Function> bytecode_emit_ir(ManagedPyo pyfunc) {
+		throw std::runtime_error("The bytecode front end only supports CPython 3.11.");
+	}
+#endif
+};
@@ -0,0 +1,61 @@
+#include <ir_builtins.h>
+#include <yapyjit.h>
+
+namespace yapyjit {
+	PyObject* range_counter_next(RangeCounter* self) {
+		if (self->index == self->len)
+			return nullptr;
+		return PyLong_FromLongLong(self->at(self->index++));
+	}
+
+	PyObject* loop_iter(PyObject* iterable) {
+		if (!PyRange_Check(iterable))
+			return PyObject_GetIter(iterable);
+		auto& ctx = context();
+		PyObject* const names[] = { ctx.intern("start"), ctx.intern("stop"), ctx.intern("step") };
+		// Values lie between start and stop, so they fit if the bounds do.
+		long long bounds[3];
+		for (int i = 0; i < 3; i++) {
+			PyObject* bound = PyObject_GetAttr(iterable, names[i]);
+			if (!bound)
+				return nullptr;
+			int overflow;
+			bounds[i] = PyLong_AsLongLongAndOverflow(bound, &overflow);
+			Py_DECREF(bound);
+			if (overflow)
+				return PyObject_GetIter(iterable);
+		}
+		Py_ssize_t len = PyObject_Size(iterable);
+		if (len < 0) {
+			if (!PyErr_ExceptionMatches(PyExc_OverflowError))
+				return nullptr;
+			PyErr_Clear();
+			return PyObject_GetIter(iterable);
+		}
+		auto counter = PyObject_New(RangeCounter, context().range_counter_type);
+		if (!counter)
+			return nullptr;
+		counter->start = bounds[0];
+		counter->step = bounds[2];
+		counter->index = 0;
+		counter->len = len;
+		return (PyObject*)counter;
+	}
+};
+
+static PyType_Slot range_counter_slots[] = {
+	{ Py_tp_doc, (void*)"Iterator of jitted loops over ranges." },
+	{ Py_tp_iter, (void*)PyObject_SelfIter },
+	{ Py_tp_iternext, (void*)yapyjit::range_counter_next },
+	{ 0, NULL }
+};
+
+static PyType_Spec range_counter_spec = {
+	"yapyjit.RangeCounter", sizeof(yapyjit::RangeCounter), 0, Py_TPFLAGS_DEFAULT, range_counter_slots
+};
+
+int init_builtins(PyObject* m, yapyjit::Context& ctx) {
+	if (!ctx.range_counter_type)
+		ctx.range_counter_type = (PyTypeObject*)PyType_FromSpec(&range_counter_spec);
+	return ctx.range_counter_type ? 0 : -1;
+}
@@ -0,0 +1,289 @@
+#include <algorithm>
+#include <ir_inline.h>
+#include <ir_walker.h>
+
+namespace yapyjit {
+	namespace {
+		template<typename T>
+		T read(uint8_t*& q) {
+			T result = *reinterpret_cast<T*>(q);
+			q += sizeof(T);
+			return result;
+		}
+
+		iaddr_t handler_of(Function& func, iaddr_t addr) {
+			auto tab = std::upper_bound(func.exctable_key.begin(), func.exctable_key.end(), addr);
+			--tab;
+			return func.exctable_val[std::distance(func.exctable_key.begin(), tab)];
+		}
+
+		/**
+		 * Bytecode under construction. Jump targets and exception handlers
+		 * are kept as labels and resolved when all code has been emitted.
+		 * Label -1 stands for L_PLACEHOLDER (propagate to the caller).
+		 */
+		class Rewriter {
+		public:
+			Function& root;
+			inline_resolver_t resolver;
+			const InlineBudget& budget;
+			std::vector<uint8_t> code;
+			std::vector<iaddr_t> label_addr;
+			std::vector<std::pair<size_t, int>> fixups;  // Position of an iaddr operand, label.
+			std::vector<std::pair<iaddr_t, int>> handlers;  // Instruction address, handler label.
+			std::vector<std::pair<iaddr_t, icache_header_t*>> icache_sites;
+			std::vector<Function*> stack;
+			size_t growth = 0;
+			int sites = 0;
+
+			Rewriter(Function& root_, inline_resolver_t resolver_, const InlineBudget& budget_):
+				root(root_), resolver(resolver_), budget(budget_), stack{ &root_ } { }
+
+			int new_label() {
+				label_addr.push_back(L_PLACEHOLDER);
+				return static_cast<int>(label_addr.size() - 1);
+			}
+
+			int label_of(std::map<iaddr_t, int>& labels, iaddr_t addr) {
+				auto it = labels.find(addr);
+				if (it != labels.end())
+					return it->second;
+				return labels[addr] = new_label();
+			}
+
+			void bind(int label) {
+				label_addr[label] = static_cast<iaddr_t>(code.size());
+			}
+
+			template<typename T>
+			void emit(const T& insn, int handler) {
+				handlers.push_back({ static_cast<iaddr_t>(code.size()), handler });
+				code.insert(code.end(), insn.begin(), insn.end());
+			}
+
+			// Makes the iaddr operand ending the last emitted instruction point to `label`.
+			void target_last(int label) {
+				fixups.push_back({ code.size() - sizeof(iaddr_t), label });
+			}
+
+			// Copies the instruction [p, next) from `src`, renaming registers by `base`.
+			void copy(uint8_t* p, uint8_t* next, local_t base, std::map<iaddr_t, int>& labels, int handler) {
+				const bool owned = stack.size() == 1;
+				const auto at = code.size();
+				handlers.push_back({ static_cast<iaddr_t>(at), handler });
+				code.insert(code.end(), p, next);
+				walk_insn(code.data() + at, [&](OperandKind kind, uint8_t* operand) {
+					switch (kind) {
+					case OperandKind::Local:
+					case OperandKind::DefLocal: {
+						auto& l = *reinterpret_cast<local_t*>(operand);
+						if (l > 0)
+							l += base;
+						break;
+					}
+					case OperandKind::IAddr:
+						fixups.push_back({ operand - code.data(), label_of(labels, *reinterpret_cast<iaddr_t*>(operand)) });
+						break;
+					case OperandKind::PyObj:
+						// Root instructions move to the new buffer; copies of callees own a new reference.
+						if (!owned)
+							Py_XINCREF(*reinterpret_cast<PyObject**>(operand));
+						break;
+					case OperandKind::ICache2:
+						// Operations without a cache keep none.
+						if (!owned && *reinterpret_cast<icache_t<2>**>(operand)) {
+							auto cache = new (root.allocate_fill(sizeof(icache_t<2>))) icache_t<2>();
+							*reinterpret_cast<icache_t<2>**>(operand) = cache;
+							icache_sites.push_back({ static_cast<iaddr_t>(at), cache });
+						}
+						break;
+					case OperandKind::CallSite:
+						// Sites live in the fills of their function, which may be released before the root.
+						if (!owned) {
+							auto& site = *reinterpret_cast<callsite_t**>(operand);
+							site = new (root.allocate_fill(sizeof(callsite_t))) callsite_t(*site);
+						}
+						break;
+					default:
+						break;
+					}
+				});
+			}
+
+			/**
+			 * Copies `src` into the output with registers offset by `base`.
+			 * For inlined bodies (`ret_dst` > 0), `Return` writes `ret_dst` and jumps to `done`,
+			 * and errors not handled inside go to `propagate`.
+			 */
+			void expand(Function& src, local_t base, std::map<iaddr_t, int>& labels, local_t ret_dst, int done, int propagate) {
+				uint8_t* start = src.bytecode().data();
+				uint8_t* end = start + src.bytecode().size();
+				uint8_t* prev = nullptr;
+				for (uint8_t* p = start; p < end;) {
+					const iaddr_t addr = static_cast<iaddr_t>(p - start);
+					bind(label_of(labels, addr));
+					const iaddr_t src_handler = handler_of(src, addr);
+					const int handler = src_handler == L_PLACEHOLDER ? propagate : label_of(labels, src_handler);
+					uint8_t* next = walk_insn(p, [](OperandKind, uint8_t*) {});
+					if (ret_dst > 0 && (*p == InsnTag::Prolog || *p == InsnTag::Epilog)) {
+						prev = nullptr;
+					}
+					else if (ret_dst > 0 && *p == InsnTag::Return) {
+						local_t ret_src = *reinterpret_cast<local_t*>(p + 1);
+						emit(move_ins(ret_dst, ret_src + base), handler);
+						emit(jump_ins(), handler);
+						target_last(done);
+						prev = nullptr;
+					}
+					else {
+						if (!(*p == InsnTag::Call && prev && try_inline(src, prev, p, next, base, labels, handler)))
+							copy(p, next, base, labels, handler);
+						prev = p;
+					}
+					p = next;
+				}
+				bind(label_of(labels, static_cast<iaddr_t>(end - start)));
+			}
+
+			// Inlines the call at `call` if `prev` loaded its function object and the callee qualifies.
+			bool try_inline(
+				Function& src, uint8_t* prev, uint8_t* call, uint8_t* next,
+				local_t base, std::map<iaddr_t, int>& labels, int handler
+			) {
+				if (static_cast<int>(stack.size()) > budget.max_depth)
+					return false;
+				uint8_t* q = call + 1;
+				local_t dst = read<local_t>(q);
+				local_t func_reg = read<local_t>(q);
+				uint8_t args_sz = read<uint8_t>(q);
+				uint8_t kwargs_sz = read<uint8_t>(q);
+				read<callsite_t*>(q);
+				std::vector<local_t> args;
+				for (int i = 0; i < args_sz; i++)
+					args.push_back(read<local_t>(q));
+				std::vector<std::pair<const char*, local_t>> kwargs;
+				for (int i = 0; i < kwargs_sz; i++) {
+					const char* k = (char*)q;
+					while (*q++);
+					kwargs.push_back({ k, read<local_t>(q) });
+				}
+
+				PyObject* target = nullptr;
+				q = prev + 1;
+				local_t load_dst = read<local_t>(q);
+				if (load_dst != func_reg)
+					return false;
+				if (*prev == InsnTag::LoadGlobal) {
+					target = PyDict_GetItemString(src.globals_ns.borrow(), (char*)q);
+				}
+				else if (*prev == InsnTag::LoadClosure && !(src.deref_ns == Py_None)) {
+					local_t closure = read<local_t>(q);
+					target = PyCell_GET(PyTuple_GET_ITEM(src.deref_ns.borrow(), closure));
+				}
+				InlineCallee callee;
+				if (!target || !resolver(target, callee))
+					return false;
+
+				Function& func = *callee.func;
+				const size_t size = func.bytecode().size();
+				if (std::find(stack.begin(), stack.end(), &func) != stack.end())
+					return false;
+				if (func.globals_ns.borrow() != root.globals_ns.borrow() || !(func.deref_ns == Py_None) || !func.free_cells.empty() || func.varargs || func.varkw)
+					return false;
+				if (size > budget.max_callee_size || growth + size > budget.max_growth)
+					return false;
+				if (root.locals.size() + func.locals.size() >= INT16_MAX - 2)
+					return false;
+
+				const auto& defaults = *callee.defaults;
+				if (args.size() > defaults.size())
+					return false;
+				std::vector<local_t> bound(defaults.size(), 0);
+				std::copy(args.begin(), args.end(), bound.begin());
+				for (const auto& kwarg : kwargs) {
+					auto it = callee.argid_lookup->find(kwarg.first);
+					if (it == callee.argid_lookup->end() || bound[it->second])
+						return false;
+					bound[it->second] = kwarg.second;
+				}
+				for (size_t i = 0; i < bound.size(); i++) {
+					if (!bound[i] && !defaults[i])
+						return false;
+				}
+
+				const local_t callee_base = static_cast<local_t>(root.locals.size());
+				const std::string prefix = "_yapyjit_inl" + std::to_string(sites) + "_";
+				for (const auto& local : func.locals)
+					root.locals[prefix + local.first] = callee_base + local.second;
+				++sites;
+				growth += size;
+
+				const int slow = new_label(), release = new_label(), done = new_label();
+				emit(guard_is_ins(func_reg + base, ManagedPyo(target, true)), handler);
+				target_last(slow);
+				for (size_t i = 0; i < bound.size(); i++) {
+					const local_t param = callee_base + static_cast<local_t>(i) + 1;
+					if (bound[i])
+						emit(move_ins(param, bound[i] + base), handler);
+					else
+						emit(constant_ins(param, ManagedPyo(defaults[i], true)), handler);
+				}
+				// Each call starts with unbound locals, as in a new frame, even if the last one raised.
+				for (const auto& local : func.locals) {
+					if (local.second > static_cast<local_t>(bound.size()))
+						emit(constant_ins(callee_base + local.second, ManagedPyo(Py_None, true)), handler);
+				}
+				std::map<iaddr_t, int> callee_labels;
+				stack.push_back(&func);
+				expand(func, callee_base, callee_labels, dst + base, release, handler);
+				stack.pop_back();
+				// Releases the locals on return, as the frame would.
+				bind(release);
+				for (const auto& local : func.locals)
+					emit(constant_ins(callee_base + local.second, ManagedPyo(Py_None, true)), handler);
+				emit(jump_ins(), handler);
+				target_last(done);
+				bind(slow);
+				copy(call, next, base, labels, handler);
+				bind(done);
+				return true;
+			}
+		};
+	}
+
+	int inline_calls(Function& caller, inline_resolver_t resolver, const InlineBudget& budget) {
+		Rewriter rw(caller, resolver, budget);
+		std::map<iaddr_t, int> labels;
+		rw.expand(caller, 0, labels, 0, -1, -1);
+		if (rw.sites == 0)
+			return 0;
+
+		for (const auto& fixup : rw.fixups)
+			*reinterpret_cast<iaddr_t*>(rw.code.data() + fixup.first) = rw.label_addr[fixup.second];
+
+		std::vector<iaddr_t> exctable_key{ 0 }, exctable_val{ L_PLACEHOLDER };
+		for (const auto& handler : rw.handlers) {
+			const iaddr_t val = handler.second < 0 ? L_PLACEHOLDER : rw.label_addr[handler.second];
+			if (val == exctable_val.back())
+				continue;
+			if (exctable_key.back() == handler.first) {
+				exctable_val.back() = val;
+			}
+			else {
+				exctable_key.push_back(handler.first);
+				exctable_val.push_back(val);
+			}
+		}
+
+		for (const auto& site : caller.icache_sites)
+			rw.icache_sites.push_back({ rw.label_addr[labels.at(site.first)], site.second });
+		std::sort(rw.icache_sites.begin(), rw.icache_sites.end());
+
+		caller.bytecode().swap(rw.code);
+		caller.exctable_key.swap(exctable_key);
+		caller.exctable_val.swap(exctable_val);
+		caller.icache_sites.swap(rw.icache_sites);
+		caller.profile.reset();  // Offsets of the old bytecode.
+		return rw.sites;
+	}
+};
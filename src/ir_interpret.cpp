@@ -1,15 +1,23 @@
 #include <ir_interpret_base.h>
 #include <ir_interpret_trace.h>
+#include <yapyjit.h>
 
 namespace yapyjit
 {
-	PyObject* ir_interpret(uint8_t* p, std::vector<PyObject*> locals, Function& func)
+	PyObject* ir_interpret(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame, RuntimeStats* stats)
 	{
-		return ir_interpret_base<false>(p, locals, func);
+		return ir_interpret_base<false>(p, locals, func, frame, stats);
 	}
-	PyObject* ir_trace(uint8_t* p, std::vector<PyObject*> locals, Function& func)
+	PyObject* ir_trace(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame, RuntimeStats* stats)
 	{
-		return ir_interpret_base<true>(p, locals, func);
+		return ir_interpret_base<true>(p, locals, func, frame, stats);
+	}
+	PyObject* ir_profile(uint8_t* p, std::vector<PyObject*>& locals, Function& func, GenFrame* frame, RuntimeStats* stats)
+	{
+		return ir_interpret_base<false, true>(p, locals, func, frame, stats);
+	}
+	std::list<Tracer*>& ir_trace_chain()
+	{
+		return context().trace_chain;
 	}
-	std::list<Tracer*> ir_trace_chain;
 }
@@ -1,5 +1,6 @@
 #include <sstream>
 #include <ir.h>
+#include <ir_builtins.h>
 
 #define READ(t) (*(t*)p); p += sizeof(t)
 #define LOCAL() READ(local_t)
@@ -22,6 +23,19 @@
     case InsnTag::BitXor: goto BitXor; \
     case InsnTag::BitAnd: goto BitAnd; \
     case InsnTag::FloorDiv: goto FloorDiv; \
+    case InsnTag::InplaceAdd: goto InplaceAdd; \
+    case InsnTag::InplaceSub: goto InplaceSub; \
+    case InsnTag::InplaceMult: goto InplaceMult; \
+    case InsnTag::InplaceMatMult: goto InplaceMatMult; \
+    case InsnTag::InplaceDiv: goto InplaceDiv; \
+    case InsnTag::InplaceMod: goto InplaceMod; \
+    case InsnTag::InplacePow: goto InplacePow; \
+    case InsnTag::InplaceLShift: goto InplaceLShift; \
+    case InsnTag::InplaceRShift: goto InplaceRShift; \
+    case InsnTag::InplaceBitOr: goto InplaceBitOr; \
+    case InsnTag::InplaceBitXor: goto InplaceBitXor; \
+    case InsnTag::InplaceBitAnd: goto InplaceBitAnd; \
+    case InsnTag::InplaceFloorDiv: goto InplaceFloorDiv; \
     case InsnTag::Invert: goto Invert; \
     case InsnTag::Not: goto Not; \
     case InsnTag::UAdd: goto UAdd; \
@@ -42,26 +56,40 @@
     case InsnTag::DelItem: goto DelItem; \
     case InsnTag::ErrorProp: goto ErrorProp; \
     case InsnTag::ClearErrorCtx: goto ClearErrorCtx; \
+    case InsnTag::GetIter: goto GetIter; \
     case InsnTag::IterNext: goto IterNext; \
     case InsnTag::Jump: goto Jump; \
     case InsnTag::JumpTruthy: goto JumpTruthy; \
     case InsnTag::LoadAttr: goto LoadAttr; \
+    case InsnTag::LoadMethod: goto LoadMethod; \
     case InsnTag::LoadClosure: goto LoadClosure; \
+    case InsnTag::LoadCell: goto LoadCell; \
     case InsnTag::LoadGlobal: goto LoadGlobal; \
     case InsnTag::LoadItem: goto LoadItem; \
     case InsnTag::Move: goto Move; \
     case InsnTag::Raise: goto Raise; \
     case InsnTag::Return: goto Return; \
+    case InsnTag::Yield: goto Yield; \
     case InsnTag::StoreAttr: goto StoreAttr; \
     case InsnTag::StoreClosure: goto StoreClosure; \
+    case InsnTag::StoreCell: goto StoreCell; \
     case InsnTag::StoreGlobal: goto StoreGlobal; \
     case InsnTag::StoreItem: goto StoreItem; \
+    case InsnTag::ListAppend: goto ListAppend; \
+    case InsnTag::SetAdd: goto SetAdd; \
+    case InsnTag::MapAdd: goto MapAdd; \
     case InsnTag::BuildDict: goto BuildDict; \
     case InsnTag::BuildList: goto BuildList; \
     case InsnTag::BuildSet: goto BuildSet; \
     case InsnTag::BuildTuple: goto BuildTuple; \
     case InsnTag::Call: goto Call; \
+    case InsnTag::CallEx: goto CallEx; \
+    case InsnTag::CallForward: goto CallForward; \
+    case InsnTag::CallMethod: goto CallMethod; \
+    case InsnTag::CallBuiltin: goto CallBuiltin; \
     case InsnTag::Destruct: goto Destruct; \
+    case InsnTag::MakeFunction: goto MakeFunction; \
+    case InsnTag::GuardIs: goto GuardIs; \
     case InsnTag::Prolog: goto Prolog; \
     case InsnTag::Epilog: goto Epilog; \
     case InsnTag::TraceHead: goto TraceHead; \
@@ -69,6 +97,12 @@
 } while (0)
 
 #define COMMON_DECODE do { \
+    if (profile) \
+    { \
+        ss << profile->counts[p - 1 - start] << '\t'; \
+        if (!profile->cycles.empty()) \
+            ss << profile->cycles[p - 1 - start] << '\t'; \
+    } \
     ss << (p - 1 - start) << '\t' << InsnTag::_from_integral(next_insn_tag)._to_string() << ' '; \
 } while (0)
 
@@ -92,6 +126,9 @@ inline void _common_arg(std::stringstream& ss, T arg)
 #define GROUP_BINOP_EXEC do { \
 } while (0)
     
+#define GROUP_INPLACEOP_EXEC do { \
+} while (0)
+    
 #define GROUP_UNARYOP_EXEC do { \
 } while (0)
     
@@ -102,7 +139,7 @@ inline void _common_arg(std::stringstream& ss, T arg)
 } while (0)
 
 namespace yapyjit {
-    std::string ir_pprint(uint8_t* p) {
+    std::string ir_pprint(uint8_t* p, const InsnProfile* profile) {
         std::stringstream ss;
         uint8_t* start = p;
         uint8_t next_insn_tag;
@@ -113,9 +150,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -127,9 +166,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -141,9 +182,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -155,9 +198,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -169,9 +214,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -183,9 +230,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -197,9 +246,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -211,9 +262,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -225,9 +278,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -239,9 +294,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -253,9 +310,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -267,9 +326,11 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
@@ -281,15 +342,237 @@ namespace yapyjit {
             local_t dst = READ(local_t);
             local_t left = READ(local_t);
             local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
             COMMON_ARG(dst);
             COMMON_ARG(left);
             COMMON_ARG(right);
+            COMMON_ARG(cache);
             LP3_FETCH();
             COMMON_EXEC;
             GROUP_BINOP_EXEC;
             
             LP3_DISPATCH();
         }
+        InplaceAdd: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceSub: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceMult: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceMatMult: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceDiv: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceMod: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplacePow: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceLShift: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceRShift: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceBitOr: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceBitXor: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceBitAnd: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
+
+        InplaceFloorDiv: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t left = READ(local_t);
+            local_t right = READ(local_t);
+            icache_t<2>* cache = READ(icache_t<2>*);
+            COMMON_ARG(dst);
+            COMMON_ARG(left);
+            COMMON_ARG(right);
+            COMMON_ARG(cache);
+            LP3_FETCH();
+            COMMON_EXEC;
+            GROUP_INPLACEOP_EXEC;
+            
+            LP3_DISPATCH();
+        }
         Invert: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -538,6 +821,17 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        GetIter: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         IterNext: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -584,6 +878,21 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        LoadMethod: {
+            COMMON_DECODE;
+            local_t meth = READ(local_t);
+            local_t self = READ(local_t);
+            local_t obj = READ(local_t);
+            PyObject* name = READ(PyObject*);
+            COMMON_ARG(meth);
+            COMMON_ARG(self);
+            COMMON_ARG(obj);
+            COMMON_ARG(name);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         LoadClosure: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -595,6 +904,19 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        LoadCell: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t cell = READ(local_t);
+            char* name = CSTR();
+            COMMON_ARG(dst);
+            COMMON_ARG(cell);
+            COMMON_ARG(name);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         LoadGlobal: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -648,6 +970,15 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        Yield: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         StoreAttr: {
             COMMON_DECODE;
             local_t obj = READ(local_t);
@@ -672,6 +1003,17 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        StoreCell: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            local_t cell = READ(local_t);
+            COMMON_ARG(src);
+            COMMON_ARG(cell);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         StoreGlobal: {
             COMMON_DECODE;
             local_t src = READ(local_t);
@@ -696,6 +1038,41 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        ListAppend: {
+            COMMON_DECODE;
+            local_t list = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(list);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        SetAdd: {
+            COMMON_DECODE;
+            local_t set = READ(local_t);
+            local_t src = READ(local_t);
+            COMMON_ARG(set);
+            COMMON_ARG(src);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        MapAdd: {
+            COMMON_DECODE;
+            local_t map = READ(local_t);
+            local_t key = READ(local_t);
+            local_t value = READ(local_t);
+            COMMON_ARG(map);
+            COMMON_ARG(key);
+            COMMON_ARG(value);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
         BuildDict: {
             COMMON_DECODE;
             local_t dst = READ(local_t);
@@ -762,6 +1139,7 @@ namespace yapyjit {
             local_t func = READ(local_t);
             uint8_t args_sz = READ(uint8_t);
             uint8_t kwargs_sz = READ(uint8_t);
+            callsite_t* site = READ(callsite_t*);
             COMMON_ARG(dst);
             COMMON_ARG(func);
             for (int i = 0; i < args_sz; i++) {
@@ -773,6 +1151,81 @@ namespace yapyjit {
                 COMMON_ARG(k);
                 COMMON_ARG(v);
             }
+            COMMON_ARG(site);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        CallEx: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t func = READ(local_t);
+            local_t args = READ(local_t);
+            local_t kwargs = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(func);
+            COMMON_ARG(args);
+            COMMON_ARG(kwargs);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        CallForward: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t func = READ(local_t);
+            local_t args = READ(local_t);
+            local_t kwnames = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(func);
+            COMMON_ARG(args);
+            COMMON_ARG(kwnames);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        CallMethod: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            local_t meth = READ(local_t);
+            uint8_t args_sz = READ(uint8_t);
+            uint8_t kwargs_sz = READ(uint8_t);
+            callsite_t* site = READ(callsite_t*);
+            COMMON_ARG(dst);
+            COMMON_ARG(meth);
+            for (int i = 0; i < args_sz; i++) {
+                local_t v = LOCAL();
+                COMMON_ARG(v);
+            }
+            for (int i = 0; i < kwargs_sz; i++) {
+                char* k = CSTR(); local_t v = LOCAL();
+                COMMON_ARG(k);
+                COMMON_ARG(v);
+            }
+            COMMON_ARG(site);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        CallBuiltin: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            uint8_t builtin = READ(uint8_t);
+            PyObject* name = READ(PyObject*);
+            PyObject* expected = READ(PyObject*);
+            uint8_t args_sz = READ(uint8_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(BuiltinId::_from_integral(builtin)._to_string());
+            COMMON_ARG(name);
+            COMMON_ARG(expected);
+            for (int i = 0; i < args_sz; i++) {
+                local_t v = LOCAL();
+                COMMON_ARG(v);
+            }
             LP3_FETCH();
             COMMON_EXEC;
             
@@ -792,6 +1245,36 @@ namespace yapyjit {
             
             LP3_DISPATCH();
         }
+        MakeFunction: {
+            COMMON_DECODE;
+            local_t dst = READ(local_t);
+            PyObject* proto = READ(PyObject*);
+            local_t defaults = READ(local_t);
+            local_t kwdefaults = READ(local_t);
+            local_t closure = READ(local_t);
+            COMMON_ARG(dst);
+            COMMON_ARG(proto);
+            COMMON_ARG(defaults);
+            COMMON_ARG(kwdefaults);
+            COMMON_ARG(closure);
+            LP3_FETCH();
+            COMMON_EXEC;
+            
+            LP3_DISPATCH();
+        }
+        GuardIs: {
+            COMMON_DECODE;
+            local_t src = READ(local_t);
+            PyObject* expected = READ(PyObject*);
+            iaddr_t fail_to = READ(iaddr_t);
+            COMMON_ARG(src);
+            COMMON_ARG(expected);
+            COMMON_ARG(fail_to);
+            LP3_FETCH();
+            COMMON_EXEC;
+
+            LP3_DISPATCH();
+        }
         Prolog: {
             COMMON_DECODE;
             LP3_FETCH();
@@ -0,0 +1,112 @@
+#include <set>
+#include <ir_refcount.h>
+#include <ir_walker.h>
+
+namespace yapyjit {
+	namespace {
+		// Removes the instructions at addresses in `dropped`, which must not be jump targets.
+		void compact(Function& func, const std::set<iaddr_t>& dropped) {
+			auto& bytecode = func.bytecode();
+			uint8_t* start = bytecode.data();
+			uint8_t* end = start + bytecode.size();
+			std::vector<uint8_t> code;
+			std::map<iaddr_t, iaddr_t> new_addr;
+			for (uint8_t* p = start; p < end;) {
+				uint8_t* next = walk_insn(p, [](OperandKind, uint8_t*) {});
+				const iaddr_t addr = static_cast<iaddr_t>(p - start);
+				new_addr[addr] = static_cast<iaddr_t>(code.size());
+				if (!dropped.count(addr))
+					code.insert(code.end(), p, next);
+				p = next;
+			}
+			new_addr[static_cast<iaddr_t>(bytecode.size())] = static_cast<iaddr_t>(code.size());
+
+			for (uint8_t* p = code.data(); p < code.data() + code.size();) {
+				p = walk_insn(p, [&](OperandKind kind, uint8_t* operand) {
+					if (kind == OperandKind::IAddr) {
+						auto& target = *reinterpret_cast<iaddr_t*>(operand);
+						target = new_addr.at(target);
+					}
+				});
+			}
+
+			std::vector<iaddr_t> exctable_key, exctable_val;
+			for (size_t i = 0; i < func.exctable_key.size(); i++) {
+				const iaddr_t key = new_addr.at(func.exctable_key[i]);
+				const iaddr_t val = func.exctable_val[i] == L_PLACEHOLDER ? L_PLACEHOLDER : new_addr.at(func.exctable_val[i]);
+				if (!exctable_key.empty() && exctable_key.back() == key) {
+					exctable_val.back() = val;
+				}
+				else {
+					exctable_key.push_back(key);
+					exctable_val.push_back(val);
+				}
+			}
+			for (auto& site : func.icache_sites)
+				site.first = new_addr.at(site.first);
+
+			bytecode.swap(code);
+			func.exctable_key.swap(exctable_key);
+			func.exctable_val.swap(exctable_val);
+		}
+	}
+
+	int elide_refcounts(Function& func) {
+		uint8_t* start = func.bytecode().data();
+		uint8_t* end = start + func.bytecode().size();
+		std::vector<int> defs(func.locals.size() + 1), uses(func.locals.size() + 1);
+		std::set<iaddr_t> targets(func.exctable_val.begin(), func.exctable_val.end());
+		std::vector<uint8_t*> insns;
+		for (uint8_t* p = start; p < end;) {
+			insns.push_back(p);
+			p = walk_insn(p, [&](OperandKind kind, uint8_t* operand) {
+				if (kind == OperandKind::Local || kind == OperandKind::DefLocal) {
+					const local_t l = *reinterpret_cast<local_t*>(operand);
+					if (l > 0)
+						(kind == OperandKind::Local ? uses : defs)[l]++;
+				}
+				else if (kind == OperandKind::IAddr)
+					targets.insert(*reinterpret_cast<iaddr_t*>(operand));
+			});
+		}
+
+		std::set<iaddr_t> dropped;
+		uint8_t* prev = nullptr;
+		for (uint8_t* p : insns) {
+			const iaddr_t addr = static_cast<iaddr_t>(p - start);
+			if (prev && *p == InsnTag::Move && !targets.count(addr)) {
+				const local_t dst = *reinterpret_cast<local_t*>(p + 1);
+				const local_t src = *reinterpret_cast<local_t*>(p + 1 + sizeof(local_t));
+				local_t* def = nullptr;
+				if (*prev != InsnTag::Destruct && defs[src] == 1 && uses[src] == 1)
+					walk_insn(prev, [&](OperandKind kind, uint8_t* operand) {
+						if (kind == OperandKind::DefLocal)
+							def = reinterpret_cast<local_t*>(operand);
+					});
+				if (def && *def == src) {
+					*def = dst;
+					dropped.insert(addr);
+					continue;
+				}
+			}
+			prev = p;
+		}
+		int unboxed = 0;
+		for (uint8_t* p : insns) {
+			if (*p != InsnTag::IterNext)
+				continue;
+			auto& dst = *reinterpret_cast<local_t*>(p + 1);
+			if (dst > 0 && !uses[dst]) {
+				dst = -1;
+				unboxed++;
+			}
+		}
+		if (!dropped.empty())
+			compact(func, dropped);
+
+		func.nborrowed = 0;
+		while (!func.generator && func.nborrowed < func.nargs && !defs[func.nborrowed + 1])
+			func.nborrowed++;
+		return static_cast<int>(dropped.size() + unboxed + func.nborrowed) * 2;
+	}
+};
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <perf_map.h>
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#define PERF_MAP_STUBS 1
+#endif
+
+namespace yapyjit {
+	// push rbp; mov rbp, rsp; movabs rax, <ir_interpret>; call rax; pop rbp; ret
+	// Arguments stay in their registers, and the frame pointer keeps the chain walkable.
+	static const uint8_t stub_code[] = {
+		0x55, 0x48, 0x89, 0xe5, 0x48, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xd0, 0x5d, 0xc3
+	};
+	static constexpr size_t stub_target = 6;  // Offset of the address in `stub_code`.
+	static constexpr size_t stub_size = 32;
+
+	// Records of the jitdump format, see tools/perf/Documentation/jitdump-specification.txt of Linux.
+	struct JitdumpHeader {
+		uint32_t magic, version, total_size, elf_mach, pad1, pid;
+		uint64_t timestamp, flags;
+	};
+	struct JitdumpRecord {
+		uint32_t id, total_size;
+		uint64_t timestamp;
+	};
+	enum : uint32_t { JIT_CODE_LOAD = 0, JIT_CODE_DEBUG_INFO = 2, JIT_CODE_CLOSE = 3 };
+
+	// Stubs are all the same code, so pages are filled once and never written again.
+	static struct {
+		std::mutex lock;
+		bool enabled = false;
+		std::vector<uint8_t*> free_stubs;
+		std::map<uint8_t*, std::string> names;  // Stubs in use.
+		FILE* jitdump = nullptr;
+		void* jitdump_marker = nullptr;  // Executable mapping of the dump, how `perf record` finds it.
+		uint64_t code_index = 0;
+	} perf_map;
+
+	static void perf_map_write(const char* mode, uint8_t* only = nullptr) {
+#ifdef PERF_MAP_STUBS
+		auto path = "/tmp/perf-" + std::to_string((long long)getpid()) + ".map";
+		FILE* file = fopen(path.c_str(), mode);
+		if (!file)
+			return;
+		for (const auto& entry : perf_map.names)
+			if (!only || entry.first == only)
+				fprintf(file, "%" PRIxPTR " %zx %s\n", (uintptr_t)entry.first, sizeof(stub_code), entry.second.c_str());
+		fclose(file);
+#endif
+	}
+
+#ifdef PERF_MAP_STUBS
+	// Time stamps of `perf record -k mono`.
+	static uint64_t jitdump_time() {
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	static void jitdump_write(const void* data, size_t size) {
+		fwrite(data, 1, size, perf_map.jitdump);
+	}
+
+	// The stub is the only native code of the function, so its debug info is the line of the `def`.
+	static void jitdump_load(uint8_t* stub, const std::string& name, const std::string& filename, int line) {
+		auto now = jitdump_time();
+		if (!filename.empty()) {
+			JitdumpRecord record = {
+				JIT_CODE_DEBUG_INFO,
+				(uint32_t)(sizeof(JitdumpRecord) + 2 * sizeof(uint64_t) + sizeof(uint64_t) + 2 * sizeof(uint32_t) + filename.size() + 1),
+				now
+			};
+			uint64_t code_addr = (uintptr_t)stub, nr_entry = 1;
+			uint32_t lineno = (uint32_t)line, discrim = 0;
+			jitdump_write(&record, sizeof(record));
+			jitdump_write(&code_addr, sizeof(code_addr));
+			jitdump_write(&nr_entry, sizeof(nr_entry));
+			jitdump_write(&code_addr, sizeof(code_addr));
+			jitdump_write(&lineno, sizeof(lineno));
+			jitdump_write(&discrim, sizeof(discrim));
+			jitdump_write(filename.c_str(), filename.size() + 1);
+		}
+		JitdumpRecord record = {
+			JIT_CODE_LOAD,
+			(uint32_t)(sizeof(JitdumpRecord) + 2 * sizeof(uint32_t) + 4 * sizeof(uint64_t) + name.size() + 1 + sizeof(stub_code)),
+			now
+		};
+		uint32_t ids[2] = { (uint32_t)getpid(), (uint32_t)syscall(SYS_gettid) };
+		uint64_t fields[4] = { (uintptr_t)stub, (uintptr_t)stub, sizeof(stub_code), perf_map.code_index++ };
+		jitdump_write(&record, sizeof(record));
+		jitdump_write(ids, sizeof(ids));
+		jitdump_write(fields, sizeof(fields));
+		jitdump_write(name.c_str(), name.size() + 1);
+		jitdump_write(stub, sizeof(stub_code));
+		fflush(perf_map.jitdump);
+	}
+#endif
+
+	static uint8_t* perf_map_new_stub() {
+#ifdef PERF_MAP_STUBS
+		if (perf_map.free_stubs.empty()) {
+			size_t size = (size_t)sysconf(_SC_PAGESIZE);
+			void* page = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (page == MAP_FAILED)
+				return nullptr;
+			uint8_t code[sizeof(stub_code)];
+			std::copy(stub_code, stub_code + sizeof(stub_code), code);
+			auto target = (uint64_t)(uintptr_t)&ir_interpret;
+			for (int i = 0; i < 8; i++)
+				code[stub_target + i] = (uint8_t)(target >> (8 * i));
+			auto stubs = (uint8_t*)page;
+			for (size_t offset = 0; offset + stub_size <= size; offset += stub_size) {
+				std::fill(stubs + offset, stubs + offset + stub_size, 0xcc);
+				std::copy(code, code + sizeof(code), stubs + offset);
+			}
+			if (mprotect(page, size, PROT_READ | PROT_EXEC) != 0) {
+				munmap(page, size);
+				return nullptr;
+			}
+			for (size_t offset = size / stub_size * stub_size; offset > 0; offset -= stub_size)
+				perf_map.free_stubs.push_back(stubs + offset - stub_size);
+		}
+		auto stub = perf_map.free_stubs.back();
+		perf_map.free_stubs.pop_back();
+		return stub;
+#else
+		return nullptr;
+#endif
+	}
+
+	bool perf_map_supported() {
+#ifdef PERF_MAP_STUBS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	bool perf_map_enabled() {
+		std::lock_guard<std::mutex> guard(perf_map.lock);
+		return perf_map.enabled || perf_map.jitdump;
+	}
+
+	void set_perf_map(bool enabled) {
+		if (enabled && !perf_map_supported())
+			throw std::runtime_error("perf maps are only supported on Linux x86-64.");
+		std::lock_guard<std::mutex> guard(perf_map.lock);
+		if (enabled && !perf_map.enabled)
+			perf_map_write("w");
+		perf_map.enabled = enabled;
+	}
+
+	void set_jitdump(bool enabled) {
+		if (enabled && !perf_map_supported())
+			throw std::runtime_error("jitdump is only supported on Linux x86-64.");
+#ifdef PERF_MAP_STUBS
+		std::lock_guard<std::mutex> guard(perf_map.lock);
+		if (enabled == (perf_map.jitdump != nullptr))
+			return;
+		size_t size = (size_t)sysconf(_SC_PAGESIZE);
+		if (!enabled) {
+			JitdumpRecord record = { JIT_CODE_CLOSE, sizeof(JitdumpRecord), jitdump_time() };
+			jitdump_write(&record, sizeof(record));
+			munmap(perf_map.jitdump_marker, size);
+			fclose(perf_map.jitdump);
+			perf_map.jitdump = nullptr;
+			return;
+		}
+		auto path = "/tmp/jit-" + std::to_string((long long)getpid()) + ".dump";
+		FILE* file = fopen(path.c_str(), "w+");
+		if (!file)
+			throw std::runtime_error("cannot create " + path + ".");
+		JitdumpHeader header = {
+			0x4A695444, 1, sizeof(JitdumpHeader), 62 /* EM_X86_64 */, 0, (uint32_t)getpid(), jitdump_time(), 0
+		};
+		fwrite(&header, sizeof(header), 1, file);
+		fflush(file);
+		void* marker = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(file), 0);
+		if (marker == MAP_FAILED) {
+			fclose(file);
+			throw std::runtime_error("cannot map " + path + ".");
+		}
+		perf_map.jitdump = file;
+		perf_map.jitdump_marker = marker;
+#endif
+	}
+
+	void perf_map_attach(Function& func, const std::string& name, const std::string& filename, int line) {
+		std::lock_guard<std::mutex> guard(perf_map.lock);
+		if (!(perf_map.enabled || perf_map.jitdump) || func.interpret != ir_interpret)
+			return;
+		auto stub = perf_map_new_stub();
+		if (!stub)
+			return;
+		auto& entry = perf_map.names[stub];
+		for (char c : name)
+			entry.push_back(c == '\n' ? ' ' : c);
+		func.interpret = reinterpret_cast<interpret_t>(stub);
+		if (perf_map.enabled)
+			perf_map_write("a", stub);
+#ifdef PERF_MAP_STUBS
+		if (perf_map.jitdump)
+			jitdump_load(stub, entry, filename, line);
+#endif
+	}
+
+	void perf_map_detach(Function& func) {
+		if (func.interpret == ir_interpret)
+			return;
+		std::lock_guard<std::mutex> guard(perf_map.lock);
+		auto stub = reinterpret_cast<uint8_t*>(func.interpret);
+		func.interpret = ir_interpret;
+		perf_map.names.erase(stub);
+		perf_map.free_stubs.push_back(stub);
+		// The map has no removal, so it is written again with the entries left.
+		// A stub reused later is loaded again in the jitdump, which replaces the earlier code.
+		if (perf_map.enabled)
+			perf_map_write("w");
+	}
+};
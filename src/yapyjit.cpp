@@ -4,11 +4,75 @@
 #include <cmath>
 #include <sstream>
 #include <yapyjit.h>
+#include <perf_map.h>
 #include <exc_helper.h>
 using namespace yapyjit;
 
-PyObject* module_ref;
-bool yapyjit::force_trace_p = false;
+// Name of the capsule holding the `Context` in the interpreter dict.
+static const char context_key[] = "yapyjit.context";
+
+// `PyInterpreterState_Get` is public from 3.9 only.
+static PyInterpreterState* current_interpreter() {
+#if PY_VERSION_HEX >= 0x03090000
+    return PyInterpreterState_Get();
+#else
+    return _PyInterpreterState_Get();
+#endif
+}
+
+// State of each module object, the context of its interpreter.
+struct ModuleState {
+    PyObject* context;
+};
+
+static Context& module_context(PyObject* module) {
+    auto state = (ModuleState*)PyModule_GetState(module);
+    return *(Context*)PyCapsule_GetPointer(state->context, context_key);
+}
+
+Context::~Context() {
+    Py_XDECREF(jit_entrance_type);
+    Py_XDECREF(generator_code_type);
+    Py_XDECREF(generator_type);
+    Py_XDECREF(range_counter_type);
+    Py_XDECREF(kwnames);
+    for (auto& entry : ast_types) {
+        Py_XDECREF(entry.second.fields);
+        Py_DECREF(entry.first);
+    }
+    for (auto& entry : strings)
+        Py_DECREF(entry.second);
+}
+
+PyObject* Context::intern(const std::string& name) {
+    auto it = strings.find(name);
+    if (it != strings.end())
+        return it->second;
+    auto s = PyUnicode_InternFromString(name.c_str());
+    if (s)
+        strings.emplace(name, s);
+    return s;
+}
+
+static void context_free(PyObject* capsule) {
+    delete (Context*)PyCapsule_GetPointer(capsule, context_key);
+}
+
+Context& yapyjit::context() {
+    // Interpreter ids are never reused, and the context lives as long as its interpreter.
+    thread_local int64_t cached_id = -1;
+    thread_local Context* cached = nullptr;
+    auto interp = current_interpreter();
+    auto id = PyInterpreterState_GetID(interp);
+    if (id != cached_id) {
+        auto capsule = PyDict_GetItemString(PyInterpreterState_GetDict(interp), context_key);
+        if (!capsule)
+            throw std::logic_error("yapyjit is not initialized in this interpreter.");
+        cached = (Context*)PyCapsule_GetPointer(capsule, context_key);
+        cached_id = id;
+    }
+    return *cached;
+}
 
 PyDoc_STRVAR(yapyjit_get_ir_doc, "get_ir(func)\
 \
@@ -23,7 +87,9 @@ PyObject* yapyjit_ir(PyObject* self, PyObject* args) {
         return NULL;
     }
 
-    auto ir = yapyjit::get_ir(yapyjit::get_py_ast(pyfunc), ManagedPyo(pyfunc, true));
+    auto ir = yapyjit::get_ir(ManagedPyo(pyfunc, true), module_context(self).frontend);
+    // The returned bytes still point to the constants.
+    ir->owns_constants = false;
 
     return PyBytes_FromStringAndSize(
         reinterpret_cast<char*>(ir->bytecode().data()),
@@ -31,22 +97,41 @@ PyObject* yapyjit_ir(PyObject* self, PyObject* args) {
     );
 }
 
-PyDoc_STRVAR(yapyjit_ir_pprint_doc, "pprint_ir(ir_bytes)\
+extern std::shared_ptr<Function> jit_compiled(PyObject* obj);
+
+PyDoc_STRVAR(yapyjit_ir_pprint_doc, "pprint_ir(ir_bytes, annotate=False)\
 \
-Pretty-print IR bytecode. Returns a string.");
+Pretty-print IR bytecode. Returns a string. ir_bytes may also be a jitted function,\
+whose compiled code is printed. If annotate, each instruction of it is preceded by its\
+count and, if timed, its cycles in yapyjit.set_profile.");
 
 PyObject* yapyjit_ir_pprint(PyObject* self, PyObject* args) {
     PyObject* ir_bytes = NULL;
+    int annotate = 0;
 
     /* Parse positional and keyword arguments */
-    if (!PyArg_ParseTuple(args, "O", &ir_bytes)) {
+    if (!PyArg_ParseTuple(args, "O|p", &ir_bytes, &annotate)) {
         return NULL;
     }
-    if (!PyBytes_Check(ir_bytes)) {
-        throw std::logic_error("ir_bytes should be a bytes object.");
+    if (PyBytes_Check(ir_bytes)) {
+        if (annotate) {
+            throw std::logic_error("annotate needs a jitted function, not bytes.");
+        }
+        auto ir = yapyjit::ir_pprint((uint8_t*)PyBytes_AS_STRING(ir_bytes));
+        return PyUnicode_FromString(ir.c_str());
     }
-
-    auto ir = yapyjit::ir_pprint((uint8_t*)PyBytes_AS_STRING(ir_bytes));
+    auto func = jit_compiled(ir_bytes);
+    if (!func) {
+        throw std::logic_error("ir_bytes should be a bytes object or a compiled jitted function.");
+    }
+    // Not profiled yet, all counts are zero.
+    InsnProfile empty;
+    empty.counts.assign(func->bytecode().size(), 0);
+    const InsnProfile* profile = nullptr;
+    if (annotate) {
+        profile = func->profile ? func->profile.get() : &empty;
+    }
+    auto ir = yapyjit::ir_pprint(func->bytecode().data(), profile);
 
     return PyUnicode_FromString(ir.c_str());
 }
@@ -60,7 +145,7 @@ PyObject* yapyjit_jit(PyObject* self, PyObject* args) {
     if (!PyArg_ParseTuple(args, "O", &thearg)) {
         return nullptr;
     }
-    auto jit_entrance_t = ManagedPyo(module_ref, true).attr("JitEntrance");
+    auto jit_entrance_t = ManagedPyo((PyObject*)module_context(self).jit_entrance_type, true);
     if (thearg) {
         if (jit_entrance_t == (PyObject*)Py_TYPE(thearg)) {
             Py_INCREF(thearg);
@@ -155,7 +240,146 @@ PyObject* yapyjit_set_force_trace(PyObject* self, PyObject* args) {
         return NULL;
     }
 
-    yapyjit::force_trace_p = i > 0;
+    module_context(self).force_trace_p = i > 0;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(yapyjit_set_inline_threshold_doc, "set_inline_threshold(n)\
+\
+Inline calls to other jitted functions into a function after it has been called n times. 0 disables inlining.");
+
+PyObject* yapyjit_set_inline_threshold(PyObject* self, PyObject* args) {
+    int n = 0;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "i", &n)) {
+        return NULL;
+    }
+
+    module_context(self).inline_threshold = n;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(yapyjit_set_frontend_doc, "set_frontend(name)\
+\
+Select how functions jitted afterwards are compiled: 'ast' parses the source code,\
+'bytecode' lowers the CPython bytecode and also works for functions without source.");
+
+PyObject* yapyjit_set_frontend(PyObject* self, PyObject* args) {
+    const char* name = nullptr;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "s", &name)) {
+        return NULL;
+    }
+
+    auto source = Frontend::_from_string_nocase_nothrow(name);
+    if (!source) {
+        throw std::invalid_argument(std::string("Unknown front end ") + name + ", expected 'ast' or 'bytecode'.");
+    }
+    module_context(self).frontend = *source;
+    Py_RETURN_NONE;
+}
+
+extern size_t jit_code_usage(Context& ctx);
+extern void enforce_code_budget(Context& ctx);
+extern PyObject* jit_stats(Context& ctx);
+
+PyDoc_STRVAR(yapyjit_set_code_budget_doc, "set_code_budget(nbytes)\
+\
+Limit memory used by compiled code of all jitted functions. Least recently called functions\
+are evicted to be compiled again on their next call. 0 means no limit.");
+
+PyObject* yapyjit_set_code_budget(PyObject* self, PyObject* args) {
+    Py_ssize_t n = 0;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "n", &n)) {
+        return NULL;
+    }
+    if (n < 0) {
+        throw std::invalid_argument("code budget should be non-negative.");
+    }
+
+    auto& ctx = module_context(self);
+    ctx.code_budget = (size_t)n;
+    enforce_code_budget(ctx);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(yapyjit_code_usage_doc, "code_usage()\
+\
+Bytes of memory used by compiled code of all jitted functions.");
+
+PyObject* yapyjit_code_usage(PyObject* self, PyObject* args) {
+    return PyLong_FromSize_t(jit_code_usage(module_context(self)));
+}
+
+PyDoc_STRVAR(yapyjit_stats_doc, "stats()\
+\
+Snapshot of the runtime counters of all jitted functions called so far, as a list of dicts\
+with function, name, calls, instructions, ticks, exceptions, tier_changes and icache_misses,\
+most ticks first.");
+
+PyObject* yapyjit_stats(PyObject* self, PyObject* args) {
+    return jit_stats(module_context(self));
+}
+
+PyDoc_STRVAR(yapyjit_set_profile_doc, "set_profile(flag, cycles=False)\
+\
+Whether to count the instructions executed by jitted functions, for pprint_ir(func, True)\
+and the insn_profile() method of jitted functions. If cycles, the time stamp counter ticks\
+of each instruction are also counted, callees included. Counting starts again from zero\
+for code whose cycles setting changed.");
+
+PyObject* yapyjit_set_profile(PyObject* self, PyObject* args) {
+    int flag = 0;
+    int cycles = 0;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "p|p", &flag, &cycles)) {
+        return NULL;
+    }
+
+    auto& ctx = module_context(self);
+    ctx.profile_p = flag > 0;
+    ctx.profile_cycles = cycles > 0;
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(yapyjit_set_perf_map_doc, "set_perf_map(flag)\
+\
+Whether to list functions compiled afterwards in /tmp/perf-<pid>.map for Linux perf,\
+each under module.qualname until its code is released. Also enabled by the environment\
+variable YAPYJIT_PERF_MAP=1 at import. Only supported on Linux x86-64.");
+
+PyObject* yapyjit_set_perf_map(PyObject* self, PyObject* args) {
+    int flag = 0;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "p", &flag)) {
+        return NULL;
+    }
+
+    yapyjit::set_perf_map(flag > 0);
+    Py_RETURN_NONE;
+}
+
+PyDoc_STRVAR(yapyjit_set_jitdump_doc, "set_jitdump(flag)\
+\
+Whether to write the code of functions compiled afterwards to /tmp/jit-<pid>.dump, with the line\
+of each def as debug info, for perf inject --jit. Needs perf record -k mono. Also enabled by the\
+environment variable YAPYJIT_JITDUMP=1 at import. Only supported on Linux x86-64.");
+
+PyObject* yapyjit_set_jitdump(PyObject* self, PyObject* args) {
+    int flag = 0;
+
+    /* Parse positional and keyword arguments */
+    if (!PyArg_ParseTuple(args, "p", &flag)) {
+        return NULL;
+    }
+
+    yapyjit::set_jitdump(flag > 0);
     Py_RETURN_NONE;
 }
 
@@ -169,23 +393,86 @@ static PyMethodDef yapyjit_functions[] = {
     { "add_tracer", (PyCFunction)yapyjit::guarded<yapyjit_add_tracer>(), METH_VARARGS, yapyjit_add_tracer_doc },
     { "remove_tracer", (PyCFunction)yapyjit::guarded<yapyjit_remove_tracer>(), METH_VARARGS, yapyjit_remove_tracer_doc },
     { "set_force_trace", (PyCFunction)yapyjit::guarded<yapyjit_set_force_trace>(), METH_VARARGS, yapyjit_set_force_trace_doc },
+    { "set_inline_threshold", (PyCFunction)yapyjit::guarded<yapyjit_set_inline_threshold>(), METH_VARARGS, yapyjit_set_inline_threshold_doc },
+    { "set_frontend", (PyCFunction)yapyjit::guarded<yapyjit_set_frontend>(), METH_VARARGS, yapyjit_set_frontend_doc },
+    { "set_code_budget", (PyCFunction)yapyjit::guarded<yapyjit_set_code_budget>(), METH_VARARGS, yapyjit_set_code_budget_doc },
+    { "code_usage", (PyCFunction)yapyjit::guarded<yapyjit_code_usage>(), METH_NOARGS, yapyjit_code_usage_doc },
+    { "stats", (PyCFunction)yapyjit::guarded<yapyjit_stats>(), METH_NOARGS, yapyjit_stats_doc },
+    { "set_profile", (PyCFunction)yapyjit::guarded<yapyjit_set_profile>(), METH_VARARGS, yapyjit_set_profile_doc },
+    { "set_perf_map", (PyCFunction)yapyjit::guarded<yapyjit_set_perf_map>(), METH_VARARGS, yapyjit_set_perf_map_doc },
+    { "set_jitdump", (PyCFunction)yapyjit::guarded<yapyjit_set_jitdump>(), METH_VARARGS, yapyjit_set_jitdump_doc },
     { NULL, NULL, 0, NULL } /* marks end of array */
 };
 
-extern int init_jit_entrance(PyObject* m);
+extern int init_jit_entrance(PyObject* m, Context& ctx);
+extern int init_generator(PyObject* m, Context& ctx);
+extern int init_builtins(PyObject* m, Context& ctx);
+
+// The context of the current interpreter, created by the first module imported into it.
+static PyObject* get_context_capsule() {
+    auto dict = PyInterpreterState_GetDict(current_interpreter());
+    if (!dict) {
+        PyErr_SetString(PyExc_RuntimeError, "yapyjit cannot get the interpreter dict.");
+        return nullptr;
+    }
+    auto capsule = PyDict_GetItemString(dict, context_key);
+    if (capsule) {
+        Py_INCREF(capsule);
+        return capsule;
+    }
+    auto ctx = new Context();
+    capsule = PyCapsule_New(ctx, context_key, context_free);
+    if (!capsule) {
+        delete ctx;
+        return nullptr;
+    }
+    // Borrowed, every holder of the context holds a reference to the capsule.
+    ctx->owner = capsule;
+    if (PyDict_SetItemString(dict, context_key, capsule) < 0) {
+        Py_DECREF(capsule);
+        return nullptr;
+    }
+    return capsule;
+}
+
 /*
  * Initialize yapyjit. May be called multiple times, so avoid
  * using static state.
  */
 int exec_yapyjit(PyObject *module) {
-    module_ref = module;
+    auto state = (ModuleState*)PyModule_GetState(module);
+    state->context = get_context_capsule();
+    if (!state->context) {
+        return -1;
+    }
+    auto& ctx = module_context(module);
     PyModule_AddFunctions(module, yapyjit_functions);
 
     PyModule_AddStringConstant(module, "__author__", "flandre.info");
     PyModule_AddStringConstant(module, "__version__", "0.0.1a1");
     PyModule_AddIntConstant(module, "year", 2022);
 
-    if (init_jit_entrance(module)) {
+    if (init_jit_entrance(module, ctx)) {
+        return -1;
+    }
+    if (init_generator(module, ctx)) {
+        return -1;
+    }
+    if (init_builtins(module, ctx)) {
+        return -1;
+    }
+    auto perf_map = getenv("YAPYJIT_PERF_MAP");
+    auto jitdump = getenv("YAPYJIT_JITDUMP");
+    try {
+        if (perf_map && *perf_map && strcmp(perf_map, "0") != 0 && yapyjit::perf_map_supported()) {
+            yapyjit::set_perf_map(true);
+        }
+        if (jitdump && *jitdump && strcmp(jitdump, "0") != 0 && yapyjit::perf_map_supported()) {
+            yapyjit::set_jitdump(true);
+        }
+    }
+    catch (const std::exception& e) {
+        PyErr_SetString(PyExc_RuntimeError, e.what());
         return -1;
     }
     return 0; /* success */
@@ -197,8 +484,27 @@ int exec_yapyjit(PyObject *module) {
 PyDoc_STRVAR(yapyjit_doc, "Yet another JIT for python.");
 
 
+static int traverse_yapyjit(PyObject* module, visitproc visit, void* arg) {
+    auto state = (ModuleState*)PyModule_GetState(module);
+    Py_VISIT(state->context);
+    return 0;
+}
+
+static int clear_yapyjit(PyObject* module) {
+    auto state = (ModuleState*)PyModule_GetState(module);
+    Py_CLEAR(state->context);
+    return 0;
+}
+
+static void free_yapyjit(void* module) {
+    clear_yapyjit((PyObject*)module);
+}
+
 static PyModuleDef_Slot yapyjit_slots[] = {
     { Py_mod_exec, (void*)exec_yapyjit },
+#ifdef Py_mod_multiple_interpreters
+    { Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED },
+#endif
     { 0, NULL }
 };
 
@@ -206,12 +512,12 @@ static PyModuleDef yapyjit_def = {
     PyModuleDef_HEAD_INIT,
     "yapyjit",
     yapyjit_doc,
-    0,              /* m_size */
+    sizeof(ModuleState), /* m_size */
     NULL,           /* m_methods */
     yapyjit_slots,
-    NULL,           /* m_traverse */
-    NULL,           /* m_clear */
-    NULL,           /* m_free */
+    traverse_yapyjit, /* m_traverse */
+    clear_yapyjit,  /* m_clear */
+    free_yapyjit,   /* m_free */
 };
 
 extern "C" {
@@ -0,0 +1,18 @@
+import sys
+import yapyjit
+
+
+# Front ends the tests compile each function with, the bytecode one only supports Python 3.11.
+FRONTENDS = ["ast"] + (["bytecode"] if sys.version_info[:2] == (3, 11) else [])
+
+
+class FrontendsMixin:
+    # Test case mixin jitting functions with each of `FRONTENDS`.
+
+    def tearDown(self):
+        yapyjit.set_frontend("ast")
+
+    def jit_each(self, func):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            yield yapyjit.jit(func)
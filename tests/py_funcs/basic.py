@@ -186,6 +186,12 @@ def comprehension_5():
     return a, b
 
 
+def comprehension_6():
+    a = [(1, 2), (3, 4)]
+    b = {v: k for k, v in a if k}
+    return a, b
+
+
 def genexpr_eager():
     return tuple(x for x in range(10) if x % 2 == 0)
 
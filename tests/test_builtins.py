@@ -0,0 +1,110 @@
+import builtins
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+class Sized:
+    def __len__(self):
+        return 3
+
+
+class Number:
+    def __abs__(self):
+        return "abs"
+
+    def __index__(self):
+        return 4
+
+    def __float__(self):
+        return 0.5
+
+
+def calls(xs, y):
+    return (
+        len(xs), isinstance(y, int), isinstance(y, (str, float)), abs(y),
+        min(y, 3, 1), max(xs), max(y, 2), int(y), float(y), list(range(y)), next(iter(xs))
+    )
+
+
+def objects(o):
+    return len(o) if isinstance(o, Sized) else (abs(o), int(o), float(o), isinstance(o, object))
+
+
+def various():
+    return int("12"), int("ff", 16), min([4, 2]), max(1, -2, key=abs), len((1, 2)), float("1.5")
+
+
+def for_loop(xs):
+    t = 0
+    for x in xs:
+        t += x
+    return t
+
+
+def use_len(xs):
+    return len(xs)
+
+
+def use_abs(x):
+    return abs(x)
+
+
+def bad_len():
+    return len(5)
+
+
+class TestBuiltins(FrontendsMixin, unittest.TestCase):
+
+    def test_values(self):
+        for jitted in self.jit_each(calls):
+            self.assertEqual(jitted([5, 7], 4), calls([5, 7], 4))
+            self.assertEqual(jitted((5,), -3), calls((5,), -3))
+        for jitted in self.jit_each(objects):
+            self.assertEqual(jitted(Sized()), 3)
+            self.assertEqual(jitted(Number()), ("abs", 4, 0.5, True))
+            self.assertEqual(jitted(True), (1, 1, 1.0, True))
+        for jitted in self.jit_each(various):
+            self.assertEqual(jitted(), various())
+        for jitted in self.jit_each(for_loop):
+            self.assertEqual(jitted(range(5)), 10)
+
+    def test_specialized(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(calls))
+            self.assertEqual(ir.count("CallBuiltin"), 11)
+            self.assertNotRegex(ir, r"LoadGlobal \d+ (len|abs|min|max|range|iter)\b")
+
+    def test_errors(self):
+        for jitted in self.jit_each(bad_len):
+            with self.assertRaises(TypeError):
+                jitted()
+
+    def test_global_shadow(self):
+        for jitted in self.jit_each(use_len):
+            self.assertEqual(jitted([1]), 1)
+            globals()["len"] = lambda xs: 42
+            try:
+                self.assertEqual(jitted([1]), 42)
+            finally:
+                del globals()["len"]
+            self.assertEqual(jitted([1]), 1)
+
+    def test_builtins_patched(self):
+        for jitted in self.jit_each(use_abs):
+            self.assertEqual(jitted(-1), 1)
+            original = builtins.abs
+            builtins.abs = lambda x: "patched"
+            try:
+                self.assertEqual(jitted(-1), "patched")
+                del builtins.abs
+                with self.assertRaises(NameError):
+                    jitted(-1)
+            finally:
+                builtins.abs = original
+            self.assertEqual(jitted(-1), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,151 @@
+import gc
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+def by_second(pairs):
+    return sorted(pairs, key=lambda p: p[1])
+
+
+def counter(start):
+    n = start
+
+    def inc(step=1):
+        nonlocal n
+        n += step
+        return n
+    return inc
+
+
+def adder(k, scale=2):
+    def add(x, *, offset=k):
+        return x * scale + offset
+    return add
+
+
+def curry(a):
+    def mid(b):
+        def inner(c):
+            return a + b + c
+        return inner
+    return mid
+
+
+def chained(xs):
+    return list(map(lambda v: v * 10, filter(lambda v: v % 2, xs)))
+
+
+def twice(f):
+    return lambda x: f(f(x))
+
+
+def decorated(x):
+    @twice
+    def step(y):
+        return y + x
+    return step(0)
+
+
+def fib(n):
+    def rec(k):
+        return k if k < 2 else rec(k - 1) + rec(k - 2)
+    return rec(n)
+
+
+def unbound():
+    def read():
+        return later
+    try:
+        read()
+    except NameError:
+        later = 1
+        return read()
+
+
+def nested_generator(n):
+    def gen():
+        for i in range(n):
+            yield i * i
+    return list(gen())
+
+
+def comprehension_lambdas(n, k):
+    rows = [[lambda: i * k for i in range(j)] for j in range(n)]
+    called = [(lambda: i + k)() for i in range(n)]
+    lazy = list(g() for g in (lambda: i for i in range(n)))
+    return [[g() for g in row] for row in rows], called, lazy
+
+
+class TestClosure(FrontendsMixin, unittest.TestCase):
+
+    def test_lambda(self):
+        for jitted in self.jit_each(by_second):
+            self.assertEqual(jitted([(1, 3), (2, 1), (3, 2)]), [(2, 1), (3, 2), (1, 3)])
+        for jitted in self.jit_each(chained):
+            self.assertEqual(jitted(range(6)), [10, 30, 50])
+
+    def test_nonlocal(self):
+        for jitted in self.jit_each(counter):
+            inc = jitted(10)
+            self.assertIsInstance(inc, yapyjit.JitEntrance)
+            self.assertEqual((inc(), inc(5), inc()), (11, 16, 17))
+            # Each call of the enclosing function has its own cell.
+            other = jitted(0)
+            self.assertEqual((other(), inc()), (1, 18))
+
+    def test_defaults(self):
+        for jitted in self.jit_each(adder):
+            add = jitted(3)
+            self.assertEqual(add(1), 5)
+            self.assertEqual(add(1, offset=0), 2)
+            self.assertEqual(jitted(1, 10)(2), 21)
+            self.assertEqual(add.wrapped.__defaults__, None)
+            self.assertEqual(add.wrapped.__kwdefaults__, {"offset": 3})
+
+    def test_nested(self):
+        for jitted in self.jit_each(curry):
+            mid = jitted(1)
+            inner = mid(2)
+            self.assertIsInstance(mid, yapyjit.JitEntrance)
+            self.assertIsInstance(inner, yapyjit.JitEntrance)
+            self.assertEqual(inner(3), 6)
+            self.assertEqual(inner.wrapped.__name__, "inner")
+        for jitted in self.jit_each(decorated):
+            self.assertEqual(jitted(4), 8)
+
+    def test_recursive(self):
+        for jitted in self.jit_each(fib):
+            self.assertEqual(jitted(15), 610)
+            # The closure refers to the function itself, so only the garbage collector frees it.
+            gc.collect()
+            before = len(gc.get_objects())
+            for _ in range(100):
+                jitted(3)
+            gc.collect()
+            self.assertLess(len(gc.get_objects()), before + 50)
+
+    def test_comprehension(self):
+        # Each run of a comprehension has its own variables, late bound in the lambdas.
+        for jitted in self.jit_each(comprehension_lambdas):
+            self.assertEqual(jitted(4, 3), comprehension_lambdas(4, 3))
+
+    def test_unbound(self):
+        for jitted in self.jit_each(unbound):
+            self.assertEqual(jitted(), 1)
+
+    def test_unsupported_body(self):
+        # Nested generators are left to CPython.
+        for jitted in self.jit_each(nested_generator):
+            self.assertEqual(jitted(4), [0, 1, 4, 9])
+
+    def test_instructions(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(counter))
+            self.assertIn("MakeFunction", ir)
+            self.assertNotIn("cell_contents", ir)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,78 @@
+import sys
+import unittest
+import yapyjit
+
+
+@yapyjit.jit
+def callee(x):
+    return x * 2
+
+
+def make_caller():
+    @yapyjit.jit
+    def caller(x):
+        return callee(x) + 1
+    return caller
+
+
+def make_funcs(n):
+    funcs = []
+    for i in range(n):
+        @yapyjit.jit
+        def func(x):
+            s = 0
+            for j in range(x):
+                s = s + j * 2 - 1
+            return [s, "constant", (1, 2.5)]
+        funcs.append(func)
+    return funcs
+
+
+class TestCodeCache(unittest.TestCase):
+
+    def tearDown(self):
+        yapyjit.set_code_budget(0)
+        yapyjit.set_inline_threshold(8)
+
+    def test_usage(self):
+        before = yapyjit.code_usage()
+        funcs = make_funcs(3)
+        self.assertTrue(all(f.code_size > 0 for f in funcs))
+        self.assertEqual(yapyjit.code_usage(), before + sum(f.code_size for f in funcs))
+        del funcs
+        self.assertEqual(yapyjit.code_usage(), before)
+
+    def test_release_references(self):
+        yapyjit.set_inline_threshold(1)
+        self.assertEqual(callee(1), 2)  # Compiled again if evicted by another test.
+        refs = sys.getrefcount(callee)
+        caller = make_caller()
+        self.assertEqual(caller(3), 7)
+        self.assertEqual(caller.inlined, 1)
+        self.assertEqual(sys.getrefcount(callee), refs + 1)
+        del caller
+        self.assertEqual(sys.getrefcount(callee), refs)
+
+    def test_budget(self):
+        funcs = make_funcs(4)
+        size = funcs[0].code_size
+        # Evict everything, including functions of other tests.
+        yapyjit.set_code_budget(1)
+        self.assertEqual(yapyjit.code_usage(), 0)
+        self.assertTrue(all(f.tier == 0 and f.code_size == 0 for f in funcs))
+
+        yapyjit.set_code_budget(size * 3 + size // 2)
+        for f in funcs:
+            self.assertEqual(f(4), [8, "constant", (1, 2.5)])
+        self.assertLessEqual(yapyjit.code_usage(), size * 3 + size // 2)
+        self.assertEqual([f.tier for f in funcs], [0, 1, 1, 1])
+
+        # The least recently called function makes room for the one called now.
+        self.assertEqual(funcs[0](5), [15, "constant", (1, 2.5)])
+        self.assertEqual([f.tier for f in funcs], [1, 0, 1, 1])
+        self.assertEqual(funcs[2](3), [3, "constant", (1, 2.5)])
+        self.assertEqual(funcs[1](2), [0, "constant", (1, 2.5)])
+        self.assertEqual([f.tier for f in funcs], [1, 1, 1, 0])
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,79 @@
+import sys
+import unittest
+import yapyjit
+from tests import FrontendsMixin
+
+
+def squares(xs):
+    return [x * x for x in xs if x % 2]
+
+
+def residues(xs, m):
+    return {x % m for x in xs}
+
+
+def index(xs):
+    return {x: i for i, x in enumerate(xs)}
+
+
+def pairs(n):
+    return [(i, j) for i in range(n) for j in range(i) if (i + j) % 2]
+
+
+def grid(n):
+    return {i: {j for j in range(i)} for i in range(n)}
+
+
+def unhashable(xs):
+    return {[x] for x in xs}
+
+
+def keyed(xs):
+    return {[x]: x for x in xs}
+
+
+class TestComprehension(FrontendsMixin, unittest.TestCase):
+
+    def test_values(self):
+        for jitted in self.jit_each(squares):
+            self.assertEqual(jitted(range(10)), squares(range(10)))
+            self.assertEqual(jitted([]), [])
+        for jitted in self.jit_each(residues):
+            self.assertEqual(jitted(range(20), 7), set(range(7)))
+        for jitted in self.jit_each(index):
+            # Later keys overwrite earlier ones, and insertion order is kept.
+            self.assertEqual(list(jitted("abca").items()), [("a", 3), ("b", 1), ("c", 2)])
+        for jitted in self.jit_each(pairs):
+            self.assertEqual(jitted(5), pairs(5))
+        for jitted in self.jit_each(grid):
+            self.assertEqual(jitted(4), grid(4))
+
+    def test_errors(self):
+        for jitted in self.jit_each(unhashable):
+            self.assertEqual(jitted([]), set())
+            with self.assertRaises(TypeError):
+                jitted([1])
+        for jitted in self.jit_each(keyed):
+            with self.assertRaises(TypeError):
+                jitted([1])
+
+    def test_references(self):
+        obj = object()
+        refs = sys.getrefcount(obj)
+        for jitted in self.jit_each(index):
+            result = jitted([obj])
+            self.assertEqual(sys.getrefcount(obj), refs + 1)
+            del result
+            self.assertEqual(sys.getrefcount(obj), refs)
+
+    def test_instructions(self):
+        # The bytecode front end sees comprehensions as calls of nested code objects.
+        # Only the call of `enumerate` remains.
+        for func, insn, calls in [(squares, "ListAppend", 0), (residues, "SetAdd", 0), (index, "MapAdd", 1)]:
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(func))
+            self.assertIn(insn, ir)
+            self.assertEqual(ir.count("Call "), calls)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,112 @@
+import sys
+import unittest
+import yapyjit
+from tests import FrontendsMixin
+
+
+def scale(x, *, by=2):
+    return x * by
+
+
+def offset(x, delta=1):
+    return scale(x, by=3) + delta
+
+
+def layered(n):
+    total = 0
+    for i in range(n):
+        total += offset(i) + offset(i, delta=-1) + offset(delta=0, x=i)
+    return total
+
+
+def fact(n):
+    return 1 if n <= 1 else n * fact(n - 1)
+
+
+def ping(n):
+    return pong(n - 1) + [n] if n > 0 else []
+
+
+def pong(n):
+    return ping(n - 1) + [-n] if n > 0 else []
+
+
+def failing(x):
+    return x.missing
+
+
+def catching(x):
+    try:
+        return failing(x)
+    except AttributeError:
+        return x
+
+
+def call_each(fs, x):
+    return [f(x) for f in fs]
+
+
+class Vec:
+    def __init__(self, x, y):
+        self.x = x
+        self.y = y
+
+    def dot(self, other, *, weight=1):
+        return (self.x * other.x + self.y * other.y) * weight
+
+
+def dots(v, w):
+    return v.dot(w) + v.dot(w, weight=2) + Vec.dot(v, w, weight=3)
+
+
+class TestDirectCall(FrontendsMixin, unittest.TestCase):
+
+    def setUp(self):
+        self.saved = {name: globals()[name] for name in ["scale", "offset", "fact", "ping", "pong", "failing"]}
+        self.saved_dot = Vec.dot
+
+    def tearDown(self):
+        globals().update(self.saved)
+        Vec.dot = self.saved_dot
+        super().tearDown()
+
+    def jit_globals(self, *names):
+        for name in names:
+            globals()[name] = yapyjit.jit(self.saved[name])
+
+    def test_layered(self):
+        expected = layered(50)
+        for jitted in self.jit_each(layered):
+            self.jit_globals("scale", "offset")
+            self.assertEqual(jitted(50), expected)
+
+    def test_recursion(self):
+        for jitted in self.jit_each(fact):
+            self.jit_globals("fact", "ping", "pong")
+            # Nested activations of one function each get their own registers.
+            self.assertEqual(jitted(20), self.saved["fact"](20))
+            self.assertEqual(ping(5), self.saved["ping"](5))
+
+    def test_errors(self):
+        obj = object()
+        refs = sys.getrefcount(obj)
+        for jitted in self.jit_each(catching):
+            self.jit_globals("failing")
+            for _ in range(10):
+                self.assertIs(jitted(obj), obj)
+        self.assertEqual(sys.getrefcount(obj), refs)
+
+    def test_mixed_callees(self):
+        jitted_scale = yapyjit.jit(scale)
+        for jitted in self.jit_each(call_each):
+            self.assertEqual(jitted([jitted_scale, scale, abs, str], -2), [-4, -4, 2, "-2"])
+
+    def test_methods(self):
+        v, w = Vec(1, 2), Vec(3, 4)
+        for jitted in self.jit_each(dots):
+            Vec.dot = yapyjit.jit(self.saved_dot)
+            self.assertEqual(jitted(v, w), 66)
+
+
+if __name__ == "__main__":
+    unittest.main()
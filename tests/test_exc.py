@@ -1,3 +1,4 @@
+import sys
 import unittest
 import yapyjit
 
@@ -30,6 +31,26 @@ def test_reraise():
         raise
 
 
+@yapyjit.jit
+def return_in_handler(log):
+    try:
+        raise TestException
+    except TestException:
+        return sys.exc_info()[0]
+    finally:
+        log.append("finally")
+
+
+@yapyjit.jit
+def break_in_handler():
+    while True:
+        try:
+            raise TestException
+        except TestException:
+            break
+    return sys.exc_info()[0]
+
+
 class TestExceptions(unittest.TestCase):
 
     def test_raise(self):
@@ -42,6 +63,14 @@ class TestExceptions(unittest.TestCase):
     def test_reraise(self):
         self.assertRaises(TestException, test_reraise)
 
+    def test_leave_handler(self):
+        # Leaving an except clause early ends the handling of its exception too.
+        log = []
+        self.assertIs(return_in_handler(log), TestException)
+        self.assertEqual(log, ["finally"])
+        self.assertEqual(sys.exc_info(), (None, None, None))
+        self.assertIsNone(break_in_handler())
+
 
 if __name__ == "__main__":
     unittest.main()
@@ -0,0 +1,148 @@
+import unittest
+import yapyjit
+from tests import FrontendsMixin
+
+
+G = 0
+X = "global"
+
+
+def arith():
+    return 2 * 3.14159, 1 << 20, -1, ~5, not 0, "ab" * 3, (1, -2, ("x",)), 7 // 2 % 3, 2 ** 10
+
+
+def unfolded():
+    return 2 ** 1000, 1 << 200, "%s!" % 1, "a" * 5000
+
+
+def divide():
+    return 1 / 0
+
+
+def scaled(x):
+    return x * (2 * 3.14159)
+
+
+def branches(x):
+    if False:
+        x = x + 1
+    if 1:
+        x = x * 2
+    else:
+        x = x - 1
+    return x if True else -x
+
+
+def forever(n):
+    i = 0
+    while True:
+        i += 1
+        if i >= n:
+            break
+    else:
+        i = -1
+    return i
+
+
+def never(n):
+    while 0:
+        n += 1
+    else:
+        n -= 1
+    return n
+
+
+def early(x):
+    return x
+    x = undefined()
+
+
+def dead_global():
+    if False:
+        global G
+    G = 5
+
+
+def dead_assign():
+    if False:
+        X = 1
+    return X
+
+
+def dead_for():
+    return X
+    for X in ():
+        pass
+
+
+def dead_def():
+    while False:
+        def X():
+            pass
+    return X
+
+
+def dead_walrus():
+    y = 0 if True else (X := 1)
+    return X
+
+
+class TestFold(FrontendsMixin, unittest.TestCase):
+
+    def test_values(self):
+        for jitted in self.jit_each(arith):
+            self.assertEqual(jitted(), arith())
+        for jitted in self.jit_each(unfolded):
+            self.assertEqual(jitted(), unfolded())
+        for jitted in self.jit_each(divide):
+            with self.assertRaises(ZeroDivisionError):
+                jitted()
+        for jitted in self.jit_each(branches):
+            self.assertEqual(jitted(3), 6)
+        for jitted in self.jit_each(forever):
+            self.assertEqual(jitted(5), 5)
+        for jitted in self.jit_each(never):
+            self.assertEqual(jitted(5), 4)
+        for jitted in self.jit_each(early):
+            self.assertEqual(jitted(1), 1)
+
+    def test_global(self):
+        global G
+        for jitted in self.jit_each(dead_global):
+            G = 0
+            jitted()
+            self.assertEqual(G, 5)
+
+    def test_dead_binds(self):
+        # Names bound in dropped code are still local to the function.
+        for func in [dead_assign, dead_for, dead_def, dead_walrus]:
+            for jitted in self.jit_each(func):
+                try:
+                    self.assertNotEqual(jitted(), "global")
+                except UnboundLocalError:
+                    pass
+
+    def test_folded_ir(self):
+        ir = yapyjit.pprint_ir(yapyjit.get_ir(arith))
+        for op in ["Mult", "LShift", "USub", "Invert", "Not", "FloorDiv", "Mod", "Pow", "BuildTuple"]:
+            self.assertNotIn(op, ir)
+        ir = yapyjit.pprint_ir(yapyjit.get_ir(scaled))
+        self.assertEqual(ir.count("Mult"), 1)
+        self.assertIn("6.28318", ir)
+        ir = yapyjit.pprint_ir(yapyjit.get_ir(unfolded))
+        for op in ["Pow", "LShift", "Mod", "Mult"]:
+            self.assertIn(op, ir)
+
+    def test_dead_code(self):
+        # Only the `if` in the body of `forever` tests at runtime.
+        for func, tests in [(branches, 0), (forever, 1), (never, 0)]:
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(func))
+            self.assertEqual(ir.count("JumpTruthy"), tests)
+        ir = yapyjit.pprint_ir(yapyjit.get_ir(branches))
+        self.assertNotIn("Add", ir)
+        self.assertNotIn("Sub", ir)
+        self.assertNotIn("undefined", yapyjit.pprint_ir(yapyjit.get_ir(early)))
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,117 @@
+import sys
+import unittest
+import yapyjit
+
+
+def make_closure(k):
+    def add_k(x):
+        nonlocal k
+        k += x
+        return k
+    return add_k
+
+
+def swap(a, b):
+    a, b = b, a
+    return a, b
+
+
+def capture(n):
+    fs = [lambda: n * 2]
+    n = 7
+    return fs[0](), [n + i for i in range(3)]
+
+
+def exceptions(n):
+    out = []
+    for i in range(n):
+        try:
+            try:
+                if i % 2:
+                    raise KeyError(i)
+                out.append(i)
+            finally:
+                out.append('f')
+        except KeyError as e:
+            out.append(('k', e.args[0]))
+    return out
+
+
+def checked(x):
+    assert x > 0, "non-positive"
+    return x
+
+
+def make_adders(x):
+    def add(a, b=x, *, c=x + 1):
+        return a + b + c
+    return add(1), add(1, 2, c=3)
+
+
+@unittest.skipUnless(sys.version_info[:2] == (3, 11), "the bytecode front end supports CPython 3.11 only")
+class TestBytecodeFrontend(unittest.TestCase):
+
+    def setUp(self):
+        yapyjit.set_frontend("bytecode")
+
+    def tearDown(self):
+        yapyjit.set_frontend("ast")
+
+    def test_lambda(self):
+        func = yapyjit.jit(lambda x, y=2: x * y + 1)
+        self.assertEqual(func(3), 7)
+        self.assertEqual(func(3, y=4), 13)
+
+    def test_exec(self):
+        ns = {}
+        exec(
+            "def total(n):\n"
+            "    t = 0\n"
+            "    for i in range(n):\n"
+            "        if i % 3 == 0:\n"
+            "            continue\n"
+            "        t += i\n"
+            "    return t\n",
+            ns
+        )
+        self.assertEqual(yapyjit.jit(ns["total"])(10), 27)
+
+    def test_cells(self):
+        func = yapyjit.jit(make_closure(10))
+        self.assertEqual(func(1), 11)
+        self.assertEqual(func(2), 13)
+        self.assertEqual(yapyjit.jit(capture)(3), (14, [7, 8, 9]))
+        self.assertEqual(yapyjit.jit(make_adders)(10), (22, 6))
+
+    def test_stack_aliasing(self):
+        self.assertEqual(yapyjit.jit(swap)(1, 2), (2, 1))
+
+    def test_exceptions(self):
+        self.assertEqual(yapyjit.jit(exceptions)(4), exceptions(4))
+        with self.assertRaises(AssertionError):
+            yapyjit.jit(checked)(-1)
+
+    def test_evicted(self):
+        func = yapyjit.jit(lambda x: x + 1)
+        try:
+            yapyjit.set_code_budget(1)
+            yapyjit.set_frontend("ast")
+            # Compiled again with the front end it was created with.
+            self.assertEqual(func(1), 2)
+        finally:
+            yapyjit.set_code_budget(0)
+
+
+class TestFrontendSelection(unittest.TestCase):
+
+    def test_unknown(self):
+        with self.assertRaises(RuntimeError):
+            yapyjit.set_frontend("tokens")
+
+    def test_ast_needs_source(self):
+        with self.assertRaises(Exception):
+            yapyjit.jit(lambda x: x)
+
+
+if __name__ == "__main__":
+    unittest.main()
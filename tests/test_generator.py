@@ -0,0 +1,184 @@
+import gc
+import itertools
+import sys
+import unittest
+import weakref
+import yapyjit
+
+
+OFFSET = 100
+
+
+class Pulled:
+    # Iterable counting the elements taken from it.
+    def __init__(self, n):
+        self.n = n
+        self.count = 0
+
+    def __iter__(self):
+        for i in range(self.n):
+            self.count += 1
+            yield i
+
+
+@yapyjit.jit
+def first_over(xs, limit):
+    return any(x > limit for x in xs)
+
+
+@yapyjit.jit
+def sum_squares(n):
+    return sum(x * x for x in range(n) if x % 3)
+
+
+@yapyjit.jit
+def make_gen(xs, k):
+    return (x * k + OFFSET for x in xs if x)
+
+
+@yapyjit.jit
+def product(xs, ys):
+    return list((x, y) for x in xs for y in ys if x != y)
+
+
+@yapyjit.jit
+def nested(n):
+    return [tuple(i * j for j in range(n)) for i in range(n)]
+
+
+@yapyjit.jit
+def capture(xs):
+    k = 1
+    gen = (x + k for x in xs)
+    k = 2
+    return gen
+
+
+@yapyjit.jit
+def scale():
+    k = 1
+    gen = (v * k for v in range(3))
+    k = 10
+    return list(gen)
+
+
+@yapyjit.jit
+def divide_all(xs):
+    return list(1 / x for x in xs)
+
+
+@yapyjit.jit
+def stop_inside(xs):
+    return list(next(iter([])) for x in xs)
+
+
+@yapyjit.jit
+def bad_iter():
+    return (x for x in 5)
+
+
+def make_closure(k):
+    @yapyjit.jit
+    def closure(xs):
+        return list(x * k for x in xs)
+    return closure
+
+
+class TestGenerator(unittest.TestCase):
+
+    def tearDown(self):
+        yapyjit.set_code_budget(0)
+
+    def test_lazy(self):
+        src = Pulled(1000)
+        self.assertTrue(first_over(src, 5))
+        self.assertEqual(src.count, 7)
+        self.assertTrue(first_over(itertools.count(), 10))
+
+    def test_values(self):
+        self.assertEqual(sum_squares(100), sum(x * x for x in range(100) if x % 3))
+        self.assertEqual(product([1, 2], [2, 3]), [(1, 2), (1, 3), (2, 3)])
+        self.assertEqual(nested(3), [(0, 0, 0), (0, 1, 2), (0, 2, 4)])
+        self.assertEqual(make_closure(3)([1, 2]), [3, 6])
+
+    def test_protocol(self):
+        gen = make_gen([0, 1, 2], 2)
+        self.assertIsInstance(gen, yapyjit.Generator)
+        self.assertIs(iter(gen), gen)
+        self.assertEqual(next(gen), 102)
+        self.assertEqual(list(gen), [104])
+        self.assertEqual(list(gen), [])
+        with self.assertRaises(StopIteration):
+            next(gen)
+
+    def test_capture(self):
+        # Locals of the enclosing function are read when the generator runs.
+        self.assertEqual(list(capture([1, 2])), [3, 4])
+        self.assertEqual(scale(), [0, 10, 20])
+
+    def test_methods(self):
+        gen = make_gen([1, 2, 3], 1)
+        with self.assertRaises(TypeError):
+            gen.send(1)
+        self.assertEqual(gen.send(None), 101)
+        self.assertEqual(gen.send(5), 102)
+        with self.assertRaises(KeyError):
+            gen.throw(KeyError)
+        with self.assertRaises(StopIteration):
+            gen.send(None)
+        gen = make_gen([1, 2, 3], 1)
+        next(gen)
+        with self.assertRaises(ValueError) as ctx:
+            gen.throw(ValueError("x"))
+        self.assertEqual(str(ctx.exception), "x")
+        gen = make_gen([1, 2, 3], 1)
+        next(gen)
+        self.assertIsNone(gen.close())
+        self.assertEqual(list(gen), [])
+        self.assertIsNone(gen.close())
+
+    def test_exceptions(self):
+        with self.assertRaises(ZeroDivisionError):
+            divide_all([1, 0])
+        with self.assertRaises(RuntimeError) as ctx:
+            stop_inside([1])
+        self.assertIsInstance(ctx.exception.__cause__, StopIteration)
+        with self.assertRaises(TypeError):
+            bad_iter()
+
+    def test_survives_eviction(self):
+        gen = make_gen([1, 2, 3], 1)
+        self.assertEqual(next(gen), 101)
+        yapyjit.set_code_budget(1)
+        self.assertEqual(make_gen.code_size, 0)
+        self.assertEqual(list(gen), [102, 103])
+
+    def test_references(self):
+        obj = object()
+        xs = [obj] * 4
+        refs = sys.getrefcount(obj)
+        gen = make_gen(xs, 1)
+        self.assertIsNotNone(gen)
+        with self.assertRaises(TypeError):
+            next(gen)
+        gen = make_gen([1, 2], 1)
+        next(gen)
+        del gen
+        self.assertEqual(sys.getrefcount(obj), refs)
+
+    def test_cycle(self):
+        class Marker:
+            pass
+        marker = Marker()
+        ref = weakref.ref(marker)
+        xs = [1, marker]
+        gen = make_gen(xs, 1)
+        next(gen)
+        xs.append(gen)
+        del marker, xs, gen
+        gc.collect()
+        self.assertIsNone(ref())
+
+
+if __name__ == "__main__":
+    unittest.main()
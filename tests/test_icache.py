@@ -0,0 +1,86 @@
+import unittest
+import yapyjit
+
+
+@yapyjit.jit
+def add_poly(x, y):
+    return x + y
+
+
+@yapyjit.jit
+def add_mega(x, y):
+    return x + y
+
+
+@yapyjit.jit
+def add_vec(x, y):
+    return x + y
+
+
+@yapyjit.jit
+def mixed_mult(n):
+    s = 0
+    for i in range(n):
+        s = s + (i * 0.5 if i % 2 else i * 2)
+    return s
+
+
+@yapyjit.jit
+def pow_sum(x, y):
+    z = x ** y
+    z **= 2
+    return z + x
+
+
+class Vec:
+    def __init__(self, x):
+        self.x = x
+
+    def __add__(self, other):
+        if isinstance(other, Vec):
+            return Vec(self.x + other.x)
+        return NotImplemented
+
+
+class TestInlineCaches(unittest.TestCase):
+
+    def test_polymorphic(self):
+        for i in range(50):
+            self.assertEqual(add_poly(1.5, i), 1.5 + i)
+            self.assertEqual(add_poly(i, 2.0), i + 2.0)
+        stats = add_poly.icache_stats()
+        self.assertEqual(len(stats), 1)
+        self.assertEqual(stats[0]['state'], 'poly')
+        self.assertEqual(stats[0]['entries'], 2)
+        self.assertEqual(stats[0]['misses'], 2)
+        self.assertEqual(stats[0]['hits'], 98)
+
+    def test_mixed_loop(self):
+        self.assertEqual(mixed_mult(100), sum(i * 0.5 if i % 2 else i * 2 for i in range(100)))
+        self.assertTrue(all(s['state'] in ('mono', 'poly') for s in mixed_mult.icache_stats()))
+
+    def test_pow_uncached(self):
+        self.assertEqual(pow_sum(2, 3), 66)
+        # Only the addition has a cache.
+        stats = pow_sum.icache_stats()
+        self.assertEqual(len(stats), 1)
+        self.assertEqual((stats[0]['hits'], stats[0]['misses']), (0, 1))
+
+    def test_megamorphic(self):
+        for v in [1, 2.0, 3j, "a", [1], (2,), b"b"]:
+            self.assertEqual(add_mega(v, v), v + v)
+        self.assertEqual(add_mega("x", "y"), "xy")
+        self.assertEqual(add_mega([1], [2]), [1, 2])
+        self.assertEqual(add_mega.icache_stats()[0]['state'], 'mega')
+
+    def test_not_implemented_fallback(self):
+        self.assertEqual(add_vec(Vec(2), Vec(3)).x, 5)
+        with self.assertRaises(TypeError):
+            add_vec(Vec(1), 1)
+        with self.assertRaises(TypeError):
+            add_vec(1, Vec(1))
+        self.assertEqual(add_vec(Vec(4), Vec(3)).x, 7)
+
+
+if __name__ == "__main__":
+    unittest.main()
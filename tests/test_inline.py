@@ -0,0 +1,234 @@
+import unittest
+import yapyjit
+
+
+class Failure(Exception):
+    pass
+
+
+@yapyjit.jit
+def add1(x):
+    return x + 1
+
+
+@yapyjit.jit
+def scale(x, factor=2, *, offset=0):
+    return x * factor + offset
+
+
+@yapyjit.jit
+def fail_if_negative(x):
+    if x < 0:
+        raise Failure(x)
+    return x
+
+
+@yapyjit.jit
+def safe_div(a, b):
+    try:
+        return a / b
+    except ZeroDivisionError:
+        return None
+
+
+@yapyjit.jit
+def two_levels(x):
+    return add1(add1(x))
+
+
+@yapyjit.jit
+def fib(n):
+    if n < 2:
+        return n
+    return fib(n - 1) + fib(n - 2)
+
+
+@yapyjit.jit
+def loop_add1(n):
+    s = 0
+    for i in range(n):
+        s = add1(s)
+    return s
+
+
+@yapyjit.jit
+def call_scale(x):
+    return [scale(x), scale(x, 3), scale(x, offset=1), scale(factor=4, x=x), scale(x, 5, offset=2)]
+
+
+@yapyjit.jit
+def call_scale_wrong(x):
+    return scale(x, x, factor=3)
+
+
+@yapyjit.jit
+def call_fail(xs):
+    result = []
+    for x in xs:
+        try:
+            result.append(fail_if_negative(x))
+        except Failure as e:
+            result.append(str(e))
+    return result
+
+
+@yapyjit.jit
+def call_fail_uncaught(x):
+    return fail_if_negative(x) + 1
+
+
+@yapyjit.jit
+def call_safe_div(a, b):
+    return safe_div(a, b), safe_div(b, a)
+
+
+@yapyjit.jit
+def call_two_levels(x):
+    return two_levels(x) + two_levels(x + 1)
+
+
+@yapyjit.jit
+def call_rebound(x):
+    return rebound(x)
+
+
+@yapyjit.jit
+def rebound(x):
+    return x - 1
+
+
+@yapyjit.jit
+def bind_if(x):
+    if x:
+        y = x
+    return y
+
+
+@yapyjit.jit
+def call_bind_if(xs):
+    result = []
+    for x in xs:
+        result.append(bind_if(x))
+    return result
+
+
+class Probe:
+    live = 0
+
+    def __init__(self):
+        Probe.live += 1
+
+    def __del__(self):
+        Probe.live -= 1
+
+
+@yapyjit.jit
+def hold(x):
+    probe = Probe()
+    return x
+
+
+@yapyjit.jit
+def call_hold(x, live):
+    hold(x)
+    return live()
+
+
+def make_closure_caller():
+    @yapyjit.jit
+    def inner(x):
+        return x * 10
+
+    @yapyjit.jit
+    def outer(x):
+        return inner(x) + 1
+    return outer
+
+
+class TestInline(unittest.TestCase):
+
+    def setUp(self):
+        yapyjit.set_inline_threshold(1)
+
+    def tearDown(self):
+        yapyjit.set_inline_threshold(8)
+
+    def test_simple(self):
+        for _ in range(3):
+            self.assertEqual(loop_add1(100), 100)
+        self.assertEqual(loop_add1.inlined, 1)
+
+    def test_arguments(self):
+        expected = [8, 12, 9, 16, 22]
+        for _ in range(3):
+            self.assertEqual(call_scale(4), expected)
+        self.assertEqual(call_scale.inlined, 5)
+        self.assertEqual(call_scale(0.5), [1.0, 1.5, 2.0, 2.0, 4.5])
+
+    def test_bad_arguments(self):
+        # Argument errors are left to the original call.
+        for _ in range(3):
+            try:
+                call_scale_wrong(2)
+            except TypeError:
+                pass
+        self.assertEqual(call_scale_wrong.inlined, 0)
+
+    def test_exceptions(self):
+        for _ in range(3):
+            self.assertEqual(call_fail([1, -2, 3]), [1, "-2", 3])
+            with self.assertRaises(Failure):
+                call_fail_uncaught(-1)
+            self.assertEqual(call_fail_uncaught(1), 2)
+            self.assertEqual(call_safe_div(1, 0), (None, 0.0))
+        self.assertEqual(call_fail.inlined, 1)
+        self.assertEqual(call_safe_div.inlined, 2)
+
+    def test_nested(self):
+        for _ in range(3):
+            self.assertEqual(call_two_levels(1), 7)
+        self.assertEqual(call_two_levels.inlined, 6)
+
+    def test_fresh_locals(self):
+        # Locals of an inlined call are neither seen by the next call nor kept alive after it.
+        for _ in range(3):
+            self.assertEqual(call_bind_if([1, 0]), [1, None])
+            self.assertEqual(call_hold(1, lambda: Probe.live), 0)
+        self.assertEqual(call_bind_if.inlined, 1)
+        self.assertEqual(call_hold.inlined, 1)
+
+    def test_recursion(self):
+        for _ in range(3):
+            self.assertEqual(fib(15), 610)
+        self.assertEqual(fib.inlined, 0)
+
+    def test_guard(self):
+        global rebound
+        original = rebound
+        try:
+            self.assertEqual(call_rebound(5), 4)
+            self.assertEqual(call_rebound.inlined, 1)
+            rebound = lambda x: x + 100
+            self.assertEqual(call_rebound(5), 105)
+            rebound = add1
+            self.assertEqual(call_rebound(5), 6)
+        finally:
+            rebound = original
+        self.assertEqual(call_rebound(5), 4)
+
+    def test_closure(self):
+        outer = make_closure_caller()
+        for _ in range(3):
+            self.assertEqual(outer(2), 21)
+        self.assertEqual(outer.inlined, 1)
+
+    def test_disabled(self):
+        yapyjit.set_inline_threshold(0)
+        func = make_closure_caller()
+        for _ in range(3):
+            self.assertEqual(func(1), 11)
+        self.assertEqual(func.inlined, -1)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,138 @@
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+class Counted:
+    # Container counting item and attribute accesses.
+    def __init__(self, value):
+        self.gets = 0
+        self.sets = 0
+        self.items = {0: value}
+
+    def __getitem__(self, key):
+        self.gets += 1
+        return self.items[key]
+
+    def __setitem__(self, key, value):
+        self.sets += 1
+        self.items[key] = value
+
+
+class Box:
+    def __init__(self, value):
+        self.value = value
+
+
+class Acc:
+    def __init__(self):
+        self.log = []
+
+    def __iadd__(self, other):
+        self.log.append(other)
+        return self
+
+    def __add__(self, other):
+        raise AssertionError("binary add used for +=")
+
+
+def extend(xs, ys):
+    alias = xs
+    xs += ys
+    return xs is alias
+
+
+def concat(n):
+    s = ""
+    for i in range(n):
+        s += "ab"
+    return s
+
+
+def numbers(a, b):
+    x = a
+    x += b
+    x -= 1
+    x *= b
+    x **= 2
+    x //= 3
+    x %= 1000
+    x <<= 2
+    x >>= 1
+    x |= 8
+    x ^= 3
+    x &= 0xff
+    y = float(a)
+    y /= 4
+    return x, y
+
+
+def on_item(c, v):
+    c[0] += v
+    return c
+
+
+def on_attr(b, v):
+    b.value += v
+    return b
+
+
+def on_acc(acc):
+    acc += 1
+    acc += 2
+    return acc
+
+
+def on_tuple(t):
+    t += (3,)
+    return t
+
+
+class TestInplace(FrontendsMixin, unittest.TestCase):
+
+    def test_list_identity(self):
+        for jitted in self.jit_each(extend):
+            xs = [1]
+            self.assertTrue(jitted(xs, [2, 3]))
+            self.assertEqual(xs, [1, 2, 3])
+            self.assertTrue(jitted(xs, (4,)))
+            self.assertEqual(xs, [1, 2, 3, 4])
+
+    def test_immutable(self):
+        for jitted in self.jit_each(on_tuple):
+            t = (1, 2)
+            self.assertEqual(jitted(t), (1, 2, 3))
+            self.assertEqual(t, (1, 2))
+        for jitted in self.jit_each(concat):
+            self.assertEqual(jitted(0), "")
+            self.assertEqual(jitted(1000), "ab" * 1000)
+
+    def test_numbers(self):
+        for jitted in self.jit_each(numbers):
+            for args in [(3, 4), (-7, 2), (10**20, 3)]:
+                self.assertEqual(jitted(*args), numbers(*args), args)
+
+    def test_target_once(self):
+        for jitted in self.jit_each(on_item):
+            c = jitted(Counted([1]), [2])
+            self.assertEqual((c.items[0], c.gets, c.sets), ([1, 2], 1, 1))
+        for jitted in self.jit_each(on_attr):
+            self.assertEqual(jitted(Box(5), 2).value, 7)
+            self.assertEqual(jitted(Box("a"), "b").value, "ab")
+
+    def test_dunder(self):
+        for jitted in self.jit_each(on_acc):
+            acc = Acc()
+            self.assertIs(jitted(acc), acc)
+            self.assertEqual(acc.log, [1, 2])
+
+    def test_instructions(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(numbers))
+            for op in ["Add", "Sub", "Mult", "Pow", "FloorDiv", "Mod", "LShift", "RShift", "BitOr", "BitXor", "BitAnd", "Div"]:
+                self.assertIn("Inplace" + op, ir)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,58 @@
+import sys
+import unittest
+import yapyjit
+from tests import FrontendsMixin
+
+
+def params(alpha, beta, gamma=3, *, delta=4, epsilon=5):
+    return alpha, beta, gamma, delta, epsilon
+
+
+def call_shapes(f):
+    # Distinct `kwnames` tuples, more than are cached at once.
+    return [
+        f(1, 2),
+        f(1, beta=2),
+        f(alpha=1, beta=2),
+        f(beta=2, alpha=1),
+        f(1, 2, delta=0),
+        f(1, 2, epsilon=0, delta=0),
+        f(gamma=0, beta=2, alpha=1),
+    ]
+
+
+class TestKeywords(FrontendsMixin, unittest.TestCase):
+
+    def test_shapes(self):
+        for jitted in self.jit_each(params):
+            expected = call_shapes(params)
+            # The second round finds the shapes in the cache, or replaces them.
+            for _ in range(3):
+                self.assertEqual(call_shapes(jitted), expected)
+
+    def test_runtime_names(self):
+        # Names built at runtime are not the interned parameter names.
+        names = ["".join(["al", "pha"]), "".join(["be", "ta"])]
+        for jitted in self.jit_each(params):
+            self.assertEqual(jitted(**dict(zip(names, [1, 2]))), params(1, 2))
+
+    def test_errors(self):
+        for jitted in self.jit_each(params):
+            with self.assertRaisesRegex(TypeError, "unexpected keyword argument 'zeta'"):
+                jitted(1, 2, zeta=0)
+            with self.assertRaisesRegex(TypeError, "multiple values for argument 'alpha'"):
+                jitted(1, 2, alpha=0)
+            with self.assertRaisesRegex(TypeError, "missing required argument 'beta'"):
+                jitted(1, gamma=0)
+            with self.assertRaisesRegex(TypeError, "takes 3 positional arguments but 4 were given"):
+                jitted(1, 2, 3, 4)
+            # Failed calls leave no references behind.
+            obj = object()
+            refs = sys.getrefcount(obj)
+            with self.assertRaises(TypeError):
+                jitted(obj, obj, zeta=obj)
+            self.assertEqual(sys.getrefcount(obj), refs)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,117 @@
+import math
+import sys
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+class Node:
+    def __init__(self, value, *children):
+        self.value = value
+        self.children = children
+
+    def total(self):
+        result = self.value
+        for child in self.children:
+            result += child.total()
+        return result
+
+    def scaled(self, factor, *, offset=0):
+        return self.value * factor + offset
+
+    @staticmethod
+    def make(value):
+        return Node(value)
+
+    @classmethod
+    def name(cls):
+        return cls.__name__
+
+
+def builtin_methods(xs):
+    out = []
+    for x in xs:
+        out.append(x)
+    return ", ".join(str(x) for x in out), math.sqrt(16.0)
+
+
+def user_methods(node):
+    return node.scaled(2), node.scaled(2, offset=1), Node.make(3).value, node.name(), Node.name()
+
+
+def shadowed(node):
+    # An instance attribute is called as it is, without `self`.
+    node.scaled = lambda *args: args
+    return node.scaled(1, 2)
+
+
+def order(log):
+    return log.missing(log.append(1))
+
+
+def walk(node):
+    return node.total()
+
+
+class TestMethodCall(FrontendsMixin, unittest.TestCase):
+
+    def setUp(self):
+        self.saved_total = Node.total
+
+    def tearDown(self):
+        Node.total = self.saved_total
+        super().tearDown()
+
+    def test_values(self):
+        for jitted in self.jit_each(builtin_methods):
+            self.assertEqual(jitted([1, 2, 3]), builtin_methods([1, 2, 3]))
+        for jitted in self.jit_each(user_methods):
+            self.assertEqual(jitted(Node(5)), (10, 11, 3, "Node", "Node"))
+        for jitted in self.jit_each(shadowed):
+            self.assertEqual(jitted(Node(5)), (1, 2))
+
+    def test_order(self):
+        # The method is looked up before the arguments are evaluated.
+        for jitted in self.jit_each(order):
+            log = []
+            with self.assertRaises(AttributeError):
+                jitted(log)
+            self.assertEqual(log, [])
+
+    def test_jitted_methods(self):
+        tree = Node(1, Node(2, Node(3)), Node(4, *[Node(i) for i in range(10)]))
+        expected = tree.total()
+        for jitted in self.jit_each(walk):
+            Node.total = yapyjit.jit(self.saved_total)
+            self.assertEqual(jitted(tree), expected)
+            # Deeper than the native stack allows, as recursive method calls run in place.
+            deep = Node(0)
+            for i in range(20000):
+                deep = Node(1, deep)
+            limit = sys.getrecursionlimit()
+            try:
+                sys.setrecursionlimit(100000)
+                self.assertEqual(jitted(deep), 20000)
+            finally:
+                sys.setrecursionlimit(limit)
+
+    def test_references(self):
+        node = Node(1)
+        refs = sys.getrefcount(node)
+        for jitted in self.jit_each(user_methods):
+            for _ in range(10):
+                jitted(node)
+        self.assertEqual(sys.getrefcount(node), refs)
+
+    def test_instructions(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            ir = yapyjit.pprint_ir(yapyjit.get_ir(user_methods))
+            self.assertEqual(ir.count("LoadMethod"), 5)
+            self.assertEqual(ir.count("CallMethod"), 5)
+            # Only `.value`, which is not called.
+            self.assertEqual(ir.count("LoadAttr"), 1)
+
+
+if __name__ == "__main__":
+    unittest.main()
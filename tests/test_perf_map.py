@@ -0,0 +1,114 @@
+import os
+import platform
+import struct
+import sys
+import unittest
+import yapyjit
+
+
+def total(n):
+    return sum(i * i for i in range(n))
+
+
+def square(x):
+    return x * x
+
+
+def map_path():
+    return "/tmp/perf-%d.map" % os.getpid()
+
+
+def entries():
+    path = map_path()
+    if not os.path.exists(path):
+        return {}
+    with open(path) as f:
+        lines = [line.split(" ", 2) for line in f.read().splitlines()]
+    return {name: (int(start, 16), int(size, 16)) for start, size, name in lines}
+
+
+def dump_path():
+    return "/tmp/jit-%d.dump" % os.getpid()
+
+
+def jitdump_records():
+    with open(dump_path(), "rb") as f:
+        data = f.read()
+    magic, version, size, mach, _, pid, _, _ = struct.unpack_from("<6I2Q", data)
+    assert (magic, version, size, pid) == (0x4A695444, 1, 40, os.getpid()), (magic, version, size, pid)
+    records, offset = [], size
+    while offset < len(data):
+        kind, size, _ = struct.unpack_from("<2IQ", data, offset)
+        records.append((kind, data[offset + 16:offset + size]))
+        offset += size
+    return records
+
+
+@unittest.skipUnless(sys.platform == "linux" and platform.machine() == "x86_64", "perf maps need Linux x86-64")
+class TestPerfMap(unittest.TestCase):
+
+    def tearDown(self):
+        yapyjit.set_perf_map(False)
+        yapyjit.set_jitdump(False)
+        yapyjit.set_code_budget(0)
+        for path in [map_path(), dump_path()]:
+            if os.path.exists(path):
+                os.remove(path)
+
+    def test_entries(self):
+        yapyjit.set_perf_map(True)
+        jitted = yapyjit.jit(total)
+        # The function and its generator expression run through their stubs.
+        self.assertEqual(jitted(100), total(100))
+        names = entries()
+        self.assertIn(__name__ + ".total", names)
+        self.assertIn(__name__ + ".total.<genexpr>", names)
+        start, size = names[__name__ + ".total"]
+        self.assertGreater(size, 0)
+        self.assertNotIn(start, [s for n, (s, _) in names.items() if n != __name__ + ".total"])
+
+    def test_eviction(self):
+        yapyjit.set_perf_map(True)
+        jitted = yapyjit.jit(square)
+        self.assertEqual(jitted(3), 9)
+        self.assertIn(__name__ + ".square", entries())
+        # Evicted code leaves the map, and comes back when compiled again.
+        yapyjit.set_code_budget(1)
+        self.assertNotIn(__name__ + ".square", entries())
+        yapyjit.set_code_budget(0)
+        self.assertEqual(jitted(4), 16)
+        self.assertIn(__name__ + ".square", entries())
+
+    def test_jitdump(self):
+        yapyjit.set_jitdump(True)
+        jitted = yapyjit.jit(square)
+        self.assertEqual(jitted(6), 36)
+        # Not listed in the perf map, which is not enabled.
+        self.assertNotIn(__name__ + ".square", entries())
+        yapyjit.set_jitdump(False)
+        records = jitdump_records()
+        self.assertEqual(records[-1][0], 3)
+        loads = {}
+        for kind, body in records:
+            if kind == 0:
+                _, _, vma, addr, size, index = struct.unpack_from("<2I4Q", body)
+                name, code = body[40:].split(b"\0", 1)
+                self.assertEqual((vma, len(code)), (addr, size))
+                loads[name.decode()] = addr
+            elif kind == 2:
+                addr, count, entry_addr, line, _ = struct.unpack_from("<3Q2I", body)
+                filename = body[32:-1].decode()
+                self.assertEqual((count, entry_addr), (1, addr))
+                if (line, filename) == (square.__code__.co_firstlineno, square.__code__.co_filename):
+                    debug_addr = addr
+        # The line of the `def` is the debug info of the stub.
+        self.assertEqual(loads[__name__ + ".square"], debug_addr)
+
+    def test_disabled(self):
+        jitted = yapyjit.jit(square)
+        self.assertEqual(jitted(5), 25)
+        self.assertNotIn(__name__ + ".square", entries())
+
+
+if __name__ == "__main__":
+    unittest.main()
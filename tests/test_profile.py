@@ -0,0 +1,105 @@
+import unittest
+import yapyjit
+
+
+def loop(n):
+    total = 0
+    for i in range(n):
+        total += i * i
+    return total
+
+
+def fib(n):
+    return n if n < 2 else fib(n - 1) + fib(n - 2)
+
+
+def evens(n):
+    return list(x for x in range(n) if x % 2 == 0)
+
+
+class TestProfile(unittest.TestCase):
+
+    def tearDown(self):
+        yapyjit.set_profile(False)
+
+    def test_counts(self):
+        jitted = yapyjit.jit(loop)
+        self.assertEqual(jitted(3), loop(3))
+        # Not profiled yet.
+        self.assertEqual(jitted.insn_profile(), [])
+        yapyjit.set_profile(True)
+        self.assertEqual(jitted(10), loop(10))
+        profile = jitted.insn_profile()
+        self.assertEqual([p["offset"] for p in profile], sorted(p["offset"] for p in profile))
+        counts = [p["count"] for p in profile]
+        self.assertEqual(min(counts), 1)
+        # The loop body runs once per iteration.
+        self.assertEqual(max(counts), 11)
+        self.assertIn("InplaceAdd", [p["insn"] for p in profile if p["count"] == 10])
+        self.assertEqual({p["cycles"] for p in profile}, {0})
+        # Counts add up over calls, and stop with profiling.
+        jitted(10)
+        self.assertEqual([p["count"] for p in jitted.insn_profile()], [2 * c for c in counts])
+        yapyjit.set_profile(False)
+        jitted(10)
+        self.assertEqual([p["count"] for p in jitted.insn_profile()], [2 * c for c in counts])
+
+    def test_recursion(self):
+        global fib
+        original = fib
+        fib = yapyjit.jit(fib)
+        try:
+            yapyjit.set_profile(True)
+            self.assertEqual(fib(10), 55)
+            # Every activation is counted, in place or not.
+            epilog = [p for p in fib.insn_profile() if p["insn"] == "Epilog"]
+            self.assertEqual(sum(p["count"] for p in epilog), 177)
+        finally:
+            fib = original
+
+    def test_cycles(self):
+        jitted = yapyjit.jit(loop)
+        yapyjit.set_profile(True, True)
+        self.assertEqual(jitted(100), loop(100))
+        profile = jitted.insn_profile()
+        self.assertGreater(sum(p["cycles"] for p in profile), 0)
+        self.assertEqual(max(p["count"] for p in profile), 101)
+        # Counting starts again without cycles.
+        yapyjit.set_profile(True)
+        jitted(100)
+        self.assertEqual({p["cycles"] for p in jitted.insn_profile()}, {0})
+        self.assertEqual(max(p["count"] for p in jitted.insn_profile()), 101)
+
+    def test_generator(self):
+        jitted = yapyjit.jit(evens)
+        yapyjit.set_profile(True)
+        self.assertEqual(jitted(10), evens(10))
+        self.assertTrue(jitted.insn_profile())
+
+    def test_pprint(self):
+        jitted = yapyjit.jit(loop)
+        plain = yapyjit.pprint_ir(jitted).splitlines()
+        self.assertTrue(plain[-1].endswith("Epilog "))
+        zeros = yapyjit.pprint_ir(jitted, True).splitlines()
+        self.assertEqual(zeros, ["0\t" + line for line in plain])
+        yapyjit.set_profile(True)
+        jitted(10)
+        annotated = yapyjit.pprint_ir(jitted, True).splitlines()
+        self.assertEqual(len(annotated), len(plain))
+        counts = {p["offset"]: p["count"] for p in jitted.insn_profile()}
+        for line, text in zip(annotated, plain):
+            count, rest = line.split("\t", 1)
+            self.assertEqual(rest, text)
+            self.assertEqual(int(count), counts.get(int(text.split("\t", 1)[0]), 0))
+        yapyjit.set_profile(True, True)
+        jitted(10)
+        count, cycles, rest = yapyjit.pprint_ir(jitted, True).splitlines()[0].split("\t", 2)
+        self.assertEqual((int(count), rest), (1, plain[0]))
+        with self.assertRaises(Exception):
+            yapyjit.pprint_ir(yapyjit.get_ir(loop), True)
+        with self.assertRaises(Exception):
+            yapyjit.pprint_ir(loop)
+
+
+if __name__ == "__main__":
+    unittest.main()
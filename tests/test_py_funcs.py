@@ -5,6 +5,7 @@ import types
 import inspect
 import pkgutil
 import importlib
+import importlib.util
 import yapyjit
 
 
@@ -20,23 +21,34 @@ def gen_testcase(tc_vs, name, func):
     return _testcase
 
 
-for mi in pkgutil.walk_packages(py_funcs.__path__):
-    full_name = py_funcs.__name__ + "." + mi.name
-    module = importlib.import_module(full_name)
-    tc_vs = {}
-    members = {}
-    for name, obj in dict(module.__dict__).items():
-        if not isinstance(obj, types.FunctionType):
-            continue
-        if len(inspect.getfullargspec(obj).args) == 0:
-            tc_vs[name] = obj()
-    for name, obj in dict(module.__dict__).items():
-        if not isinstance(obj, types.FunctionType):
-            continue
-        module.__dict__[name] = yapyjit.jit(obj)
-        if len(inspect.getfullargspec(obj).args) == 0:
-            members["test_" + name] = gen_testcase(tc_vs, name, module.__dict__[name])
-    globals()[mi.name] = type(mi.name, (unittest.TestCase,), members)
+def gen_testsuites(frontend, suffix):
+    yapyjit.set_frontend(frontend)
+    for mi in pkgutil.walk_packages(py_funcs.__path__):
+        full_name = py_funcs.__name__ + "." + mi.name
+        # A separate copy of the module for each front end, as functions are replaced by jitted ones.
+        spec = importlib.util.find_spec(full_name)
+        module = importlib.util.module_from_spec(spec)
+        spec.loader.exec_module(module)
+        tc_vs = {}
+        members = {}
+        for name, obj in dict(module.__dict__).items():
+            if not isinstance(obj, types.FunctionType):
+                continue
+            if len(inspect.getfullargspec(obj).args) == 0:
+                tc_vs[name] = obj()
+        for name, obj in dict(module.__dict__).items():
+            if not isinstance(obj, types.FunctionType):
+                continue
+            module.__dict__[name] = yapyjit.jit(obj)
+            if len(inspect.getfullargspec(obj).args) == 0:
+                members["test_" + name] = gen_testcase(tc_vs, name, module.__dict__[name])
+        globals()[mi.name + suffix] = type(mi.name + suffix, (unittest.TestCase,), members)
+    yapyjit.set_frontend("ast")
+
+
+gen_testsuites("ast", "")
+if sys.version_info[:2] == (3, 11):
+    gen_testsuites("bytecode", "_bytecode")
 
 
 if __name__ == "__main__":
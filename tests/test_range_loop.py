@@ -0,0 +1,100 @@
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+def total(start, stop, step=1):
+    t = 0
+    for i in range(start, stop, step):
+        t += i
+    return t
+
+
+def total_to(stop):
+    t = 0
+    for i in range(stop):
+        t += i
+    return t
+
+
+def count(n):
+    c = 0
+    for _ in range(n):
+        c += 1
+    return c
+
+
+def last(n):
+    i = -1
+    for i in range(n):
+        pass
+    return i
+
+
+def first_over(n, limit):
+    for i in range(n):
+        if i * i > limit:
+            break
+    return i
+
+
+def nested(n):
+    return [[i * j for j in range(i)] for i in range(n)]
+
+
+def squares(n):
+    return list(x * x for x in range(n))
+
+
+def over(r):
+    return [i for i in r]
+
+
+class TestRangeLoop(FrontendsMixin, unittest.TestCase):
+
+    def test_values(self):
+        cases = [(2, 9), (9, 2), (-3, 0), (10, -5, -3), (0, 100, 7), (-2**62, 2**62, 2**61)]
+        for jitted in self.jit_each(total):
+            for args in cases:
+                self.assertEqual(jitted(*args), total(*args), args)
+            with self.assertRaises(ValueError):
+                jitted(0, 1, 0)
+        for jitted in self.jit_each(total_to):
+            self.assertEqual(jitted(10), 45)
+            self.assertEqual(jitted(0), 0)
+            with self.assertRaises(TypeError):
+                jitted(1.5)
+
+    def test_big_bounds(self):
+        # Bounds beyond a long long fall back to the iterator of the range.
+        for jitted in self.jit_each(total):
+            self.assertEqual(jitted(2**70, 2**70 + 5), total(2**70, 2**70 + 5))
+            self.assertEqual(jitted(0, 2**70, 2**68), total(0, 2**70, 2**68))
+            self.assertEqual(jitted(2**63 - 2, 2**63 + 1), total(2**63 - 2, 2**63 + 1))
+
+    def test_target(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            self.assertEqual(yapyjit.jit(count)(5), 5)
+            self.assertEqual(yapyjit.jit(last)(5), 4)
+            self.assertEqual(yapyjit.jit(last)(0), -1)
+            self.assertEqual(yapyjit.jit(first_over)(10, 20), 5)
+            # The counter of a loop whose target is never read is not boxed.
+            self.assertIn("IterNext -1", yapyjit.pprint_ir(yapyjit.get_ir(count)))
+            self.assertNotIn("IterNext -1", yapyjit.pprint_ir(yapyjit.get_ir(last)))
+
+    def test_comprehensions(self):
+        for jitted in self.jit_each(nested):
+            self.assertEqual(jitted(4), nested(4))
+        for jitted in self.jit_each(squares):
+            self.assertEqual(jitted(5), [0, 1, 4, 9, 16])
+
+    def test_not_range(self):
+        for jitted in self.jit_each(over):
+            self.assertEqual(jitted(range(3)), [0, 1, 2])
+            self.assertEqual(jitted((4, 5)), [4, 5])
+            self.assertEqual(jitted(iter("ab")), ["a", "b"])
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,97 @@
+import sys
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+def fib(n):
+    return n if n < 2 else fib(n - 1) + fib(n - 2)
+
+
+def depth(n, *, acc=0):
+    return acc if n == 0 else depth(n - 1, acc=acc + 1)
+
+
+def forever(n):
+    return forever(n + 1)
+
+
+def ping(n):
+    return pong(n + 1)
+
+
+def pong(n):
+    return ping(n + 1)
+
+
+def guarded(n):
+    # Errors raised by nested calls reach the handler of the right activation.
+    if n == 0:
+        raise ValueError(n)
+    try:
+        return guarded(n - 1)
+    except ValueError as e:
+        if n % 3:
+            raise
+        return n, e.args
+
+
+def keep(n, obj):
+    return obj if n == 0 else keep(n - 1, obj)
+
+
+class TestRecursion(FrontendsMixin, unittest.TestCase):
+
+    def setUp(self):
+        self.saved = {name: globals()[name] for name in ["fib", "depth", "forever", "ping", "pong", "guarded", "keep"]}
+
+    def tearDown(self):
+        globals().update(self.saved)
+        super().tearDown()
+
+    def jit_globals(self, *names):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            for name in names:
+                globals()[name] = yapyjit.jit(self.saved[name])
+            yield
+
+    def test_self_calls(self):
+        for _ in self.jit_globals("fib", "depth", "guarded"):
+            self.assertEqual(fib(20), 6765)
+            self.assertEqual(depth(500), 500)
+            self.assertEqual(guarded(10), (3, (0,)))
+            with self.assertRaises(ValueError):
+                guarded(2)
+
+    def test_deep(self):
+        limit = sys.getrecursionlimit()
+        try:
+            sys.setrecursionlimit(100000)
+            for _ in self.jit_globals("depth"):
+                # Deeper than the native stack allows with a frame per call.
+                self.assertEqual(depth(50000), 50000)
+        finally:
+            sys.setrecursionlimit(limit)
+
+    def test_recursion_error(self):
+        for _ in self.jit_globals("forever", "ping", "pong", "depth"):
+            for _ in range(3):
+                with self.assertRaises(RecursionError):
+                    forever(0)
+                with self.assertRaises(RecursionError):
+                    ping(0)
+            # The depth is given back after the errors.
+            self.assertEqual(depth(500), 500)
+
+    def test_references(self):
+        obj = object()
+        refs = sys.getrefcount(obj)
+        for _ in self.jit_globals("keep"):
+            for _ in range(10):
+                self.assertIs(keep(20, obj), obj)
+        self.assertEqual(sys.getrefcount(obj), refs)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,64 @@
+import sys
+import unittest
+import yapyjit
+
+
+@yapyjit.jit
+def read_args(a, b, c=None):
+    x = a
+    y = [a, b, c]
+    return len(y) + (x is a)
+
+
+@yapyjit.jit
+def write_arg(a, b):
+    b = b + [a]
+    return b
+
+
+@yapyjit.jit
+def accumulate(n):
+    s = 0
+    for i in range(n):
+        s = s + i
+    return s
+
+
+@yapyjit.jit
+def unpack(p):
+    x, y = p
+    return y, x
+
+
+class TestRefcount(unittest.TestCase):
+
+    def assert_balanced(self, func, *args, **kwargs):
+        before = [sys.getrefcount(x) for x in args]
+        for _ in range(100):
+            func(*args, **kwargs)
+        self.assertEqual([sys.getrefcount(x) for x in args], before)
+
+    def test_elided(self):
+        self.assertGreater(read_args.refcount_elided, 0)
+        self.assertGreater(accumulate.refcount_elided, 0)
+
+    def test_balanced(self):
+        a, b, c = object(), object(), object()
+        self.assert_balanced(read_args, a, b)
+        self.assert_balanced(read_args, a, b, c)
+        self.assert_balanced(read_args, a, b=b, c=c)
+        self.assert_balanced(write_arg, a, [b])
+        self.assert_balanced(unpack, (a, b))
+        self.assertEqual(write_arg(1, [2]), [2, 1])
+        self.assertEqual(accumulate(100), 4950)
+        self.assertEqual(unpack((a, b)), (b, a))
+
+    def test_result_survives(self):
+        result = read_args(object(), object())
+        self.assertEqual(result, 4)
+        result = write_arg(object(), [])
+        self.assertEqual(sys.getrefcount(result[0]), 2)
+
+
+if __name__ == "__main__":
+    unittest.main()
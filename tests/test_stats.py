@@ -0,0 +1,84 @@
+import unittest
+import yapyjit
+
+
+def count(n):
+    s = 0
+    for i in range(n):
+        s += i
+    return s
+
+
+def fail(x):
+    return 1 // x
+
+
+def fact(n):
+    return 1 if n <= 1 else n * fact(n - 1)
+
+
+class TestStats(unittest.TestCase):
+
+    def setUp(self):
+        self.saved_fact = fact
+
+    def tearDown(self):
+        globals()["fact"] = self.saved_fact
+        yapyjit.set_code_budget(0)
+
+    def test_counters(self):
+        jitted = yapyjit.jit(count)
+        self.assertEqual((jitted.calls, jitted.instructions, jitted.ticks), (0, 0, 0))
+        jitted(10)
+        small = jitted.instructions
+        jitted(100)
+        self.assertEqual(jitted.calls, 2)
+        # Instructions of the loop body are counted on every iteration.
+        self.assertGreater(jitted.instructions - small, 5 * small)
+        self.assertGreater(jitted.ticks, 0)
+        self.assertEqual(jitted.exceptions, 0)
+        with self.assertRaises(AttributeError):
+            jitted.calls = 0
+
+    def test_exceptions(self):
+        jitted = yapyjit.jit(fail)
+        for x in [1, 0, 2, 0]:
+            try:
+                jitted(x)
+            except ZeroDivisionError:
+                pass
+        self.assertEqual((jitted.calls, jitted.exceptions), (4, 2))
+
+    def test_recursion(self):
+        jitted = globals()["fact"] = yapyjit.jit(self.saved_fact)
+        self.assertEqual(jitted(10), 3628800)
+        # Calls run in place are counted too.
+        self.assertEqual(jitted.calls, 10)
+
+    def test_tier_changes(self):
+        jitted = yapyjit.jit(count)
+        jitted(1)
+        changes = jitted.tier_changes
+        yapyjit.set_code_budget(1)
+        self.assertEqual(jitted.tier, 0)
+        yapyjit.set_code_budget(0)
+        jitted(1)
+        self.assertEqual(jitted.tier_changes, changes + 2)
+
+    def test_snapshot(self):
+        first, second = yapyjit.jit(count), yapyjit.jit(count)
+        first(1000)
+        second(1)
+        stats = yapyjit.stats()
+        entries = {id(entry["function"]): entry for entry in stats}
+        self.assertEqual(entries[id(first)]["calls"], 1)
+        self.assertEqual(entries[id(second)]["name"], "count")
+        self.assertEqual(entries[id(first)]["instructions"], first.instructions)
+        self.assertEqual(entries[id(first)]["icache_misses"], first.icache_misses)
+        self.assertEqual([e["ticks"] for e in stats], sorted((e["ticks"] for e in stats), reverse=True))
+        # Functions never called are left out.
+        self.assertNotIn(id(yapyjit.jit(fail)), {id(entry["function"]) for entry in yapyjit.stats()})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,92 @@
+import os
+import sys
+import unittest
+import yapyjit
+
+try:
+    import _interpreters as interpreters
+except ImportError:
+    try:
+        import _xxsubinterpreters as interpreters
+    except ImportError:
+        interpreters = None
+
+
+class Acc:
+    def __init__(self):
+        self.total = 0
+
+    def add(self, x, *, scale=1):
+        self.total += x * scale
+        return self
+
+
+def fib(n):
+    return n if n < 2 else fib(n - 1) + fib(n - 2)
+
+
+def work(n):
+    acc = Acc()
+    for i in range(n):
+        acc.add(i, scale=2)
+    return acc.total + sum(x * x for x in range(n)) + fib(12)
+
+
+def run_workload():
+    # Runs in a subinterpreter, which has its own copy of this module and its own yapyjit state.
+    assert yapyjit.code_usage() == 0 and yapyjit.stats() == []
+    expected = [work(n) for n in range(100)]
+    globals()["fib"] = yapyjit.jit(fib)
+    Acc.add = yapyjit.jit(Acc.add)
+    jitted = yapyjit.jit(work)
+    for _ in range(5):
+        assert [jitted(n) for n in range(100)] == expected
+    assert {entry["name"] for entry in yapyjit.stats()} == {"work", "fib", "Acc.add"}
+    assert yapyjit.code_usage() > 0
+
+
+SCRIPT = """
+import sys
+sys.path[:0] = {path!r}
+import test_subinterpreters
+test_subinterpreters.run_workload()
+"""
+
+
+@unittest.skipIf(interpreters is None, "subinterpreters are not available")
+class TestSubinterpreters(unittest.TestCase):
+
+    def test_parallel(self):
+        # Not at the top, subinterpreters importing `threading` cannot be destroyed on some versions.
+        import threading
+        script = SCRIPT.format(path=[os.path.dirname(os.path.abspath(__file__))] + sys.path)
+        errors = []
+
+        def run(interp):
+            try:
+                # Newer versions return the exception instead of raising it.
+                failure = interpreters.run_string(interp, script)
+            except Exception as e:
+                failure = e
+            if failure is not None:
+                errors.append(failure)
+
+        # Twice, so that the second round starts after the state of the first is released.
+        for _ in range(2):
+            interps = [interpreters.create() for _ in range(4)]
+            threads = [threading.Thread(target=run, args=(interp,)) for interp in interps]
+            try:
+                for thread in threads:
+                    thread.start()
+                for thread in threads:
+                    thread.join()
+            finally:
+                for interp in interps:
+                    interpreters.destroy(interp)
+            self.assertEqual(errors, [])
+        # Nothing leaks into the state of the main interpreter.
+        self.assertNotIn("work", {entry["name"] for entry in yapyjit.stats()})
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -0,0 +1,109 @@
+import sys
+import unittest
+import yapyjit
+from tests import FRONTENDS, FrontendsMixin
+
+
+def target(a, b=2, *rest, c=3, **kw):
+    return a, b, rest, c, kw
+
+
+def wrapper(*args, **kwargs):
+    return target(*args, **kwargs)
+
+
+def named_wrapper(first, *args, **kwargs):
+    return first, target(*args, **kwargs)
+
+
+def mixed(x, *args, **kwargs):
+    return target(x, *args, y=1, **kwargs)
+
+
+def inspecting(*args, **kwargs):
+    return len(args), target(*args, **kwargs)
+
+
+def count(*args):
+    return len(args), args
+
+
+def keywords(**kw):
+    return sorted(kw.items())
+
+
+def keyword_only(a, *, b, c=3):
+    return a - b + c
+
+
+class TestVarargs(FrontendsMixin, unittest.TestCase):
+
+    def test_binding(self):
+        for jitted in self.jit_each(count):
+            self.assertEqual(jitted(), (0, ()))
+            self.assertEqual(jitted(1, "x", None), (3, (1, "x", None)))
+        for jitted in self.jit_each(keywords):
+            self.assertEqual(jitted(), [])
+            self.assertEqual(jitted(b=2, a=1), [("a", 1), ("b", 2)])
+        for jitted in self.jit_each(keyword_only):
+            self.assertEqual(jitted(5, b=1), 7)
+            self.assertEqual(jitted(c=0, b=1, a=5), 4)
+        for jitted in self.jit_each(target):
+            self.assertEqual(jitted(1, 5, 6, 7, c=4, z=9), target(1, 5, 6, 7, c=4, z=9))
+
+    def test_forwarding(self):
+        for jitted in self.jit_each(wrapper):
+            self.assertEqual(jitted(1), target(1))
+            self.assertEqual(jitted(1, 5, 6, 7, c=4, z=9), target(1, 5, 6, 7, c=4, z=9))
+            self.assertEqual(jitted(b=0, a=1), target(1, 0))
+            with self.assertRaises(TypeError):
+                jitted()
+        for jitted in self.jit_each(named_wrapper):
+            # Keywords bound to `first` are not passed on.
+            self.assertEqual(jitted(c=4, a=1, first=0), (0, target(1, c=4)))
+            self.assertEqual(jitted(0, 1, z=2), (0, target(1, z=2)))
+        for jitted in self.jit_each(mixed):
+            self.assertEqual(jitted(0, 1, 2, q=3), target(0, 1, 2, y=1, q=3))
+        for jitted in self.jit_each(inspecting):
+            self.assertEqual(jitted(1, 2, c=3), (2, target(1, 2, c=3)))
+
+    def test_errors(self):
+        for jitted in self.jit_each(keyword_only):
+            with self.assertRaises(TypeError):
+                jitted(1, 2)
+            with self.assertRaises(TypeError):
+                jitted(1, b=2, d=3)
+        for jitted in self.jit_each(count):
+            with self.assertRaises(TypeError):
+                jitted(x=1)
+
+    def test_references(self):
+        obj = object()
+        refs = sys.getrefcount(obj)
+        calls = [
+            (wrapper, lambda f: f(obj, obj, obj, c=obj, z=obj)),
+            (named_wrapper, lambda f: f(obj, obj, z=obj)),
+            (count, lambda f: f(obj, obj)),
+            (keywords, lambda f: f(a=obj)),
+        ]
+        for func, call in calls:
+            for jitted in self.jit_each(func):
+                for _ in range(10):
+                    call(jitted)
+                self.assertEqual(sys.getrefcount(obj), refs, func.__name__)
+
+    def test_instructions(self):
+        for frontend in FRONTENDS:
+            yapyjit.set_frontend(frontend)
+            for func in [wrapper, named_wrapper]:
+                ir = yapyjit.pprint_ir(yapyjit.get_ir(func))
+                self.assertIn("CallForward", ir)
+                self.assertNotIn("BuildDict", ir)
+            for func in [mixed, inspecting]:
+                ir = yapyjit.pprint_ir(yapyjit.get_ir(func))
+                self.assertIn("CallEx", ir)
+                self.assertNotIn("CallForward", ir)
+
+
+if __name__ == "__main__":
+    unittest.main()
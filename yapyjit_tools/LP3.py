@@ -17,14 +17,37 @@ class ibytecache(NamedItem):
     c = 'uint8_t'
 
 
+class ibyte(NamedItem):
+    # Immediate byte, not written at runtime.
+    c = 'uint8_t'
+
+
 class ilongcache(NamedItem):
     c = 'int64_t'
 
 
+class icache2(NamedItem):
+    c = 'icache_t<2>*'
+
+
+class icallsite(NamedItem):
+    c = 'callsite_t*'
+
+
 class local(NamedItem):
     c = 'local_t'
 
 
+class deflocal(local):
+    # Register written by the instruction.
+    pass
+
+
+class cellidx(NamedItem):
+    # Index into the closure cells, not a register.
+    c = 'local_t'
+
+
 class cstr(NamedItem):
     c = 'const std::string&'
 
@@ -37,6 +60,11 @@ class veclocal(NamedItem):
     c = 'const std::vector<local_t>&'
 
 
+class vecdeflocal(veclocal):
+    # Registers written by the instruction.
+    pass
+
+
 class strmaplocal(NamedItem):
     c = 'const std::map<std::string, local_t>&'
 
@@ -67,13 +95,28 @@ specs = [
         "BitXor", [],
         "BitAnd", [],
         "FloorDiv", []
-    ], [local('dst'), local('left'), local('right')]),
+    ], [deflocal('dst'), local('left'), local('right'), icache2('cache')]),
+    Group('InplaceOp', [
+        "InplaceAdd", [],
+        "InplaceSub", [],
+        "InplaceMult", [],
+        "InplaceMatMult", [],
+        "InplaceDiv", [],
+        "InplaceMod", [],
+        "InplacePow", [],
+        "InplaceLShift", [],
+        "InplaceRShift", [],
+        "InplaceBitOr", [],
+        "InplaceBitXor", [],
+        "InplaceBitAnd", [],
+        "InplaceFloorDiv", []
+    ], [deflocal('dst'), local('left'), local('right'), icache2('cache')]),
     Group('UnaryOp', [
         "Invert", [],
         "Not", [],
         "UAdd", [],
         "USub", []
-    ], [local('dst'), local('src')]),
+    ], [deflocal('dst'), local('src')]),
     Group('Compare', [
         "Eq", [],
         "NotEq", [],
@@ -85,35 +128,49 @@ specs = [
         "IsNot", [],
         "In", [],
         "NotIn", []
-    ], [local('dst'), local('left'), local('right')]),
-    "CheckErrorType", [local('dst'), local('ty'), iaddr('fail_to')],
-    "Constant", [local('obj'), managedpyo('const_obj')],
+    ], [deflocal('dst'), local('left'), local('right')]),
+    "CheckErrorType", [deflocal('dst'), local('ty'), iaddr('fail_to')],
+    "Constant", [deflocal('obj'), managedpyo('const_obj')],
     "DelAttr", [local('obj'), cstr('attrname')],
     "DelItem", [local('obj'), local('subscr')],
     "ErrorProp", [],
     "ClearErrorCtx", [],
-    "IterNext", [local('dst'), local('iter'), iaddr('iter_fail_to')],
+    "GetIter", [deflocal('dst'), local('src')],
+    "IterNext", [deflocal('dst'), local('iter'), iaddr('iter_fail_to')],
     "Jump", [iaddr('target')],
     "JumpTruthy", [local('cond'), iaddr('target')],
-    "LoadAttr", [local('dst'), local('obj'), cstr('attrname')],
-    "LoadClosure", [local('dst'), local('closure')],
-    "LoadGlobal", [local('dst'), cstr('name')],
-    "LoadItem", [local('dst'), local('obj'), local('subscr')],
-    "Move", [local('dst'), local('src')],
+    "LoadAttr", [deflocal('dst'), local('obj'), cstr('attrname')],
+    "LoadMethod", [deflocal('meth'), deflocal('self'), local('obj'), managedpyo('name')],
+    "LoadClosure", [deflocal('dst'), cellidx('closure')],
+    "LoadCell", [deflocal('dst'), local('cell'), cstr('name')],
+    "LoadGlobal", [deflocal('dst'), cstr('name')],
+    "LoadItem", [deflocal('dst'), local('obj'), local('subscr')],
+    "Move", [deflocal('dst'), local('src')],
     "Raise", [local('exc')],
     "Return", [local('src')],
+    "Yield", [local('src')],
     "StoreAttr", [local('obj'), local('src'), cstr('attrname')],
-    "StoreClosure", [local('src'), local('closure')],
+    "StoreClosure", [local('src'), cellidx('closure')],
+    "StoreCell", [local('src'), local('cell')],
     "StoreGlobal", [local('src'), cstr('name')],
     "StoreItem", [local('obj'), local('src'), local('subscr')],
+    "ListAppend", [local('list'), local('src')],
+    "SetAdd", [local('set'), local('src')],
+    "MapAdd", [local('map'), local('key'), local('value')],
     Group('Build', [
         "BuildDict", [],
         "BuildList", [],
         "BuildSet", [],
         "BuildTuple", []
-    ], [local('dst'), veclocal('args')]),
-    "Call", [local('dst'), local('func'), veclocal('args'), strmaplocal('kwargs')],
-    "Destruct", [local('src'), veclocal('targets')],
+    ], [deflocal('dst'), veclocal('args')]),
+    "Call", [deflocal('dst'), local('func'), veclocal('args'), strmaplocal('kwargs'), icallsite('site')],
+    "CallEx", [deflocal('dst'), local('func'), local('args'), local('kwargs')],
+    "CallForward", [deflocal('dst'), local('func'), local('args'), local('kwnames')],
+    "CallMethod", [deflocal('dst'), local('meth'), veclocal('args'), strmaplocal('kwargs'), icallsite('site')],
+    "CallBuiltin", [deflocal('dst'), ibyte('builtin'), managedpyo('name'), managedpyo('expected'), veclocal('args')],
+    "Destruct", [local('src'), vecdeflocal('targets')],
+    "MakeFunction", [deflocal('dst'), managedpyo('proto'), local('defaults'), local('kwdefaults'), local('closure')],
+    "GuardIs", [local('src'), managedpyo('expected'), iaddr('fail_to')],
     "Prolog", [],
     "Epilog", [],
     "TraceHead", [ibytecache('counter')],
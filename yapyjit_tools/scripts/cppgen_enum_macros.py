@@ -0,0 +1,39 @@
+from .. import LP3
+
+
+# Better Enums defaults to 64 constants, which `InsnTag` outgrows.
+# MSVC takes at most 127 macro arguments, bounding `count` below.
+count = 120
+name_length = 24
+assert len(LP3.insn_names) <= count
+
+print("#pragma once")
+print("// Generated by `python -m yapyjit_tools cppgen_enum_macros`, used by enum.h.")
+print()
+print("#define BETTER_ENUMS_PP_MAP(macro, data, ...) \\")
+print("    BETTER_ENUMS_ID( \\")
+print("        BETTER_ENUMS_APPLY( \\")
+print("            BETTER_ENUMS_PP_MAP_VAR_COUNT, \\")
+print("            BETTER_ENUMS_PP_COUNT(__VA_ARGS__)) \\")
+print("        (macro, data, __VA_ARGS__))")
+print()
+print("#define BETTER_ENUMS_PP_MAP_VAR_COUNT(count) BETTER_ENUMS_M ## count")
+print()
+print("#define BETTER_ENUMS_APPLY(macro, ...) BETTER_ENUMS_ID(macro(__VA_ARGS__))")
+print()
+print("#define BETTER_ENUMS_ID(x) x")
+print()
+print("#define BETTER_ENUMS_M1(m, d, x) m(d,0,x)")
+for i in range(2, count + 1):
+    print(f"#define BETTER_ENUMS_M{i}(m,d,x,...) m(d,{i - 1},x) \\")
+    print(f"    BETTER_ENUMS_ID(BETTER_ENUMS_M{i - 1}(m,d,__VA_ARGS__))")
+print()
+params = ", ".join(f"_{i}" for i in range(1, count + 1))
+print(f"#define BETTER_ENUMS_PP_COUNT_IMPL({params}, count, ...) count")
+print()
+counts = ", ".join(str(i) for i in range(count, 0, -1))
+print("#define BETTER_ENUMS_PP_COUNT(...) \\")
+print(f"    BETTER_ENUMS_ID(BETTER_ENUMS_PP_COUNT_IMPL(__VA_ARGS__, {counts}))")
+print()
+items = " ".join(f"X(f, l, {i})" for i in range(name_length))
+print(f"#define BETTER_ENUMS_ITERATE(X, f, l) {items}")
@@ -0,0 +1,32 @@
+from .. import LP3
+
+
+kinds = {
+    LP3.local: 'Local',
+    LP3.deflocal: 'DefLocal',
+    LP3.cellidx: 'CellIdx',
+    LP3.iaddr: 'IAddr',
+    LP3.cstr: 'CStr',
+    LP3.managedpyo: 'PyObj',
+    LP3.ibytecache: 'ByteCache',
+    LP3.ibyte: 'Byte',
+    LP3.ilongcache: 'LongCache',
+    LP3.icache2: 'ICache2',
+    LP3.icallsite: 'CallSite',
+    LP3.veclocal: 'VecLocal',
+    LP3.vecdeflocal: 'VecDefLocal',
+    LP3.strmaplocal: 'StrMapLocal',
+}
+width = max(len(x) for x in LP3.insn_specs[1::2]) + 1
+
+print("enum class OperandKind : uint8_t {")
+print("    End,")
+for kind in kinds.values():
+    print(f"    {kind},")
+print("};")
+print()
+print(f"const OperandKind insn_formats[][{width}] = {{")
+for insn, spec in zip(LP3.insn_specs[::2], LP3.insn_specs[1::2]):
+    items = [f"OperandKind::{kinds[type(item)]}" for item in spec] + ["OperandKind::End"]
+    print(f"    /* {insn} */ {{ {', '.join(items)} }},")
+print("};")